@@ -48,12 +48,20 @@
 #include <AP_RangeFinder.h>     // Range finder library
 #include <Filter.h>                     // Filter library
 #include <AP_Buffer.h>      // APM FIFO Buffer
+#include <AP_RingBuffer.h>  // interrupt safe SPSC ring
+#include <AP_SensorBus.h>   // sensor topics published by the timer process drivers
 #include <ModeFilter.h>         // Mode Filter from Filter library
 #include <LowPassFilter.h>      // LowPassFilter class (inherits from Filter class)
 #include <AP_Relay.h>       // APM relay
 #include <AP_Camera.h>          // Photo or video camera
 #include <AP_Airspeed.h>
 #include <memcheck.h>
+#include <RelNAV_Protocol.h>	// Rel NAV serial frames shared with the vision computer	#MD
+#include <AP_LEDPose.h>		// LED pose solver for raw centroid frames				#MD
+#include <AP_Formation.h>	// formation slot table									#MD
+#include <AP_GainSchedule.h>	// RelNAV gain schedule tables							#MD
+#include <AP_Trace.h>		// binary diagnostic trace								#MD
+#include <AP_StreamCapture.h>	// Rel NAV serial stream capture and replay			#MD
 
 // optional new controller library
 #if APM_CONTROL == ENABLED
@@ -176,6 +184,21 @@ static GPS         *g_gps;
 static RelNAV	   rNav_obj;
 static RelNAV     *rNav = &rNav_obj;
 
+// RelNAV diagnostics, drained to DataFlash with the TRACE log bit, or
+// to the debug port when MY_DEBUG is set	#MD
+static AP_Trace    trace;
+
+// Rel NAV serial port, read through a tap that can capture the raw
+// stream. On the desktop the port can be replaced by a replay		//#MD
+static AP_StreamTap rnav_tap;
+#ifdef DESKTOP_BUILD
+static AP_StreamReplay rnav_replay;
+#endif
+
+// Pose solver for LEDS frames (RNAV_LEDS)							//#MD
+static AP_LEDPose  ledPose;
+static const float rnav_led_positions[LEDPOSE_NUM_LEDS][3] = RNAV_LED_POSITIONS;
+
 
 
 // flight modes convenience array
@@ -240,7 +263,11 @@ AP_InertialSensor_MPU6000 ins;
 AP_InertialSensor_Oilpan ins( &adc );
  #endif // CONFIG_INS_TYPE
 
+#if AHRS_QUATERNION == ENABLED
+AP_AHRS_Quaternion ahrs(&ins, g_gps);
+#else
 AP_AHRS_DCM ahrs(&ins, g_gps);
+#endif
 
 #elif HIL_MODE == HIL_MODE_SENSORS
 // sensor emulators
@@ -248,7 +275,11 @@ AP_Baro_BMP085_HIL barometer;
 AP_Compass_HIL compass;
 AP_GPS_HIL              g_gps_driver(NULL);
 AP_InertialSensor_Stub ins;
+#if AHRS_QUATERNION == ENABLED
+AP_AHRS_Quaternion ahrs(&ins, g_gps);
+#else
 AP_AHRS_DCM  ahrs(&ins, g_gps);
+#endif
 
 #elif HIL_MODE == HIL_MODE_ATTITUDE
 AP_Baro_BMP085_HIL barometer;
@@ -448,6 +479,7 @@ static uint8_t receiver_rssi;
 
 // Global variables to be used by custom throttle controller  #MD
 static int32_t distance_error;			//#MD
+static int32_t target_separation_cm;	//#MD  level distance to hold behind the aim point
 
 // Global variables to be used by lateral and longitudinal controllers when in RNAV mode
 static int32_t roll_error;				//#MD
@@ -742,6 +774,10 @@ void loop()
             }
         }
 
+#ifdef DESKTOP_BUILD
+        Log_Write_Replay_State();
+#endif
+
         fast_loopTimeStamp_ms = millis();
     } else if (millis() - fast_loopTimeStamp_ms < 19) {
         // less than 19ms has passed. We have at least one millisecond
@@ -752,6 +788,22 @@ void loop()
         if (g.compass_enabled) {
             compass.accumulate();
         }
+
+        // write out any full rate IMU samples the interrupt has
+        // captured
+        Log_Write_IMU();
+
+        // the raw Rel NAV stream
+        rnav_tap.set_capture(g.rnav_capture);
+        Log_Write_RNAV_Raw();
+
+        // and the RelNAV diagnostic trace
+        trace.set_enabled((g.log_bitmask & MASK_LOG_TRACE) || MY_DEBUG > 0);
+        if (g.log_bitmask & MASK_LOG_TRACE) {
+            Log_Write_Trace();
+        } else if (MY_DEBUG > 0) {
+            trace.drain(DBG);
+        }
     }
 }
 
@@ -792,6 +844,14 @@ static void fast_loop()
     if (g.log_bitmask & MASK_LOG_RAW)
         Log_Write_Raw();
 
+    if (g.log_bitmask & MASK_LOG_TOPICS)
+        Log_Write_Topics();
+
+#if AHRS_QUATERNION == ENABLED
+    if (g.log_bitmask & MASK_LOG_AHRS2)
+        Log_Write_AHRS2();
+#endif
+
     // inertial navigation
     // ------------------
 #if INERTIAL_NAVIGATION == ENABLED
@@ -859,6 +919,7 @@ static void medium_loop()
 		int have_rnav;
 		
 		have_rnav = rNav->update();
+		rNav->send_prediction(ahrs.get_dcm_matrix(), ins.get_gyro());
 		if (control_mode == REL_NAV)
 			have_position = have_rnav;  // "have_position" must be set to enter the navigation loop (is automatically set in AUTO mode)
 		
@@ -878,6 +939,8 @@ static void medium_loop()
 		{
 			if (slow_have_rnav == 0)
 				gcs_send_text_P(SEVERITY_LOW,PSTR("No RNAV message received"));
+			else if (slow_have_rnav == 1 && rNav->using_gps())
+				gcs_send_text_P(SEVERITY_LOW,PSTR("RNAV Tracking on GPS..."));
 			else if (slow_have_rnav == 1)
 				gcs_send_text_P(SEVERITY_LOW,PSTR("RNAV Tracking..."));
 			else if (slow_have_rnav == 2)
@@ -906,6 +969,12 @@ static void medium_loop()
         // -------------------------------------
         navigate();
 
+#if HAS_LEDS
+        // leader state for the followers' GPS relative navigation   // #MD
+        if (gcs3.initialised) {
+            gcs3.send_message(MSG_LEADER_STATE);
+        }
+#endif
         break;
 
     // command processing
@@ -1034,6 +1103,11 @@ static void slow_loop()
 
         mavlink_system.sysid = g.sysid_this_mav;                // This is just an ugly hack to keep mavlink_system.sysid sync'd with our parameter
 
+		// pick up parameter changes in the RelNAV gain tables	#MD
+		g.rnav_sched.update(g.k1_bank, g.k3_bank, g.k5_bank);
+		// and in the formation slot table, or TGT_SEPTN		#MD
+		update_formation_slot();
+
 #if USB_MUX_PIN > 0
         check_usb_mux();
 #endif
@@ -162,6 +162,29 @@ static void crash_checker()
 }
 
 
+// throttle control with airspeed compensation
+static void throttle_total_energy()
+{
+	energy_error = airspeed_energy_error + altitude_error_cm * 0.098f;
+
+	// positive energy errors make the throttle go higher
+	g.channel_throttle.servo_out = g.throttle_cruise + g.pidTeThrottle.get_pid(energy_error);
+	g.channel_throttle.servo_out += (g.channel_pitch.servo_out * g.kff_pitch_to_throttle);
+
+	g.channel_throttle.servo_out = constrain(g.channel_throttle.servo_out,
+		g.throttle_min.get(), g.throttle_max.get());
+}
+
+// airspeed for the RelNAV gain schedule, m/s
+static float rnav_schedule_speed()
+{
+	float speed;
+	if (!ahrs.airspeed_estimate(&speed)) {
+		speed = g.airspeed_cruise_cm*0.01;
+	}
+	return speed;
+}
+
 static void calc_throttle()
 {
 	// Create last_throttle variable for low-pass filter on throttle
@@ -173,15 +196,23 @@ static void calc_throttle()
 	case REL_NAV:
 
 			wp_distance = rNav->get_level_dist() * 0.01; // cm to meters
-			distance_error = (rNav->get_level_dist() - (100*g.target_separation));
+			calc_separation_error();
 			
+			if (alt_control_airspeed() && g.rnav_spd_ff && !rNav->is_timedout()) {
+				// leader speed feed-forward through the airspeed target
+				throttle_total_energy();
+				last_throttle = g.channel_throttle.servo_out;
+				break;
+			}
+
 			//throttle from distance
 			if ((rNav->get_level_dist() == 0)
 				&& (rNav->relative_bearing_error() == 0)
 				&& (rNav->relative_altitude_error() == 0)) { // steady-level
 				throttle_nudge = 0;
 			} else {
-				throttle_nudge = (rNav->is_timedout()) ? 0 : g.pidRNAVThrottle.get_pid(100*(distance_error)/(100*g.target_separation));
+				throttle_nudge = (rNav->is_timedout()) ? 0 : g.pidRNAVThrottle.get_pid(100*(distance_error)/target_separation_cm,
+						g.rnav_sched.throttle_scaler(rNav->get_level_dist()*0.01, rnav_schedule_speed()));
 			}
 
 			g.channel_throttle.servo_out = g.throttle_cruise + throttle_nudge;
@@ -232,16 +263,7 @@ static void calc_throttle()
 
 			g.channel_throttle.servo_out = constrain(g.channel_throttle.servo_out, g.throttle_min.get(), g.throttle_max.get());
 		} else {
-			// throttle control with airspeed compensation
-			// -------------------------------------------
-			energy_error = airspeed_energy_error + altitude_error_cm * 0.098f;
-
-			// positive energy errors make the throttle go higher
-			g.channel_throttle.servo_out = g.throttle_cruise + g.pidTeThrottle.get_pid(energy_error);
-			g.channel_throttle.servo_out += (g.channel_pitch.servo_out * g.kff_pitch_to_throttle);
-
-			g.channel_throttle.servo_out = constrain(g.channel_throttle.servo_out,
-				g.throttle_min.get(), g.throttle_max.get());
+			throttle_total_energy();
 		}
 	}
 
@@ -294,7 +316,8 @@ static void calc_nav_pitch()
 			}
 
 			//#MD  Try to actually point at the leader and let altitude take care of itself?
-			nav_pitch_cd = g.pidRNAVPitch.get_pid(pitch_error);
+			nav_pitch_cd = g.pidRNAVPitch.get_pid(pitch_error,
+					g.rnav_sched.pitch_scaler(rNav->get_level_dist()*0.01, rnav_schedule_speed()));
 
 		} else {
 			nav_pitch_cd = g.pidNavPitchAltitude.get_pid(altitude_error_cm);
@@ -345,8 +368,8 @@ static void calc_nav_roll()
 		if (!rNav->is_timedout()) {
 			// x = linspace(-25,25);
 			// close all;k1 = 1; k3 = 0.7; k5 = 0.8;plot(x,k1*x,'--');hold on;plot(x,k1*x + 1e-2*k3*sign(x).*abs(x.^3) + 1e-5*k5*sign(x).*abs(x.^5));
-			int sign = (bearing_error_cd>=0)?1:-1;
-			roll_error = g.k1_bank*bearing_error_cd + 1e-2*g.k3_bank*sign*100*fabs(pow(bearing_error_cd/100,3)) + 1e-5*g.k5_bank*sign*100*fabs(pow(bearing_error_cd/100,5))
+			// tabulated from K1_BANK, K3_BANK and K5_BANK in the slow loop
+			roll_error = g.rnav_sched.shape_roll(bearing_error_cd)
 				         + g.k_bank2roll*(rNav->get_relBank()*100) + g.k_hdg2roll*(rNav->get_relHdg()*100);
 		} else {
 			roll_error = -ahrs.roll_sensor;
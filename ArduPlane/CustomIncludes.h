@@ -8,12 +8,9 @@
 #endif
 
 
+// the RelNAV trace is drained here when MY_DEBUG is set
 FastSerial* DBG = &Serial1;
 
-// define macros for printing to serial port
-#define DBG_PRINT(x)   	if (MY_DEBUG > 0) DBG->print(x);   else;
-#define DBG_PRINTLN(x)  if (MY_DEBUG > 0) DBG->println(x); else;
-
 
 #include "RelNAV.h"
 
@@ -477,6 +477,25 @@ static void NOINLINE send_wind(mavlink_channel_t chan)
         wind.z);
 }
 
+// leader position, velocity and attitude for the follower's GPS
+// relative navigation. Stamped with the fix time so the follower can
+// extrapolate it to its own clock
+static void NOINLINE send_leader_state(mavlink_channel_t chan)
+{
+    mavlink_msg_leader_state_send(
+        chan,
+        g_gps->last_fix_time,
+        g_gps->latitude,
+        g_gps->longitude,
+        g_gps->altitude * 10,           // cm to mm
+        g_gps->velocity_north() * 100,  // m/s to cm/s
+        g_gps->velocity_east() * 100,
+        g_gps->velocity_down() * 100,
+        ahrs.roll_sensor,
+        ahrs.pitch_sensor,
+        ahrs.yaw_sensor);
+}
+
 static void NOINLINE send_current_waypoint(mavlink_channel_t chan)
 {
     mavlink_msg_mission_current_send(
@@ -658,6 +677,11 @@ static bool mavlink_try_send_message(mavlink_channel_t chan, enum ap_message id,
         send_wind(chan);
         break;
 
+    case MSG_LEADER_STATE:
+        CHECK_PAYLOAD_SIZE(LEADER_STATE);
+        send_leader_state(chan);
+        break;
+
     case MSG_RETRY_DEFERRED:
         break; // just here to prevent a warning
     }
@@ -785,34 +809,40 @@ GCS_MAVLINK::update(void)
     mavlink_status_t status;
     status.packet_rx_drop_count = 0;
 
-    // process received bytes
-    while (comm_get_available(chan))
+    // process received bytes a block at a time
+    uint8_t buf[GCS_RECEIVE_BLOCK];
+    uint16_t nbytes;
+    while ((nbytes = comm_receive_buffer(chan, buf, sizeof(buf))) != 0)
     {
-        uint8_t c = comm_receive_ch(chan);
-
 #if CLI_ENABLED == ENABLED
         /* allow CLI to be started by hitting enter 3 times, if no
          *  heartbeat packets have been received */
         if (mavlink_active == 0 && millis() < 20000) {
-            if (c == '\n' || c == '\r') {
-                crlf_count++;
-            } else {
-                crlf_count = 0;
-            }
-            if (crlf_count == 3) {
-                run_cli(_port);
+            for (uint16_t i=0; i<nbytes; i++) {
+                if (buf[i] == '\n' || buf[i] == '\r') {
+                    crlf_count++;
+                } else {
+                    crlf_count = 0;
+                }
+                if (crlf_count == 3) {
+                    run_cli(_port);
+                }
             }
         }
 #endif
 
-        // Try to get a new message
-        if (mavlink_parse_char(chan, c, &msg, &status)) {
-            // we exclude radio packets to make it possible to use the
-            // CLI over the radio
-            if (msg.msgid != MAVLINK_MSG_ID_RADIO) {
-                mavlink_active = true;
+        // Try to get new messages
+        uint16_t ofs = 0;
+        while (ofs < nbytes) {
+            ofs += mavlink_parse_buffer(chan, &buf[ofs], nbytes - ofs, &msg, &status);
+            if (status.msg_received) {
+                // we exclude radio packets to make it possible to use the
+                // CLI over the radio
+                if (msg.msgid != MAVLINK_MSG_ID_RADIO) {
+                    mavlink_active = true;
+                }
+                handleMessage(&msg);
             }
-            handleMessage(&msg);
         }
     }
 
@@ -1785,6 +1815,30 @@ mission_failed:
         break;
     }
 
+    case MAVLINK_MSG_ID_FORMATION:			// #MD
+    {
+        // bulk upload of the formation slot table
+        if (g.formation.upload_msg(msg)) {
+            update_formation_slot();
+            send_text(SEVERITY_LOW, PSTR("formation slots updated"));
+        }
+        break;
+    }
+
+#if HAS_VISION
+    case MAVLINK_MSG_ID_LEADER_STATE:		// #MD
+    {
+        // leader state broadcast over the inter-aircraft link
+        mavlink_leader_state_t packet;
+        mavlink_msg_leader_state_decode(msg, &packet);
+        rNav->set_leader_state(packet.time_boot_ms,
+                               packet.lat, packet.lon, packet.alt / 10,
+                               Vector3f(packet.vx, packet.vy, packet.vz) * 0.01,
+                               packet.roll, packet.pitch, packet.yaw);
+        break;
+    }
+#endif
+
 #if HIL_MODE != HIL_MODE_DISABLED
     case MAVLINK_MSG_ID_HIL_STATE:
     {
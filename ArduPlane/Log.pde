@@ -77,6 +77,10 @@ print_log_menu(void)
         PLOG(CUR);
 		PLOG(RNAV);  //#MD
 		PLOG(LEDS);
+        PLOG(AHRS2);
+        PLOG(IMU);
+        PLOG(TRACE);
+        PLOG(TOPICS);
  #undef PLOG
     }
 
@@ -192,6 +196,10 @@ select_logs(uint8_t argc, const Menu::arg *argv)
         TARG(CUR);
 		TARG(RNAV);  //#MD
 		TARG(LEDS);   //#MD
+        TARG(AHRS2);
+        TARG(IMU);
+        TARG(TRACE);
+        TARG(TOPICS);
  #undef TARG
     }
 
@@ -382,6 +390,206 @@ static void Log_Write_LEDSwitch(bool LED_Switch)
 	DataFlash.WriteByte(END_BYTE);
 }
 
+#if AHRS_QUATERNION == ENABLED
+// Write the DCM and quaternion attitude side by side. Total length : 21 bytes
+static void Log_Write_AHRS2()
+{
+    DataFlash.WriteByte(HEAD_BYTE1);
+    DataFlash.WriteByte(HEAD_BYTE2);
+    DataFlash.WriteByte(LOG_AHRS2_MSG);
+
+    DataFlash.WriteInt((int)ahrs.dcm_roll_sensor());
+    DataFlash.WriteInt((int)ahrs.dcm_pitch_sensor());
+    DataFlash.WriteInt((uint16_t)ahrs.dcm_yaw_sensor());
+    DataFlash.WriteInt((int)ahrs.quat_roll_sensor());
+    DataFlash.WriteInt((int)ahrs.quat_pitch_sensor());
+    DataFlash.WriteInt((uint16_t)ahrs.quat_yaw_sensor());
+    DataFlash.WriteInt(ahrs.dcm_update_us());
+    DataFlash.WriteInt(ahrs.quat_update_us());
+    DataFlash.WriteByte(ahrs.using_quaternion());
+
+    DataFlash.WriteByte(END_BYTE);
+}
+#endif
+
+/*
+ *  Full rate raw IMU samples are captured from the sensor interrupt
+ *  into a ring buffer, and written to DataFlash in bursts from the
+ *  idle time in loop(), so the fast loop never waits on the logging
+ */
+#define RAW_IMU_RING_SIZE   32          // must be a power of 2, up to 128
+#define RAW_IMU_BURST       16          // samples per DataFlash record
+
+struct raw_imu_sample {
+    uint32_t time_us;
+    int16_t  v[6];
+};
+static AP_RingBuffer<struct raw_imu_sample, RAW_IMU_RING_SIZE> raw_imu_ring;
+static volatile uint8_t raw_imu_dropped;
+static volatile bool raw_imu_enabled;
+
+// called from the sensor interrupt with every raw sample
+static void raw_imu_capture(const int16_t sample[6])
+{
+    if (!raw_imu_enabled) {
+        return;
+    }
+    struct raw_imu_sample *s;
+    if (raw_imu_ring.write_span(&s) == 0) {
+        // the logger is behind, drop the sample
+        if (raw_imu_dropped < 255) {
+            raw_imu_dropped++;
+        }
+        return;
+    }
+    s->time_us = micros();
+    for (uint8_t i=0; i<6; i++) {
+        s->v[i] = sample[i];
+    }
+    raw_imu_ring.commit(1);
+}
+
+// Write a burst of raw IMU samples if enough have been captured.
+// Total length : 10 bytes + 14 bytes per sample
+static void Log_Write_IMU()
+{
+    raw_imu_enabled = (g.log_bitmask & MASK_LOG_IMU) != 0;
+
+    if (raw_imu_ring.available() < RAW_IMU_BURST) {
+        return;
+    }
+
+    uint8_t dropped = raw_imu_dropped;
+    raw_imu_dropped = 0;
+
+    // the record is stamped with the time of its first sample, so it
+    // stands on its own whatever was logged or dropped before it
+    const struct raw_imu_sample *first;
+    raw_imu_ring.peek_span(&first);
+    uint32_t last_time_us = first->time_us;
+
+    DataFlash.WriteByte(HEAD_BYTE1);
+    DataFlash.WriteByte(HEAD_BYTE2);
+    DataFlash.WriteByte(LOG_IMU_MSG);
+    DataFlash.WriteByte(RAW_IMU_BURST);
+    DataFlash.WriteByte(dropped);
+    DataFlash.WriteLong(last_time_us);
+
+    // each sample carries the time since the one before it in the
+    // record, 0 for the first. The samples are written straight from
+    // the ring
+    uint8_t count = RAW_IMU_BURST;
+    while (count > 0) {
+        const struct raw_imu_sample *s;
+        uint8_t n = raw_imu_ring.peek_span(&s);
+        if (n > count) {
+            n = count;
+        }
+        for (uint8_t j=0; j<n; j++, s++) {
+            DataFlash.WriteInt((uint16_t)(s->time_us - last_time_us));
+            last_time_us = s->time_us;
+            for (uint8_t i=0; i<6; i++) {
+                DataFlash.WriteInt(s->v[i]);
+            }
+        }
+        raw_imu_ring.consume(n);
+        count -= n;
+    }
+
+    DataFlash.WriteByte(END_BYTE);
+}
+
+// Write the diagnostic trace records waiting in the ring, a few at a
+// time. Total length : 24 bytes per record
+#define TRACE_LOG_BURST     4
+
+static void Log_Write_Trace()
+{
+    struct trace_record rec;
+    for (uint8_t n=0; n<TRACE_LOG_BURST && trace.pop(&rec); n++) {
+        DataFlash.WriteByte(HEAD_BYTE1);
+        DataFlash.WriteByte(HEAD_BYTE2);
+        DataFlash.WriteByte(LOG_TRACE_MSG);
+        DataFlash.WriteLong(rec.time_us);
+        DataFlash.WriteInt(rec.seq);
+        DataFlash.WriteByte(rec.id);
+        DataFlash.WriteByte(rec.arg);
+        for (uint8_t i=0; i<3; i++) {
+            int32_t bits;
+            memcpy(&bits, &rec.v[i], sizeof(bits));
+            DataFlash.WriteLong(bits);
+        }
+        DataFlash.WriteByte(END_BYTE);
+    }
+}
+
+// Write the bytes received from the vision computer, as captured by
+// the Rel NAV tap. On the desktop they go to the -V capture file
+// instead, in the text form of the log dump.
+// Total length : 11 bytes + 1 byte per stream byte
+#define RNAV_RAW_BURST      2
+
+static void Log_Write_RNAV_Raw()
+{
+    struct stream_chunk chunk;
+    for (uint8_t n=0; n<RNAV_RAW_BURST && rnav_tap.pop(&chunk); n++) {
+        uint16_t dropped = rnav_tap.dropped();
+#ifdef DESKTOP_BUILD
+        FILE *f = sitl_stream_capture();
+        if (f != NULL) {
+            fprintf(f, "RNAVRAW: %lu, %u, ", (unsigned long)chunk.time_ms, (unsigned)dropped);
+            for (uint8_t i=0; i<chunk.len; i++) {
+                fprintf(f, "%02x", (unsigned)chunk.data[i]);
+            }
+            fprintf(f, "\n");
+            fflush(f);
+            continue;
+        }
+#endif
+        DataFlash.WriteByte(HEAD_BYTE1);
+        DataFlash.WriteByte(HEAD_BYTE2);
+        DataFlash.WriteByte(LOG_RNAV_RAW_MSG);
+        DataFlash.WriteLong(chunk.time_ms);
+        DataFlash.WriteInt(dropped);
+        DataFlash.WriteByte(chunk.len);
+        for (uint8_t i=0; i<chunk.len; i++) {
+            DataFlash.WriteByte(chunk.data[i]);
+        }
+        DataFlash.WriteByte(END_BYTE);
+    }
+}
+
+// Write the newest sample of each sensor topic that has been published
+// since it was last logged. The drivers publish running totals, so
+// the average between two records can be worked out from the dump.
+// Total length : 12 bytes + the size of the sample
+static uint16_t topic_log_version[SENSOR_TOPIC_COUNT];
+
+static void Log_Write_Topics()
+{
+    uint8_t sample[AP_TOPIC_MAX_SIZE];
+    for (AP_Topic *t = AP_Topic::first(); t != NULL; t = t->next()) {
+        uint8_t id = t->id();
+        if (id >= SENSOR_TOPIC_COUNT || !t->updated_since(topic_log_version[id])) {
+            continue;
+        }
+        uint32_t time_us;
+        topic_log_version[id] = t->read(sample, &time_us);
+
+        DataFlash.WriteByte(HEAD_BYTE1);
+        DataFlash.WriteByte(HEAD_BYTE2);
+        DataFlash.WriteByte(LOG_TOPIC_MSG);
+        DataFlash.WriteByte(id);
+        DataFlash.WriteByte(t->size());
+        DataFlash.WriteInt(topic_log_version[id]);
+        DataFlash.WriteLong(time_us);
+        for (uint8_t i=0; i<t->size(); i++) {
+            DataFlash.WriteByte(sample[i]);
+        }
+        DataFlash.WriteByte(END_BYTE);
+    }
+}
+
 // Write an raw accel/gyro data packet. Total length : 28 bytes
 static void Log_Write_Raw()
 {
@@ -587,6 +795,94 @@ static void Log_Read_LEDSwitch()  //#MD
 	cliSerial->printf_P(PSTR("LED: %d\n"),i);
 }
 
+// Read a DCM / quaternion attitude packet
+static void Log_Read_AHRS2()
+{
+    int16_t dcm_roll    = DataFlash.ReadInt();
+    int16_t dcm_pitch   = DataFlash.ReadInt();
+    uint16_t dcm_yaw    = DataFlash.ReadInt();
+    int16_t quat_roll   = DataFlash.ReadInt();
+    int16_t quat_pitch  = DataFlash.ReadInt();
+    uint16_t quat_yaw   = DataFlash.ReadInt();
+    uint16_t dcm_us     = DataFlash.ReadInt();
+    uint16_t quat_us    = DataFlash.ReadInt();
+    byte using_quat     = DataFlash.ReadByte();
+
+    cliSerial->printf_P(PSTR("AHRS2: %d, %d, %u, %d, %d, %u, %u, %u, %d\n"),
+                    (int)dcm_roll, (int)dcm_pitch, (unsigned)dcm_yaw,
+                    (int)quat_roll, (int)quat_pitch, (unsigned)quat_yaw,
+                    (unsigned)dcm_us, (unsigned)quat_us, (int)using_quat);
+}
+
+// Read a burst of raw IMU samples
+static void Log_Read_IMU()
+{
+    uint8_t count   = DataFlash.ReadByte();
+    uint8_t dropped = DataFlash.ReadByte();
+    uint32_t time_us = DataFlash.ReadLong();
+
+    if (dropped != 0) {
+        cliSerial->printf_P(PSTR("IMU: dropped %u\n"), (unsigned)dropped);
+    }
+    for (uint8_t n=0; n<count; n++) {
+        time_us += (uint16_t)DataFlash.ReadInt();
+        cliSerial->printf_P(PSTR("IMU: %lu"), (unsigned long)time_us);
+        for (uint8_t i=0; i<6; i++) {
+            cliSerial->printf_P(PSTR(", %d"), (int)DataFlash.ReadInt());
+        }
+        cliSerial->println();
+    }
+}
+
+// Read a trace record
+static void Log_Read_Trace()
+{
+    uint32_t time_us = DataFlash.ReadLong();
+    uint16_t seq     = DataFlash.ReadInt();
+    uint8_t id       = DataFlash.ReadByte();
+    uint8_t arg      = DataFlash.ReadByte();
+    float v[3];
+    for (uint8_t i=0; i<3; i++) {
+        int32_t bits = DataFlash.ReadLong();
+        memcpy(&v[i], &bits, sizeof(bits));
+    }
+    cliSerial->printf_P(PSTR("TRACE: %lu, %u, %u, %u, %4.2f, %4.2f, %4.2f\n"),
+                    (unsigned long)time_us, (unsigned)seq, (unsigned)id, (unsigned)arg,
+                    v[0], v[1], v[2]);
+}
+
+// Read a chunk of the Rel NAV stream, printed in the form the desktop
+// replay reads back
+static void Log_Read_RNAV_Raw()
+{
+    uint32_t time_ms = DataFlash.ReadLong();
+    uint16_t dropped = DataFlash.ReadInt();
+    uint8_t len      = DataFlash.ReadByte();
+
+    cliSerial->printf_P(PSTR("RNAVRAW: %lu, %u, "), (unsigned long)time_ms, (unsigned)dropped);
+    for (uint8_t i=0; i<len; i++) {
+        cliSerial->printf_P(PSTR("%02x"), (unsigned)DataFlash.ReadByte());
+    }
+    cliSerial->println();
+}
+
+// Read a sensor topic sample, printed as the bytes of its struct in
+// AP_SensorBus.h
+static void Log_Read_Topic()
+{
+    uint8_t id       = DataFlash.ReadByte();
+    uint8_t size     = DataFlash.ReadByte();
+    uint16_t version = DataFlash.ReadInt();
+    uint32_t time_us = DataFlash.ReadLong();
+
+    cliSerial->printf_P(PSTR("TOPIC: %u, %u, %lu, "),
+                    (unsigned)id, (unsigned)version, (unsigned long)time_us);
+    for (uint8_t i=0; i<size; i++) {
+        cliSerial->printf_P(PSTR("%02x"), (unsigned)DataFlash.ReadByte());
+    }
+    cliSerial->println();
+}
+
 // Read a raw accel/gyro packet
 static void Log_Read_Raw()
 {
@@ -692,6 +988,26 @@ static int16_t Log_Read_Process(int16_t start_page, int16_t end_page)
 										Log_Read_LEDSwitch();
 										log_step++;
 
+                                }else if(data == LOG_AHRS2_MSG) {
+                                    Log_Read_AHRS2();
+                                    log_step++;
+
+                                }else if(data == LOG_IMU_MSG) {
+                                    Log_Read_IMU();
+                                    log_step++;
+
+                                }else if(data == LOG_TRACE_MSG) {
+                                    Log_Read_Trace();
+                                    log_step++;
+
+                                }else if(data == LOG_RNAV_RAW_MSG) {
+                                    Log_Read_RNAV_Raw();
+                                    log_step++;
+
+                                }else if(data == LOG_TOPIC_MSG) {
+                                    Log_Read_Topic();
+                                    log_step++;
+
                                 }else {
                                     if(data == LOG_GPS_MSG) {
                                         Log_Read_GPS();
@@ -749,6 +1065,82 @@ static void Log_Write_Control_Tuning() {
 }
 static void Log_Write_Raw() {
 }
+static void Log_Write_AHRS2() {
+}
+static void Log_Write_IMU() {
+}
+static void Log_Write_Trace() {
+}
+static void Log_Write_RNAV_Raw() {
+}
+static void Log_Write_Topics() {
+}
 
 
 #endif // LOGGING_ENABLED
+
+#ifdef DESKTOP_BUILD
+// Write the estimated state as one text line per fast loop when
+// replaying a sensor capture on the desktop
+static void Log_Write_Replay_State()
+{
+    static bool header_written;
+    FILE *f = sitl_replay_output();
+    if (f == NULL) {
+        return;
+    }
+    if (!header_written) {
+        fprintf(f, "time_ms mode roll_cd pitch_cd yaw_cd lat lng alt_cm gspeed_cm airspeed "
+                "nav_roll_cd nav_pitch_cd bearing_err_cd distance_err roll_err pitch_err "
+                "servo_roll servo_pitch servo_throttle servo_rudder\n");
+        header_written = true;
+    }
+    fprintf(f, "%lu %u %ld %ld %ld %ld %ld %ld %ld %.2f %ld %ld %ld %ld %ld %ld %d %d %d %d\n",
+            (unsigned long)millis(),
+            (unsigned)control_mode,
+            (long)ahrs.roll_sensor,
+            (long)ahrs.pitch_sensor,
+            (long)ahrs.yaw_sensor,
+            (long)current_loc.lat,
+            (long)current_loc.lng,
+            (long)current_loc.alt,
+            (long)g_gps->ground_speed,
+            airspeed.get_airspeed(),
+            (long)nav_roll_cd,
+            (long)nav_pitch_cd,
+            (long)bearing_error_cd,
+            (long)distance_error,
+            (long)roll_error,
+            (long)pitch_error,
+            (int)g.channel_roll.servo_out,
+            (int)g.channel_pitch.servo_out,
+            (int)g.channel_throttle.servo_out,
+            (int)g.channel_rudder.servo_out);
+}
+
+// Next chunk of a Rel NAV stream replay, from the RNAVRAW lines of a
+// log dump or a -V capture. Other lines are skipped
+static bool rnav_raw_next(struct stream_chunk *chunk)
+{
+    char line[200];
+    FILE *f = sitl_stream_replay(NULL);
+    while (f != NULL && fgets(line, sizeof(line), f) != NULL) {
+        unsigned long time_ms;
+        unsigned dropped;
+        int pos;
+        if (sscanf(line, "RNAVRAW: %lu, %u, %n", &time_ms, &dropped, &pos) != 2) {
+            continue;
+        }
+        chunk->time_ms = time_ms;
+        chunk->len = 0;
+        const char *p = &line[pos];
+        unsigned b;
+        while (chunk->len < STREAM_CHUNK_MAX && sscanf(p, "%2x", &b) == 1) {
+            chunk->data[chunk->len++] = b;
+            p += 2;
+        }
+        return true;
+    }
+    return false;
+}
+#endif // DESKTOP_BUILD
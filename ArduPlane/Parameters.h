@@ -79,6 +79,23 @@ public:
         k_param_alt_offset,
         k_param_ins,                // libraries/AP_InertialSensor variables
 
+		//
+		// 90: Rel NAV on board pose solution	//#MD
+		//
+		k_param_rnav_leds = 90,		//#MD
+		k_param_rnav_cam_f,			//#MD
+		k_param_rnav_cam_cx,		//#MD
+		k_param_rnav_cam_cy,		//#MD
+
+		//
+		// 100: Rel NAV separation keeping	//#MD
+		//
+		k_param_rnav_spd_ff = 100,	//#MD
+		k_param_rnav_sep_gain,		//#MD
+		k_param_rnav_capture,		//#MD
+		k_param_target_separation,	//#MD was on 230, the key of sitl
+		k_param_rnav_roi,			//#MD
+
         // 110: Telemetry control
         //
         k_param_gcs0 = 110,         // stream rates for port0
@@ -87,6 +104,10 @@ public:
         k_param_sysid_my_gcs,
         k_param_serial3_baud,
         k_param_telem_delay,
+		k_param_serial2_baud,		//#MD
+		k_param_rnav_push,			//#MD
+		k_param_rnav_rx_buf,		//#MD
+		k_param_rnav_tx_buf,		//#MD
 
         // 120: Fly-by-wire control
         //
@@ -114,6 +135,7 @@ public:
         k_param_barometer,   // barometer ground calibration
         k_param_airspeed,  // AP_Airspeed parameters
         k_param_curr_amp_offset,
+		k_param_ahrs_quat,	//#MD AHRS_QUAT_USE, quaternion AHRS group
 
         //
         // 150: Navigation parameters
@@ -214,7 +236,6 @@ public:
         k_param_fence_channel,
         k_param_fence_minalt,
         k_param_fence_maxalt,
-		k_param_target_separation,		//#MD
 
         // other objects
         k_param_sitl = 230,
@@ -225,6 +246,8 @@ public:
 
 		// Putting this here to avoid displacing FLTMODE_CH
 		k_param_thr_ewma,			//#MD
+		k_param_formation,			//#MD
+		k_param_rnav_sched,			//#MD
 
         //
         // 240: PID Controllers
@@ -251,6 +274,18 @@ public:
     AP_Int16 sysid_my_gcs;
     AP_Int8 serial3_baud;
     AP_Int8 telem_delay;
+	AP_Int8 serial2_baud;		//#MD  Rel NAV port
+	AP_Int8 rnav_push;			//#MD
+	AP_Int16 rnav_rx_buf;		//#MD
+	AP_Int16 rnav_tx_buf;		//#MD
+	AP_Int8 rnav_roi;			//#MD
+	AP_Int8 rnav_leds;			//#MD
+	AP_Float rnav_cam_f;		//#MD
+	AP_Float rnav_cam_cx;		//#MD
+	AP_Float rnav_cam_cy;		//#MD
+	AP_Int8 rnav_spd_ff;		//#MD
+	AP_Float rnav_sep_gain;		//#MD
+	AP_Int8 rnav_capture;		//#MD
 
     // Feed-forward gains
     //
@@ -387,6 +422,12 @@ public:
     AP_Camera camera;
 #endif
 
+	// Formation slots		//#MD
+	AP_Formation formation;
+
+	// RelNAV gain schedule	//#MD
+	AP_GainSchedule rnav_sched;
+
     // RC channels
     RC_Channel channel_roll;
     RC_Channel channel_pitch;
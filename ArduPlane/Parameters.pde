@@ -12,6 +12,7 @@
 #define GSCALAR(v, name, def) { g.v.vtype, name, Parameters::k_param_ ## v, &g.v, {def_value : def} }
 #define GGROUP(v, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## v, &g.v, {group_info : class::var_info} }
 #define GOBJECT(v, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## v, &v, {group_info : class::var_info} }
+#define GOBJECTN(v, pname, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## pname, &v, {group_info : class::var_info} }	//#MD
 
 const AP_Param::Info var_info[] PROGMEM = {
     GSCALAR(format_version,         "FORMAT_VERSION", 0),
@@ -73,6 +74,94 @@ const AP_Param::Info var_info[] PROGMEM = {
     // @Increment: 1
     GSCALAR(telem_delay,            "TELEM_DELAY",     0),
 
+	// @Param: SERIAL2_BAUD
+	// @DisplayName: Rel NAV Baud Rate
+	// @Description: The baud rate used on the vision computer port
+	// @Values: 1:1200,2:2400,4:4800,9:9600,19:19200,38:38400,57:57600,111:111100,115:115200
+	// @User: Standard
+	GSCALAR(serial2_baud,			"SERIAL2_BAUD",   SERIAL2_BAUD/1000),	//#MD
+
+	// @Param: RNAV_PUSH
+	// @DisplayName: Rel NAV push mode
+	// @Description: When enabled the vision computer streams poses at camera rate against credit sent in ack frames. When disabled it is polled once per update. Push mode raises the transmit buffer to at least 16 bytes for the ack frames. An ack is skipped rather than waited for when the buffer is full
+	// @Values: 0:Poll,1:Push
+	// @User: Advanced
+	GSCALAR(rnav_push,				"RNAV_PUSH",      RNAV_PUSH),			//#MD
+
+	// @Param: RNAV_RX_BUF
+	// @DisplayName: Rel NAV receive buffer
+	// @Description: Receive buffer size of the vision computer port, rounded up to a power of two. Takes effect after reboot
+	// @Units: bytes
+	// @Range: 32 512
+	// @User: Advanced
+	GSCALAR(rnav_rx_buf,			"RNAV_RX_BUF",    RNAV_RX_BUFSIZE),		//#MD
+
+	// @Param: RNAV_TX_BUF
+	// @DisplayName: Rel NAV transmit buffer
+	// @Description: Transmit buffer size of the vision computer port, rounded up to a power of two. Takes effect after reboot
+	// @Units: bytes
+	// @Range: 1 128
+	// @User: Advanced
+	GSCALAR(rnav_tx_buf,			"RNAV_TX_BUF",    RNAV_TX_BUFSIZE),		//#MD
+
+	// @Param: RNAV_ROI
+	// @DisplayName: Rel NAV region of interest feedback
+	// @Description: When enabled the leader pose predicted for the next camera frame is sent to the vision computer on every update, so it can limit its LED search. Needs RNAV_TX_BUF of at least 64
+	// @Values: 0:Disabled,1:Enabled
+	// @User: Advanced
+	GSCALAR(rnav_roi,				"RNAV_ROI",       RNAV_ROI),			//#MD
+
+	// @Param: RNAV_LEDS
+	// @DisplayName: Rel NAV on board pose solution
+	// @Description: When enabled the vision computer sends raw LED centroids (LEDS frames) and the relative pose is solved on board. Frames with two or three LEDs in view still give a position fix, using the AHRS attitude. Takes effect after reboot
+	// @Values: 0:Disabled,1:Enabled
+	// @User: Advanced
+	GSCALAR(rnav_leds,				"RNAV_LEDS",      RNAV_LEDS),			//#MD
+
+	// @Param: RNAV_CAM_F
+	// @DisplayName: Rel NAV camera focal length
+	// @Description: Focal length of the vision camera, used with RNAV_LEDS
+	// @Units: pixels
+	// @User: Advanced
+	GSCALAR(rnav_cam_f,				"RNAV_CAM_F",     RNAV_CAM_F),			//#MD
+
+	// @Param: RNAV_CAM_CX
+	// @DisplayName: Rel NAV camera principal point column
+	// @Description: Image column of the vision camera optical axis, used with RNAV_LEDS
+	// @Units: pixels
+	// @User: Advanced
+	GSCALAR(rnav_cam_cx,			"RNAV_CAM_CX",    RNAV_CAM_CX),			//#MD
+
+	// @Param: RNAV_CAM_CY
+	// @DisplayName: Rel NAV camera principal point row
+	// @Description: Image row of the vision camera optical axis, used with RNAV_LEDS
+	// @Units: pixels
+	// @User: Advanced
+	GSCALAR(rnav_cam_cy,			"RNAV_CAM_CY",    RNAV_CAM_CY),			//#MD
+
+	// @Param: RNAV_SPD_FF
+	// @DisplayName: Rel NAV leader speed feed-forward
+	// @Description: With an airspeed sensor in use, REL_NAV targets the leader's airspeed, estimated from our own and the closing rate, through the total energy throttle and airspeed pitch loops. When disabled the separation error drives the throttle through the RNAV2THR_ PID and THR_EWMA
+	// @Values: 0:Disabled,1:Enabled
+	// @User: Advanced
+	GSCALAR(rnav_spd_ff,			"RNAV_SPD_FF",    RNAV_SPD_FF),			//#MD
+
+	// @Param: RNAV_SEP_GAIN
+	// @DisplayName: Rel NAV separation gain
+	// @Description: Airspeed added to the leader's for each metre of separation error, with RNAV_SPD_FF
+	// @Units: 1/s
+	// @Range: 0 1
+	// @Increment: 0.01
+	// @User: Advanced
+	GSCALAR(rnav_sep_gain,			"RNAV_SEP_GAIN",  RNAV_SEP_GAIN),		//#MD
+
+	// @Param: RNAV_CAPTURE
+	// @DisplayName: Rel NAV stream capture
+	// @Description: Record every byte received from the vision computer, with its time, in RNAVRAW DataFlash records. The log dump of these records can be replayed into SITL
+	// @Values: 0:Disabled,1:Enabled
+	// @User: Advanced
+	GSCALAR(rnav_capture,			"RNAV_CAPTURE",   RNAV_CAPTURE),		//#MD
+
     // @Param: KFF_PTCHCOMP
     // @DisplayName: Pitch Compensation
     // @Description: Adds pitch input to compensate for the loss of lift due to roll control. 0 = 0 %, 1 = 100%
@@ -629,6 +718,14 @@ const AP_Param::Info var_info[] PROGMEM = {
     GGROUP(camera,                  "CAM_", AP_Camera),
 #endif
 
+	// @Group: FORM_
+	// @Path: ../libraries/AP_Formation/AP_Formation.cpp
+	GGROUP(formation,				"FORM_", AP_Formation),	//#MD
+
+	// @Group: RNAV_GS_
+	// @Path: ../libraries/AP_GainSchedule/AP_GainSchedule.cpp
+	GGROUP(rnav_sched,				"RNAV_GS_", AP_GainSchedule),	//#MD
+
     // RC channel
     //-----------
     // @Group: RC1_
@@ -708,6 +805,12 @@ const AP_Param::Info var_info[] PROGMEM = {
     // @Path: ../libraries/AP_AHRS/AP_AHRS.cpp
     GOBJECT(ahrs,                   "AHRS_",    AP_AHRS),
 
+#if AHRS_QUATERNION == ENABLED	//#MD
+	// @Group: AHRS_
+	// @Path: ../libraries/AP_AHRS/AP_AHRS_Quaternion.cpp
+	GOBJECTN(ahrs, ahrs_quat,		"AHRS_",	AP_AHRS_Quaternion),
+#endif
+
     // @Group: ARSPD_
     // @Path: ../libraries/AP_Airspeed/AP_Airspeed.cpp
     GOBJECT(airspeed,                               "ARSPD_",   AP_Airspeed),
@@ -10,11 +10,32 @@
 #include "CustomIncludes.h"
 #include "vector3.h"
 #include "matrix3.h"
+#include <RelNAV_Protocol.h>
+#include <AP_LEDPose.h>
+#include <AP_Trace.h>
+#include <Filter.h>
+#include <DerivativeFilter.h>
+#ifdef DESKTOP_BUILD
+#include <time.h>
+#endif
 //typedef unsigned char byte;  // May need to typedef "byte" type in .h file for compilation outside of VM
 
 // defines for LED bitmask
 
 #define RNAV_LOST_LINK_TIMEOUT		5000		// milliseconds
+#define RNAV_ATTITUDE_HOLD			2000		// milliseconds the leader attitude is held for partial LED fixes
+#define RNAV_LEADER_TIMEOUT			1000		// milliseconds a leader state broadcast stays usable
+#define RNAV_GPS_FALLBACK			500			// milliseconds without vision before navigating on GPS
+#define RNAV_GPS_BIAS_GAIN			0.05		// low pass gain of the vision minus GPS bias, per vision fix
+#define RNAV_CLOCK_RESET			5000		// leader clock jump (ms) that restarts the offset estimate
+#define RNAV_LATLON_TO_M			0.01113195	// metres per 1e-7 degree
+
+// frame layouts are shared with the vision computer
+#define RNAV_HEADER_LEN		4
+#define RNAV_FRAME_LEN		sizeof(struct relnav_data)
+#define RNAV_LEDS_LEN		sizeof(struct relnav_leds)
+#define RNAV_MAX_FRAME_LEN	RNAV_LEDS_LEN
+#define RNAV_ACK_LEN		sizeof(struct relnav_ack)
 #define MASK_LED_1		(1<<0)
 #define MASK_LED_2		(1<<1)
 #define MASK_LED_3		(1<<2)
@@ -27,11 +48,15 @@ protected:
 
 	Vector3<float> dx_b;			// relative vector in follower's body frame (inches)
 	Vector3<float> dx_ff;			// relative vector in formation frame (inches)
+	Vector3<float> aim_ff;			// vector to the aim point of our slot in formation frame (inches)
+	Vector3<float> aim_b;			// and in the follower's body frame
+	Vector3<float> slot;			// slot offset from the leader (inches)
+	bool haveSlot;
 	float dphi, dtheta, dpsi;		// relative Euler angles (degrees)
 	byte LED_bitmask;				// gives the LEDs that are within the frame (when using HIL_MODE_ATTITUDE)
 
 	Matrix3<float> DCM;
-	FastSerial* rNAVSerial;
+	BetterStream* rNAVSerial;
 
 	int32_t bearing_err;	// 100*degrees
 	int32_t altitude_err;   // cm
@@ -40,6 +65,62 @@ protected:
 	unsigned long timer;	// time of the last succesful localization
 	bool timeout;
 
+	// rate of change of level_dist, one sample per fix
+	DerivativeFilterFloat_Size7 rangeRateFilter;
+	unsigned long rangeRateTime;	// fix time of the last sample
+	uint8_t rangeRateSamples;		// fixes since the filter was reset
+
+	// frame being assembled from the serial port
+	uint8_t frame[RNAV_MAX_FRAME_LEN];
+	uint8_t frameLen;
+	uint8_t frameSize;		// length of the frame type being assembled
+	bool inSync;			// false while skipping bytes between frames
+
+	// push mode flow control
+	bool push;				// vision computer streams poses on credit
+	uint16_t rxSpace;		// receive buffer size of the port
+	uint8_t ackSeq;
+	uint16_t frames;		// good frames in the current rate window
+	uint16_t drops;			// bad frames and resyncs since the last ack
+	uint8_t rate;			// good frames over the last second
+	uint32_t rateTimer;
+
+	// region of interest feedback
+	bool roi;				// send predicted poses to the vision computer
+	bool newFix;			// a pose arrived since the last prediction
+	Matrix3<float> fixDCM;	// attitude when the last pose arrived
+
+	// on board pose solution from raw LED centroids
+	AP_LEDPose *ledPose;
+	AP_AHRS *ahrs;
+	Matrix3<float> leaderDCM;	// leader attitude at the last full pose
+	uint32_t leaderTimer;		// time of the last full pose
+	bool haveLeader;
+
+	// GPS relative navigation from the leader state broadcast
+	GPS **gps;
+	int32_t leaderLat, leaderLng;	// 1e-7 degrees
+	int32_t leaderAlt;				// cm
+	Vector3<float> leaderVel;		// NED, m/s
+	int16_t leaderRoll, leaderPitch;	// centidegrees
+	uint16_t leaderYaw;
+	uint32_t leaderFixTime;			// leader fix time on our clock
+	uint32_t leaderRxTime;
+	int32_t clockOffset;			// our clock minus the leader's, ms
+	bool haveLeaderState;
+	Vector3<float> gpsBias;			// vision minus GPS relative position, NED metres
+	bool haveBias;
+	uint32_t visionTimer;			// time of the last vision fix
+	bool gpsFallback;				// the relative state is from GPS
+
+	AP_Trace *tracer;				// diagnostic events, or NULL
+
+#ifdef DESKTOP_BUILD
+	// poses from a solver on the same host, in place of the serial port
+	const struct relnav_shm *rNAVShm;
+	uint32_t shmSeq;				// sequence number of the last pose taken
+#endif
+
 public:
 
 
@@ -49,6 +130,7 @@ public:
 		// dx_b
 		// dx_ff
 		dphi = dtheta = dpsi = 0;
+		haveSlot = false;
 
 		// DCM 
 		rNAVSerial = NULL;
@@ -58,6 +140,43 @@ public:
 
 		timer = millis();
 		timeout = false;
+		rangeRateTime = 0;
+		rangeRateSamples = 0;
+
+		frameLen = 0;
+		frameSize = RNAV_FRAME_LEN;
+		inSync = true;
+		push = false;
+		rxSpace = 0;
+		ackSeq = 0;
+		frames = 0;
+		drops = 0;
+		rate = 0;
+		rateTimer = timer;
+
+		roi = false;
+		newFix = false;
+		fixDCM.identity();
+
+		ledPose = NULL;
+		ahrs = NULL;
+		leaderTimer = 0;
+		haveLeader = false;
+
+		gps = NULL;
+		leaderRxTime = 0;
+		clockOffset = 0;
+		haveLeaderState = false;
+		haveBias = false;
+		visionTimer = timer;
+		gpsFallback = false;
+
+		tracer = NULL;
+
+#ifdef DESKTOP_BUILD
+		rNAVShm = NULL;
+		shmSeq = 0;
+#endif
 	};
 
 
@@ -65,12 +184,101 @@ public:
 	~RelNAV(){};
 
 
-	// set serial port to accept relative navigation data over
-	void setSerial(FastSerial* serial_ptr){
+	// set serial port to accept relative navigation data over. In push
+	// mode the vision computer streams poses as long as it holds credit,
+	// otherwise it is polled once per update
+	void setSerial(BetterStream* serial_ptr, bool push_mode = false, uint16_t rx_space = 64){
 		rNAVSerial = serial_ptr;
-		rNAVSerial->println("H");	// put in a request for data
+		push = push_mode;
+		rxSpace = rx_space;
+		if (push)
+			send_ack();					// grant the first credit
+		else
+			rNAVSerial->println("H");	// put in a request for data
 	}
 
+#ifdef DESKTOP_BUILD
+	// take poses from a shared memory slot written by a solver on the
+	// same host. The serial port is still used for the predicted poses
+	void setShared(const struct relnav_shm *shm) {
+		rNAVShm = shm;
+	};
+#endif
+
+	// solve the pose on board from LEDS frames. With four or more LEDs
+	// in view the full pose is solved for. With two or three, the
+	// leader is taken to hold the attitude of the last full pose and
+	// only the position is solved for, using the follower attitude
+	// from the AHRS
+	void set_pose_solver(AP_LEDPose *solver, AP_AHRS *ahrs_ptr) {
+		ledPose = solver;
+		ahrs = ahrs_ptr;
+	};
+
+	// navigate on GPS relative to the leader's state broadcast while
+	// vision is lost. The GPS solution is corrected by its bias against
+	// the last vision fixes
+	void set_leader_link(GPS **gps_ptr, AP_AHRS *ahrs_ptr) {
+		gps = gps_ptr;
+		ahrs = ahrs_ptr;
+	};
+
+	// raise diagnostic events into a trace ring, in place of printing
+	// them on the debug port
+	void set_trace(AP_Trace *trace_ptr) {
+		tracer = trace_ptr;
+	};
+
+	// leader state received over telemetry. time_ms is the leader's fix
+	// time on its own clock. The offset to our clock is the smallest
+	// seen, as that message had the least latency; it creeps up a
+	// millisecond per message to follow clock drift and restarts if the
+	// leader reboots
+	void set_leader_state(uint32_t time_ms, int32_t lat, int32_t lng, int32_t alt_cm,
+						  const Vector3<float> &vel, int16_t roll_cd, int16_t pitch_cd, uint16_t yaw_cd) {
+		if (time_ms == 0 || (lat == 0 && lng == 0))
+			return;		// no fix on the leader yet
+
+		uint32_t tnow = millis();
+		int32_t offset = tnow - time_ms;
+		if (!haveLeaderState || offset < clockOffset || offset - clockOffset > RNAV_CLOCK_RESET)
+			clockOffset = offset;
+		else
+			clockOffset++;
+
+		leaderFixTime = time_ms + clockOffset;
+		leaderRxTime = tnow;
+		leaderLat = lat;
+		leaderLng = lng;
+		leaderAlt = alt_cm;
+		leaderVel = vel;
+		leaderRoll = roll_cd;
+		leaderPitch = pitch_cd;
+		leaderYaw = yaw_cd;
+		haveLeaderState = true;
+	}
+
+	// true while the relative state comes from GPS rather than vision
+	bool using_gps() {return gpsFallback && !timeout;};
+
+	// fly a formation slot, offset from the leader in the formation
+	// frame (forward, right, down; metres). Its lateral and vertical
+	// offsets move the aim point abreast of the leader; the separation
+	// behind it is left to the throttle loop
+	void set_slot(const Vector3<float> &offset) {
+		slot = offset * 39.37;
+		haveSlot = true;
+	};
+
+	// aim at the leader itself
+	void clear_slot() {haveSlot = false;};
+
+	// enable the predicted pose return path
+	void set_roi(bool enable) {roi = enable;};
+
+	// good frames received over the last second (push mode)
+	uint8_t get_rate() {return rate;};
+
 
 
 	// get relative bearing error
@@ -82,8 +290,18 @@ public:
 	// get level distance between aircraft
 	int32_t get_level_dist() {return (timeout) ? 0 : level_dist;};
 
+	// get rate of change of the level distance (cm/s), positive when
+	// the leader is pulling away. Zero until the filter holds a full
+	// window of fixes since the link was last lost
+	float get_range_rate() {
+		if (timeout || rangeRateSamples < rangeRateFilter.get_filter_size()) {
+			return 0;
+		}
+		return rangeRateFilter.slope() * 1.0e3;
+	};
+
 	// get pitch_cmd
-	double pitch_cmd() {return (timeout) ? 0 : 100*(180/M_PI)*atan2(-dx_b.z,dx_b.x);};
+	double pitch_cmd() {return (timeout) ? 0 : 100*(180/M_PI)*atan2(-aim_b.z,aim_b.x);};
 
 	// get relative x  (inches)
 	double get_relx() {return (timeout) ? 0 : dx_b.x;};
@@ -118,16 +336,36 @@ public:
 		//compute relative vector in 
 		dx_ff = DCM * dx_b;
 
+		// the slot's right axis turns with the leader's relative heading
+		aim_ff = dx_ff;
+		if (haveSlot) {
+			aim_ff.x -= sin(ToRad(dpsi)) * slot.y;
+			aim_ff.y += cos(ToRad(dpsi)) * slot.y;
+			aim_ff.z += slot.z;
+		}
+		aim_b = DCM.transposed() * aim_ff;
+
 		timeout = ((millis() - timer) > RNAV_LOST_LINK_TIMEOUT) ? true : false;
 
 		if (!timeout) {
-			bearing_err = 100 * atan2(dx_ff.y,dx_ff.x) * (180/M_PI);  // convert to centidegrees
-			altitude_err = -(dx_ff.z) * (2.5400);  // convert inches to cm
-			level_dist = sqrt( pow(dx_ff.x,2) + pow(dx_ff.y,2) ) * (2.5400);  // convert inches to cm
+			bearing_err = 100 * atan2(aim_ff.y,aim_ff.x) * (180/M_PI);  // convert to centidegrees
+			altitude_err = -(aim_ff.z) * (2.5400);  // convert inches to cm
+			level_dist = sqrt( pow(aim_ff.x,2) + pow(aim_ff.y,2) ) * (2.5400);  // convert inches to cm
+
+			// one sample per fix, stamped with the fix time
+			if (timer != rangeRateTime) {
+				rangeRateFilter.update(level_dist, timer);
+				rangeRateTime = timer;
+				if (rangeRateSamples < rangeRateFilter.get_filter_size()) {
+					rangeRateSamples++;
+				}
+			}
 		} else {
 			bearing_err = 0;
 			altitude_err = 0;
 			level_dist = 0;
+			rangeRateFilter.reset();
+			rangeRateSamples = 0;
 		}
 	}
 
@@ -136,102 +374,498 @@ public:
 	// listen over serial port for relative navigation update
 	int update() {
 
-		byte incomingByte, _LED_bitmask;
-		int receivedData = 0;
-		float payload[6];
-		int payload_len = 6, expected_len;
+		int receivedData;
 
-		// We always expect this length of message now
-		expected_len = 30;
-		
-		//unsigned int tic = millis();
-		//while ((rNAVSerial->available() < expected_len) && (millis() - tic > 5)) {}
+#ifdef DESKTOP_BUILD
+		receivedData = (rNAVShm != NULL) ? read_shared() : read_serial();
+#else
+		receivedData = read_serial();
+#endif
 
-		if (rNAVSerial->available() >= expected_len) {
+		if (receivedData == 1) {
+			visionTimer = millis();
+			gpsFallback = false;
+		}
+		if (gps_update(receivedData == 1))
+			receivedData = 1;
 
-			// check for message header
-			rNAVSerial->find("DATA");
-			uint8_t chk = 'D' ^ 'A' ^ 'T' ^ 'A';
-			static uint8_t last_chk;
+		if (shared()) {
+			// the solver needs no credit or requests
+		} else if (push) {
+			send_ack();
+		} else {
+			// request data for next time
+			rNAVSerial->println("HHHHH");
+		}
 
-			for (int i = 0; i<payload_len; i++) {
+		return receivedData;
+	} // end #MD
 
-				union {
-					uint8_t b[4];
-					float f;
-				} pld;
+private:
 
-				pld.b[0] = rNAVSerial->read();
-				pld.b[1] = rNAVSerial->read();
-				pld.b[2] = rNAVSerial->read();
-				pld.b[3] = rNAVSerial->read();
+	bool shared() {
+#ifdef DESKTOP_BUILD
+		return rNAVShm != NULL;
+#else
+		return false;
+#endif
+	}
 
-				chk = chk ^ pld.b[0] ^ pld.b[1] ^ pld.b[2] ^ pld.b[3];
+	// decode every complete frame that is waiting, so that in push
+	// mode the newest pose is used and the receive buffer is drained
+	int read_serial() {
+		int receivedData = 0;
+		bool haveFrame = false;
 
-				payload[i] = pld.f;
-			}
+		while (read_frame()) {
+			int result = decode_frame();
+			haveFrame = true;
+			if (result != 0 && receivedData != 1)
+				receivedData = result;
+		}
 
+		if (!haveFrame) {
+			// the entire message is not available
+			trace_event(TRACE_RNAV_NO_MSG);
+		}
+		return receivedData;
+	}
 
-//#if HIL_MODE == HIL_MODE_ATTITUDE
-			// read the bitmask that gives the LEDs in the field of view
-			_LED_bitmask = rNAVSerial->read();
-			chk = chk ^ _LED_bitmask;
-//#endif
+#ifdef DESKTOP_BUILD
+	// take the latest pose from the shared memory slot, without
+	// waiting on the solver. Returns as decode_data() does, and 0 if
+	// there has been no new pose since the last update
+	int read_shared() {
+		struct relnav_pose pose;
+		uint32_t seq = relnav_shm_read(rNAVShm, &pose);
+
+		if (seq == 0 || seq == shmSeq) {
+			trace_event(TRACE_RNAV_NO_MSG);
+			return 0;
+		}
+		shmSeq = seq;
+		frames++;
+
+		if (tracer != NULL) {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			uint64_t now_us = ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+			tracer->event(TRACE_RNAV_SHM_AGE, pose.led_mask, now_us - pose.capture_us, 0, 0);
+		}
 
-			// compare checksums
-			if ( rNAVSerial->read() == chk) {
-				receivedData = 1;  // we at least received data
 #if HIL_MODE==HIL_MODE_ATTITUDE
-				LED_bitmask = _LED_bitmask;
+		LED_bitmask = pose.led_mask;
 #else
-				LED_bitmask = 0xFF;
+		LED_bitmask = 0xFF;
+#endif
+		if ((LED_bitmask & 0x1F) != MASK_LED_ALL) {
+			trace_event(TRACE_RNAV_LEDS_MISSING, LED_bitmask);
+			return 1;
+		}
+		if (isnan(pose.x)) {
+			trace_event(TRACE_RNAV_ZOH, LED_bitmask);
+			return 2;
+		}
+
+		dx_b.x	= pose.x;
+		dx_b.y	= pose.y;
+		dx_b.z	= pose.z;
+		dphi	= pose.bank;
+		dtheta	= pose.pitch;
+		dpsi	= pose.hdg;
+
+		timer = millis();
+		newFix = true;
+		hold_leader_attitude();
+		trace_pose();
+		return 1;
+	}
 #endif
-				if ((LED_bitmask & 0x1F) == MASK_LED_ALL) {
-					if (isnan(payload[0]) || (chk == last_chk))  // expect NaN on failed pose estimate (Or an IDENTICAL estimate to previous frame (which will give us an identical checksum))
-					{
-						DBG_PRINTLN("ZOH");
-						receivedData = 2;  // signifies ZOH
-					} else {
-
-					// Everything worked -- YAY!  :)
-					dx_b.x		= payload[0];
-					dx_b.y		= payload[1];
-					dx_b.z		= payload[2];
-					dphi		= payload[3];
-					dtheta		= payload[4];
-					dpsi		= payload[5];
-
-					last_chk = chk;
-					timer = millis();  // reset the timer
-
-					// Print the relative state read from serial
-					DBG_PRINT(dx_b.x); DBG_PRINT("  "); DBG_PRINT(dx_b.y); DBG_PRINT("  "); DBG_PRINT(dx_b.z); DBG_PRINT("  ");
-					DBG_PRINT(dphi); DBG_PRINT("  "); DBG_PRINT(dtheta); DBG_PRINT("  "); DBG_PRINTLN(dpsi);
-					}
 
+	// pull bytes from the port until a complete frame is buffered.
+	// Bytes that do not start a header are discarded. The first byte
+	// tells DATA from LEDS frames
+	bool read_frame() {
+		static const char data_header[] = RELNAV_DATA_HEADER;
+		static const char leds_header[] = RELNAV_LEDS_HEADER;
+		const char *header = (frame[0] == leds_header[0]) ? leds_header : data_header;
+
+		while (frameLen < RNAV_HEADER_LEN) {
+			int c = rNAVSerial->read();
+			if (c == -1)
+				return false;
+			if (frameLen > 0 && c != header[frameLen]) {
+				// count each loss of sync once
+				if (inSync)
+					drops++;
+				inSync = false;
+				frameLen = 0;
+			}
+			if (frameLen == 0) {
+				if (c == leds_header[0]) {
+					header = leds_header;
+				} else if (c == data_header[0]) {
+					header = data_header;
 				} else {
-					// not all LEDs in the frame
-					DBG_PRINTLN("LEDS_MISSING");
+					if (inSync)
+						drops++;
+					inSync = false;
+					continue;
+				}
+			}
+			frame[frameLen++] = c;
+		}
+		inSync = true;
+		frameSize = (header == leds_header) ? RNAV_LEDS_LEN : RNAV_FRAME_LEN;
+
+		frameLen += rNAVSerial->read_bytes(&frame[frameLen], frameSize - frameLen);
+		if (frameLen < frameSize)
+			return false;
+
+		frameLen = 0;
+		return true;
+	}
+
+	// decode a complete frame. Returns 1 for a new pose, 2 for a
+	// repeated or failed pose estimate (ZOH) and 0 otherwise
+	int decode_frame() {
+		if (frameSize == RNAV_LEDS_LEN)
+			return decode_leds();
+		return decode_data();
+	}
+
+	int decode_data() {
+
+		byte _LED_bitmask;
+		int receivedData = 0;
+		float payload[6];
+		int payload_len = 6;
+		uint8_t chk = 0;
+		static uint8_t last_chk;
+
+		for (int i = 0; i < RNAV_FRAME_LEN-1; i++)
+			chk ^= frame[i];
+
+		for (int i = 0; i<payload_len; i++) {
+
+			union {
+				uint8_t b[4];
+				float f;
+			} pld;
+
+			pld.b[0] = frame[RNAV_HEADER_LEN + 4*i];
+			pld.b[1] = frame[RNAV_HEADER_LEN + 4*i + 1];
+			pld.b[2] = frame[RNAV_HEADER_LEN + 4*i + 2];
+			pld.b[3] = frame[RNAV_HEADER_LEN + 4*i + 3];
+
+			payload[i] = pld.f;
+		}
+
+		// read the bitmask that gives the LEDs in the field of view
+		_LED_bitmask = frame[RNAV_FRAME_LEN-2];
+
+		// compare checksums
+		if (frame[RNAV_FRAME_LEN-1] == chk) {
+			receivedData = 1;  // we at least received data
+			frames++;
+#if HIL_MODE==HIL_MODE_ATTITUDE
+			LED_bitmask = _LED_bitmask;
+#else
+			LED_bitmask = 0xFF;
+#endif
+			if ((LED_bitmask & 0x1F) == MASK_LED_ALL) {
+				if (isnan(payload[0]) || (chk == last_chk))  // expect NaN on failed pose estimate (Or an IDENTICAL estimate to previous frame (which will give us an identical checksum))
+				{
+					trace_event(TRACE_RNAV_ZOH, LED_bitmask);
+					receivedData = 2;  // signifies ZOH
+				} else {
+
+				// Everything worked -- YAY!  :)
+				dx_b.x		= payload[0];
+				dx_b.y		= payload[1];
+				dx_b.z		= payload[2];
+				dphi		= payload[3];
+				dtheta		= payload[4];
+				dpsi		= payload[5];
+
+				last_chk = chk;
+				timer = millis();  // reset the timer
+				newFix = true;
+				hold_leader_attitude();
+
+				trace_pose();
 				}
 
 			} else {
-				// checksum did not match read value
-				DBG_PRINTLN("BAD_CHKSM");
+				// not all LEDs in the frame
+				trace_event(TRACE_RNAV_LEDS_MISSING, LED_bitmask);
 			}
 
 		} else {
-			// the entire message is not available
-			DBG_PRINTLN("NO_MSG");
+			// checksum did not match read value
+			drops++;
+			trace_event(TRACE_RNAV_BAD_CHKSM, RELNAV_DATA_HEADER[0]);
 		}
 
-		// request data for next time
-		if (rNAVSerial->available() > 2*expected_len)
-			rNAVSerial->readBytes(NULL,rNAVSerial->available() - 2*expected_len);
-		rNAVSerial->println("HHHHH");
+		return receivedData;
+	}
 
+	// decode a frame of raw LED centroids and solve for the relative
+	// state on board. Unlike DATA frames, partial views still give a
+	// position fix as long as the leader attitude is recent
+	int decode_leds() {
+		struct relnav_leds pkt;
+		static uint8_t last_chk;
+
+		memcpy(&pkt, frame, sizeof(pkt));
+		if (pkt.chk != relnav_checksum(&pkt, sizeof(pkt))) {
+			drops++;
+			trace_event(TRACE_RNAV_BAD_CHKSM, RELNAV_LEDS_HEADER[0]);
+			return 0;
+		}
+		frames++;
+		LED_bitmask = pkt.led_mask & MASK_LED_ALL;
 
-		return receivedData;
-	} // end #MD
+		if (ledPose == NULL || ahrs == NULL || pkt.chk == last_chk) {
+			trace_event(TRACE_RNAV_ZOH, LED_bitmask);
+			return 2;
+		}
+
+		uint8_t count = 0;
+		for (uint8_t i = 0; i < 5; i++) {
+			if (LED_bitmask & (1<<i))
+				count++;
+		}
+
+		Matrix3<float> dcm = ahrs->get_dcm_matrix();
+		bool solved = false;
+		bool full = false;
+
+		if (count >= 4) {
+			full = ledPose->solve(pkt.centroid, LED_bitmask);
+			solved = full;
+		}
+		Matrix3<float> leader;
+		if (!solved && count >= 2 && leader_attitude(leader)) {
+			// relative attitude from the follower attitude now and the
+			// leader attitude held from the last full pose
+			Matrix3<float> rel = dcm.transposed() * leader;
+			const float rotation[3][3] = {
+				{ rel.a.x, rel.a.y, rel.a.z },
+				{ rel.b.x, rel.b.y, rel.b.z },
+				{ rel.c.x, rel.c.y, rel.c.z }
+			};
+			solved = ledPose->solve_position(pkt.centroid, LED_bitmask, rotation);
+		}
+		if (!solved) {
+			trace_event(TRACE_RNAV_ZOH, LED_bitmask);
+			return 2;
+		}
+
+		float pos[3], roll, pitch, yaw;
+		ledPose->get_position(pos);
+		ledPose->get_euler(&roll, &pitch, &yaw);
+		dx_b.x	= pos[0];
+		dx_b.y	= pos[1];
+		dx_b.z	= pos[2];
+		dphi	= ToDeg(roll);
+		dtheta	= ToDeg(pitch);
+		dpsi	= ToDeg(yaw);
+
+		last_chk = pkt.chk;
+		timer = millis();
+		newFix = true;
+		if (full)
+			hold_leader_attitude();
+		trace_pose();
+
+		return 1;
+	}
+
+	void trace_event(uint8_t id, uint8_t arg = 0) {
+		if (tracer != NULL)
+			tracer->event(id, arg);
+	}
+
+	// the relative state of a new fix, as two records
+	void trace_pose() {
+		if (tracer == NULL)
+			return;
+		tracer->event(TRACE_RNAV_POS, LED_bitmask, dx_b.x, dx_b.y, dx_b.z);
+		tracer->event(TRACE_RNAV_ATT, LED_bitmask, dphi, dtheta, dpsi);
+	}
+
+	// remember the leader attitude in the earth frame, so partial LED
+	// fixes can follow the follower's own attitude changes
+	void hold_leader_attitude() {
+		if (ahrs == NULL)
+			return;
+		Matrix3<float> rel;
+		rel.from_euler(ToRad(dphi), ToRad(dtheta), ToRad(dpsi));
+		leaderDCM = ahrs->get_dcm_matrix() * rel;
+		leaderTimer = millis();
+		haveLeader = true;
+	}
+
+	// leader attitude in the earth frame, held from the last full pose
+	// or else from the leader's own broadcast
+	bool leader_attitude(Matrix3<float> &m) {
+		if (haveLeader && (millis() - leaderTimer) < RNAV_ATTITUDE_HOLD) {
+			m = leaderDCM;
+			return true;
+		}
+		if (haveLeaderState && (millis() - leaderRxTime) < RNAV_LEADER_TIMEOUT) {
+			m.from_euler(ToRad((leaderRoll*0.01)), ToRad((leaderPitch*0.01)), ToRad((leaderYaw*0.01)));
+			return true;
+		}
+		return false;
+	}
+
+	// position of the leader relative to us from both GPS fixes, each
+	// extrapolated to now with its velocity. NED, metres
+	bool gps_relative(Vector3<float> &rel) {
+		if (gps == NULL || *gps == NULL || !haveLeaderState)
+			return false;
+
+		GPS *g = *gps;
+		uint32_t tnow = millis();
+		if (tnow - leaderRxTime > RNAV_LEADER_TIMEOUT || g->status() != GPS::GPS_OK)
+			return false;
+
+		float dt_leader = constrain((int32_t)(tnow - leaderFixTime), 0, 1000) * 0.001;
+		float dt_own = constrain((int32_t)(tnow - g->last_fix_time), 0, 1000) * 0.001;
+		float scale = cos(ToRad((g->latitude * 1.0e-7)));
+
+		rel.x = (leaderLat - g->latitude) * RNAV_LATLON_TO_M;
+		rel.y = (leaderLng - g->longitude) * RNAV_LATLON_TO_M * scale;
+		rel.z = (g->altitude - leaderAlt) * 0.01;
+		rel += leaderVel * dt_leader;
+		rel -= Vector3<float>(g->velocity_north(), g->velocity_east(), g->velocity_down()) * dt_own;
+		return true;
+	}
+
+	// track the GPS bias against vision fixes, and navigate on the
+	// corrected GPS solution once vision has been lost for a while.
+	// Returns true if the relative state was updated from GPS
+	bool gps_update(bool vision) {
+		Vector3<float> rel;
+		if (ahrs == NULL || !gps_relative(rel))
+			return false;
+
+		Matrix3<float> dcm = ahrs->get_dcm_matrix();
+		if (vision) {
+			Vector3<float> err = dcm * dx_b * 0.0254 - rel;
+			if (haveBias)
+				gpsBias += (err - gpsBias) * RNAV_GPS_BIAS_GAIN;
+			else
+				gpsBias = err;
+			haveBias = true;
+			return false;
+		}
+		if (millis() - visionTimer < RNAV_GPS_FALLBACK)
+			return false;
+
+		float roll, pitch, yaw;
+		Matrix3<float> leader;
+		leader.from_euler(ToRad((leaderRoll*0.01)), ToRad((leaderPitch*0.01)), ToRad((leaderYaw*0.01)));
+		(dcm.transposed() * leader).to_euler(&roll, &pitch, &yaw);
+
+		dx_b = dcm.transposed() * (rel + gpsBias) * 39.37;
+		dphi = ToDeg(roll);
+		dtheta = ToDeg(pitch);
+		dpsi = ToDeg(yaw);
+
+		timer = millis();
+		newFix = true;
+		gpsFallback = true;
+		return true;
+	}
+
+	// send a credit/ack frame to the vision computer. The credit is the
+	// number of whole frames that fit in the free receive buffer space,
+	// and the rate is the number of good frames received over the last
+	// second
+	void send_ack() {
+		struct relnav_ack ack;
+		int16_t space;
+		uint32_t tnow = millis();
+
+		if (tnow - rateTimer >= 1000) {
+			rate = (frames > 255) ? 255 : frames;
+			frames = 0;
+			rateTimer = tnow;
+		}
+
+		// never block the medium loop on a full transmit buffer. The
+		// credit is granted on a later update, and the drops are kept
+		// for it
+		if (rNAVSerial->txspace() < (int)sizeof(ack))
+			return;
+
+		space = rxSpace - 1 - rNAVSerial->available() - frameLen;
+		if (space < 0)
+			space = 0;
+
+		memcpy(ack.header, RELNAV_ACK_HEADER, sizeof(ack.header));
+		ack.seq = ackSeq++;
+		ack.credit = space / ((ledPose != NULL) ? RNAV_LEDS_LEN : RNAV_FRAME_LEN);
+		ack.rate = rate;
+		ack.drops = (drops > 255) ? 255 : drops;
+		ack.chk = relnav_checksum(&ack, sizeof(ack));
+
+		rNAVSerial->write((const uint8_t *)&ack, sizeof(ack));
+		drops = 0;
+	}
+
+public:
+
+	// send the leader pose predicted for the next camera frame, so the
+	// vision computer can limit its LED search to a region of interest.
+	// The last pose is rotated by the attitude change since it arrived,
+	// then by the body rates over one frame period
+	void send_prediction(const Matrix3<float> &dcm, const Vector3<float> &gyro) {
+		struct relnav_pred pred;
+		float period, roll, pitch, yaw;
+
+		if (newFix) {
+			fixDCM = dcm;
+			newFix = false;
+		}
+
+		if (!roi || timeout || rNAVSerial == NULL)
+			return;
+
+		// never block the medium loop on a full transmit buffer
+		if (rNAVSerial->txspace() < (int)sizeof(pred))
+			return;
+
+		// one camera frame ahead; in poll mode a frame per update
+		period = (push && rate > 0) ? 1.0/rate : 0.1;
+
+		// rotation from the body frame of the last pose to the current one
+		Matrix3<float> rot = dcm.transposed() * fixDCM;
+		rot.to_euler(&roll, &pitch, &yaw);
+
+		Vector3<float> ahead = gyro * period;
+		Vector3<float> dx = rot * dx_b;
+		dx -= ahead % dx;
+
+		memcpy(pred.header, RELNAV_PRED_HEADER, sizeof(pred.header));
+		pred.horizon_ms = (millis() - timer) + 1000*period;
+		pred.x = dx.x;
+		pred.y = dx.y;
+		pred.z = dx.z;
+		pred.bank = dphi + ToDeg((roll - ahead.x));
+		pred.pitch = dtheta + ToDeg((pitch - ahead.y));
+		pred.hdg = dpsi + ToDeg((yaw - ahead.z));
+		pred.p = gyro.x;
+		pred.q = gyro.y;
+		pred.r = gyro.z;
+		pred.led_mask = LED_bitmask;
+		pred.chk = relnav_checksum(&pred, sizeof(pred));
+
+		rNAVSerial->write((const uint8_t *)&pred, sizeof(pred));
+	}
 
 };
 
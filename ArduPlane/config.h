@@ -80,6 +80,9 @@
  #ifndef CAMERA
  # define CAMERA DISABLED
  #endif
+ #ifndef AHRS_QUATERNION				//#MD no log to compare it in
+ # define AHRS_QUATERNION DISABLED
+ #endif
 #endif
 
 //////////////////////////////////////////////////////////////////////////////
@@ -183,6 +186,19 @@
  #define HIL_MODE        HIL_MODE_DISABLED
 #endif
 
+//////////////////////////////////////////////////////////////////////////////
+// AHRS_QUATERNION                          OPTIONAL
+//
+// Run the quaternion Kalman filter AHRS alongside DCM. AHRS_QUAT_USE
+// selects which one flies the aircraft
+#ifndef AHRS_QUATERNION
+ # define AHRS_QUATERNION ENABLED
+#endif
+#if HIL_MODE == HIL_MODE_ATTITUDE
+ # undef AHRS_QUATERNION
+ # define AHRS_QUATERNION DISABLED
+#endif
+
 #if HIL_MODE != HIL_MODE_DISABLED       // we are in HIL mode
  # undef GPS_PROTOCOL
  # define GPS_PROTOCOL GPS_PROTOCOL_NONE
@@ -221,6 +237,70 @@
  # define SERIAL3_BAUD                    57600
 #endif
 
+//////////////////////////////////////////////////////////////////////////////
+// Rel NAV port protocol and buffer sizes						//#MD
+//
+#ifndef RNAV_PUSH
+# define RNAV_PUSH						0
+#endif
+#ifndef RNAV_RX_BUFSIZE
+# define RNAV_RX_BUFSIZE				64
+#endif
+#ifndef RNAV_TX_BUFSIZE
+# define RNAV_TX_BUFSIZE				1
+#endif
+// smallest transmit buffer in push mode, with room for an ack frame
+#ifndef RNAV_PUSH_TX_BUFSIZE
+# define RNAV_PUSH_TX_BUFSIZE			16
+#endif
+#ifndef RNAV_ROI
+# define RNAV_ROI						0
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// Rel NAV on board pose solution									//#MD
+//
+// Camera intrinsics and the leader's LED positions, in inches in the
+// leader body frame, in the order of the RELNAV_LED_* bits
+//
+#ifndef RNAV_LEDS
+# define RNAV_LEDS						0
+#endif
+#ifndef RNAV_CAM_F
+# define RNAV_CAM_F						700.0
+#endif
+#ifndef RNAV_CAM_CX
+# define RNAV_CAM_CX					320.0
+#endif
+#ifndef RNAV_CAM_CY
+# define RNAV_CAM_CY					240.0
+#endif
+#ifndef RNAV_SPD_FF
+# define RNAV_SPD_FF					0
+#endif
+#ifndef RNAV_SEP_GAIN
+# define RNAV_SEP_GAIN					0.2
+#endif
+#ifndef RNAV_CAPTURE
+# define RNAV_CAPTURE					0
+#endif
+#ifndef RNAV_LED_POSITIONS
+# define RNAV_LED_POSITIONS	{	{   0, -36,   0 },	/* left wingtip */	\
+								{   0,  36,   0 },	/* right wingtip */	\
+								{  18,   0,   0 },	/* nose */			\
+								{ -30,   0,  -2 },	/* tail */			\
+								{ -28,   0, -12 } }	/* fin top */
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// GCS_RECEIVE_BLOCK
+//
+// number of bytes pulled from a GCS port per read in GCS_MAVLINK::update()
+//
+#ifndef GCS_RECEIVE_BLOCK
+ # define GCS_RECEIVE_BLOCK               32
+#endif
+
 
 //////////////////////////////////////////////////////////////////////////////
 // Battery monitoring
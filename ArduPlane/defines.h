@@ -124,6 +124,7 @@ enum ap_message {
     MSG_SIMSTATE,
     MSG_HWSTATUS,
     MSG_WIND,
+    MSG_LEADER_STATE,
     MSG_RETRY_DEFERRED // this must be last
 };
 
@@ -148,6 +149,11 @@ enum gcs_severity {
 #define LOG_STARTUP_MSG                 0x0A
 #define LOG_RNAV_MSG					0x0B   //#MD
 #define LOG_LED_MSG						0x0C   //#MD
+#define LOG_AHRS2_MSG                   0x0D
+#define LOG_IMU_MSG                     0x0E
+#define LOG_TRACE_MSG                   0x0F
+#define LOG_RNAV_RAW_MSG                0x10
+#define LOG_TOPIC_MSG                   0x11
 #define TYPE_AIRSTART_MSG               0x00
 #define TYPE_GROUNDSTART_MSG    0x01
 #define MAX_NUM_LOGS                    100
@@ -164,6 +170,10 @@ enum gcs_severity {
 #define MASK_LOG_CUR                    (1<<9)
 #define MASK_LOG_RNAV					(1<<10)   //#MD  Add bitmask for RNAV logs
 #define MASK_LOG_LEDS					(1<<11)   //#MD  Add bitmask for LED logs
+#define MASK_LOG_AHRS2                  (1<<12)
+#define MASK_LOG_IMU                    (1<<13)
+#define MASK_LOG_TRACE                  (1<<14)
+#define MASK_LOG_TOPICS                 (1<<15)
 
 // Waypoint Modes
 // ----------------
@@ -1,5 +1,31 @@
 // -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
 
+//****************************************************************
+// Fly the formation slot assigned to this aircraft, or TGT_SEPTN
+// behind the leader if it has none. Slots must be behind the leader
+// for the camera to see it
+//****************************************************************
+static void update_formation_slot()
+{
+	Vector3f offset;
+
+	if (g.formation.get_offset(g.sysid_this_mav, offset) && offset.x < 0) {
+		rNav->set_slot(offset);
+		target_separation_cm = -100 * offset.x;
+	} else {
+		rNav->clear_slot();
+		target_separation_cm = 100 * g.target_separation;
+	}
+}
+
+//****************************************************************
+// Level distance past the slot (cm), positive when too far behind
+//****************************************************************
+static void calc_separation_error()
+{
+	distance_error = rNav->get_level_dist() - target_separation_cm;
+}
+
 //****************************************************************
 // Function that will calculate the desired direction to fly and distance
 //****************************************************************
@@ -109,6 +135,17 @@ static void calc_airspeed_errors()
         target_airspeed_cm += airspeed_nudge_cm;
     }
 
+    // REL_NAV: the leader's airspeed, estimated from ours and the		#MD
+    // closing rate, plus a correction for the separation error. As a
+    // feed-forward, the throttle and pitch react to a change of the
+    // leader's speed as soon as the closing rate sees it
+    if (control_mode == REL_NAV && g.rnav_spd_ff && !rNav->is_timedout()) {
+        calc_separation_error();
+        target_airspeed_cm = aspeed_cm + rNav->get_range_rate() + g.rnav_sep_gain * distance_error;
+        if (target_airspeed_cm < (g.flybywire_airspeed_min * 100))
+            target_airspeed_cm = (g.flybywire_airspeed_min * 100);
+    }
+
     // Apply airspeed limit
     if (target_airspeed_cm > (g.flybywire_airspeed_max * 100))
         target_airspeed_cm = (g.flybywire_airspeed_max * 100);
@@ -101,10 +101,6 @@ static void init_ardupilot()
                          "\n\nFree RAM: %u\n"),
                     memcheck_available_memory());
 
-	// Rel. NAV serial port								 // #MD
-	Serial2.begin(SERIAL2_BAUD, 64, 1);				     // #MD
-	rNav->setSerial(&Serial2);							 // #MD
-
     //
     // Initialize Wire and SPI libraries
     //
@@ -156,6 +152,35 @@ static void init_ardupilot()
 
     mavlink_system.sysid = g.sysid_this_mav;
 
+	// Rel. NAV serial port								 // #MD
+	uint16_t rnav_tx_buf = g.rnav_tx_buf;				 // #MD
+	if (g.rnav_push && rnav_tx_buf < RNAV_PUSH_TX_BUFSIZE)	// #MD
+		rnav_tx_buf = RNAV_PUSH_TX_BUFSIZE;				 // #MD room for the acks
+	Serial2.begin(map_baudrate(g.serial2_baud, SERIAL2_BAUD), g.rnav_rx_buf, rnav_tx_buf);	// #MD
+	rnav_tap.set_port(&Serial2);						 // #MD
+#ifdef DESKTOP_BUILD
+	float replay_speed;
+	if (sitl_stream_replay(&replay_speed) != NULL) {
+		rnav_replay.start(rnav_raw_next, replay_speed);
+		rnav_tap.set_port(&rnav_replay);
+	}
+	if (sitl_relnav_shm() != NULL) {
+		rNav->setShared(sitl_relnav_shm());
+	}
+#endif
+	rNav->setSerial(&rnav_tap, g.rnav_push, g.rnav_rx_buf);	 // #MD
+	rNav->set_roi(g.rnav_roi);							 // #MD
+	if (g.rnav_leds) {									 // #MD
+		ledPose.set_camera(g.rnav_cam_f, g.rnav_cam_f, g.rnav_cam_cx, g.rnav_cam_cy);
+		ledPose.set_leds(rnav_led_positions);
+		ledPose.set_tracking(true);
+		rNav->set_pose_solver(&ledPose, &ahrs);
+	}
+	rNav->set_leader_link(&g_gps, &ahrs);				 // #MD
+	rNav->set_trace(&trace);							 // #MD
+	update_formation_slot();							 // #MD
+	g.rnav_sched.update(g.k1_bank, g.k3_bank, g.k5_bank);	 // #MD
+
 #if LOGGING_ENABLED == ENABLED
     DataFlash.Init();           // DataFlash log initialization
     if (!DataFlash.CardInserted()) {
@@ -168,6 +193,9 @@ static void init_ardupilot()
     if (g.log_bitmask != 0) {
         DataFlash.start_new_log();
     }
+
+    // full rate IMU samples are captured from the sensor interrupt
+    ins.set_raw_sample_callback(raw_imu_capture);
 #endif
 
 #if HIL_MODE != HIL_MODE_ATTITUDE
@@ -530,7 +558,7 @@ static uint32_t map_baudrate(int8_t rate, uint32_t default_baud)
     case 111:  return 111100;
     case 115:  return 115200;
     }
-    cliSerial->println_P(PSTR("Invalid SERIAL3_BAUD"));
+    cliSerial->println_P(PSTR("Invalid baud rate"));
     return default_baud;
 }
 
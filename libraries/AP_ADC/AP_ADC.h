@@ -46,6 +46,12 @@ public:
 
     virtual uint16_t        num_samples_available(const uint8_t *channel_numbers) = 0;
 
+    /* set a function to be called from the timer process with the
+     *  raw values of all channels each time they are read. Not all
+     *  ADCs support this
+     */
+    virtual void            set_sample_callback(void (*)(const uint16_t *adc)) {}
+
 private:
 };
 
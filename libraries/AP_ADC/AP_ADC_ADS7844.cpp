@@ -61,15 +61,12 @@ extern "C" {
 // Commands for reading ADC channels on ADS7844
 static const unsigned char adc_cmd[9]              = { 0x87, 0xC7, 0x97, 0xD7, 0xA7, 0xE7, 0xB7, 0xF7, 0x00 };
 
-// the sum of the values since last read
-static volatile uint32_t _sum[8];
+// running totals of each channel, kept in the topic and only changed
+// by the timer process
+AP_TopicOf<struct sensor_adc> sensor_adc_topic(SENSOR_TOPIC_ADC);
 
-// how many values we've accumulated since last read
-static volatile uint16_t _count[8];
-
-// variables to calculate time period over which a group of samples were collected
-static volatile uint32_t _ch6_delta_time_start_micros = 0;  // time we start collecting sample (reset on update)
-static volatile uint32_t _ch6_last_sample_time_micros = 0;  // time latest sample was collected
+// called with the raw channel values after each read
+static void (*_sample_cb)(const uint16_t *adc);
 
 // TCNT2 values for various interrupt rates,
 // assuming 256 prescaler. Note that these values
@@ -92,46 +89,52 @@ static inline unsigned char ADC_SPI_transfer(unsigned char data)
 
 void AP_ADC_ADS7844::read(uint32_t tnow)
 {
+    uint16_t v[8];
     uint8_t ch;
 
     bit_clear(PORTC, 4);                                                        // Enable Chip Select (PIN PC4)
     ADC_SPI_transfer(adc_cmd[0]);                                               // Command to read the first channel
 
     for (ch = 0; ch < 8; ch++) {
-        uint16_t v;
+        v[ch] = ADC_SPI_transfer(0) << 8;                // Read first byte
+        v[ch] |= ADC_SPI_transfer(adc_cmd[ch + 1]);      // Read second byte and send next command
+    }
 
-        v = ADC_SPI_transfer(0) << 8;                    // Read first byte
-        v |= ADC_SPI_transfer(adc_cmd[ch + 1]);          // Read second byte and send next command
+    bit_set(PORTC, 4);                                          // Disable Chip Select (PIN PC4)
 
-        if (v & 0x8007) {
+    struct sensor_adc *t = sensor_adc_topic.begin_publish();
+    for (ch = 0; ch < 8; ch++) {
+        if (v[ch] & 0x8007) {
             // this is a 12-bit ADC, shifted by 3 bits.
             // if we get other bits set then the value is
-            // bogus and should be ignored
+            // bogus. Count the last good value again, so the
+            // channels keep sharing one count
+            t->sum[ch] += t->raw[ch];
             continue;
         }
 
-        if (++_count[ch] == 0) {
-            // overflow ... shouldn't happen too often
-            // unless we're just not using the
-            // channel. Notice that we overflow the count
-            // to 1 here, not zero, as otherwise the
-            // reader below could get a division by zero
-            _sum[ch] = 0;
-            _count[ch] = 1;
-        }
-        _sum[ch] += (v >> 3);
+        // the totals wrap, the readers only use differences
+        t->sum[ch] += (v[ch] >> 3);
+        t->raw[ch] = (v[ch] >> 3);
     }
+    t->count++;
 
-    bit_set(PORTC, 4);                                          // Disable Chip Select (PIN PC4)
+    // publish with the time of this sample
+    sensor_adc_topic.end_publish(micros());
 
-    // record time of this sample
-    _ch6_last_sample_time_micros = micros();
+    if (_sample_cb != NULL) {
+        _sample_cb(t->raw);
+    }
 }
 
 
 // Constructors ////////////////////////////////////////////////////////////////
-AP_ADC_ADS7844::AP_ADC_ADS7844()
+AP_ADC_ADS7844::AP_ADC_ADS7844() :
+    _ch6_time_us(0)
 {
+    memset(_used_sum, 0, sizeof(_used_sum));
+    memset(_used_count, 0, sizeof(_used_count));
+    memset(_used_time_us, 0, sizeof(_used_time_us));
 }
 
 // Public Methods //////////////////////////////////////////////////////////////
@@ -153,55 +156,66 @@ void AP_ADC_ADS7844::Init( AP_PeriodicProcess * scheduler )
     UBRR2 = 2;          // SPI clock running at 2.6MHz
 
     // get an initial value for each channel. This ensures
-    // _count[] is never zero
+    // there is always a value to read
+    struct sensor_adc *t = sensor_adc_topic.begin_publish();
     for (uint8_t i=0; i<8; i++) {
         uint16_t adc_tmp;
         adc_tmp  = ADC_SPI_transfer(0) << 8;
         adc_tmp |= ADC_SPI_transfer(adc_cmd[i + 1]);
-        _count[i] = 1;
-        _sum[i]   = adc_tmp;
+        t->sum[i]   = adc_tmp;
+        t->raw[i]   = adc_tmp;
     }
-
-    _ch6_last_sample_time_micros = micros();
+    t->count = 1;
+    sensor_adc_topic.end_publish(micros());
 
     scheduler->resume_timer();
     scheduler->register_process( AP_ADC_ADS7844::read );
 
 }
 
-// Read one channel value
-float AP_ADC_ADS7844::Ch(uint8_t ch_num)
+// true if channel ch has not been averaged for so long that its
+// count may have wrapped
+bool AP_ADC_ADS7844::_long_gap(uint8_t ch, uint32_t time_us)
 {
-    uint16_t count;
-    uint32_t sum;
+    return time_us - _used_time_us[ch] > SENSOR_MAX_AVERAGE_US;
+}
 
-    // ensure we have at least one value
-    while (_count[ch_num] == 0) /* noop */;
+// average the values of channel ch since it was last used, or take
+// the newest value after a long gap
+float AP_ADC_ADS7844::_average(const struct sensor_adc &s, uint32_t time_us, uint8_t ch)
+{
+    float v;
+    if (_long_gap(ch, time_us)) {
+        v = s.raw[ch];
+    } else {
+        uint16_t count = s.count     - _used_count[ch];
+        uint32_t sum   = s.sum[ch]   - _used_sum[ch];
+        v = ((float)sum)/count;
+    }
+    _used_count[ch]   = s.count;
+    _used_sum[ch]     = s.sum[ch];
+    _used_time_us[ch] = time_us;
+    return v;
+}
 
-    // grab the value with interrupts disabled, and clear the count
-    uint8_t oldSREG = SREG;
-    cli();
-    count = _count[ch_num];
-    sum   = _sum[ch_num];
-    _count[ch_num] = 0;
-    _sum[ch_num]   = 0;
+// Read one channel value
+float AP_ADC_ADS7844::Ch(uint8_t ch_num)
+{
+    struct sensor_adc s;
+    uint32_t time_us;
 
-    SREG = oldSREG;
+    // wait for at least one new value
+    do {
+        sensor_adc_topic.read(s, &time_us);
+    } while (s.count == _used_count[ch_num] && !_long_gap(ch_num, time_us));
 
-    return ((float)sum)/count;
+    return _average(s, time_us, ch_num);
 }
 
 // see if Ch6() can return new data
 bool AP_ADC_ADS7844::new_data_available(const uint8_t *channel_numbers)
 {
-    uint8_t i;
-
-    for (i=0; i<6; i++) {
-        if (_count[channel_numbers[i]] == 0) {
-            return false;
-        }
-    }
-    return true;
+    return num_samples_available(channel_numbers) != 0;
 }
 
 
@@ -212,55 +226,55 @@ bool AP_ADC_ADS7844::new_data_available(const uint8_t *channel_numbers)
 // then you will get very strange results
 uint32_t AP_ADC_ADS7844::Ch6(const uint8_t *channel_numbers, float *result)
 {
-    uint16_t count[6];
-    uint32_t sum[6];
+    struct sensor_adc s;
+    uint32_t time_us;
     uint8_t i;
 
-    // ensure we have at least one value
-    for (i=0; i<6; i++) {
-        while (_count[channel_numbers[i]] == 0) /* noop */;
-    }
-
-    // grab the values with interrupts disabled, and clear the counts
-    uint8_t oldSREG = SREG;
-    cli();
-    for (i=0; i<6; i++) {
-        count[i] = _count[channel_numbers[i]];
-        sum[i]   = _sum[channel_numbers[i]];
-        _count[channel_numbers[i]] = 0;
-        _sum[channel_numbers[i]]   = 0;
-    }
-
-    // calculate the delta time.
-    // we do this before re-enabling interrupts because another sensor read could fire immediately and change the _last_sensor_time value
-    uint32_t ret = _ch6_last_sample_time_micros - _ch6_delta_time_start_micros;
-    _ch6_delta_time_start_micros = _ch6_last_sample_time_micros;
-
-    SREG = oldSREG;
+    // ensure we have at least one new value of each channel
+    do {
+        sensor_adc_topic.read(s, &time_us);
+        for (i=0; i<6; i++) {
+            uint8_t ch = channel_numbers[i];
+            if (s.count == _used_count[ch] && !_long_gap(ch, time_us)) {
+                break;
+            }
+        }
+    } while (i < 6);
 
-    // calculate averages. We keep this out of the cli region
-    // to prevent us stalling the ISR while doing the
-    // division. That costs us 36 bytes of stack, but I think its
-    // worth it.
     for (i = 0; i < 6; i++) {
-        result[i] = sum[i] / (float)count[i];
+        result[i] = _average(s, time_us, channel_numbers[i]);
     }
 
     // return number of microseconds since last call
+    uint32_t ret = time_us - _ch6_time_us;
+    _ch6_time_us = time_us;
     return ret;
 }
 
 /// Get minimum number of samples read from the sensors
 uint16_t AP_ADC_ADS7844::num_samples_available(const uint8_t *channel_numbers)
 {
-    // get count of first channel as a base
-    uint16_t min_count = _count[channel_numbers[0]];
-
-    // reduce to minimum count of all other channels
-    for (uint8_t i=1; i<6; i++) {
-        if (_count[channel_numbers[i]] < min_count) {
-            min_count = _count[channel_numbers[i]];
+    struct sensor_adc s;
+    uint32_t time_us;
+    sensor_adc_topic.read(s, &time_us);
+
+    // reduce to minimum count of all the channels. A channel that
+    // has not been read for a long time has plenty, whatever its
+    // wrapped count says
+    uint16_t min_count = 0xFFFF;
+    for (uint8_t i=0; i<6; i++) {
+        uint8_t ch = channel_numbers[i];
+        uint16_t count = s.count - _used_count[ch];
+        if (count < min_count && !_long_gap(ch, time_us)) {
+            min_count = count;
         }
     }
     return min_count;
 }
+
+// set a function to be called from the timer process with the raw
+// value of every channel each time they are read
+void AP_ADC_ADS7844::set_sample_callback(void (*cb)(const uint16_t *adc))
+{
+    _sample_cb = cb;
+}
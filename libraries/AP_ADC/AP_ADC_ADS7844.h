@@ -16,6 +16,7 @@
 
 #include "AP_ADC.h"
 #include "../AP_PeriodicProcess/AP_PeriodicProcess.h"
+#include "../AP_SensorBus/AP_SensorBus.h"
 #include <inttypes.h>
 
 class AP_ADC_ADS7844 : public AP_ADC
@@ -36,8 +37,21 @@ public:
     // Get minimum number of samples read from the sensors
     uint16_t            num_samples_available(const uint8_t *channel_numbers);
 
+    // call cb with the 8 raw channel values after each read
+    void                set_sample_callback(void (*cb)(const uint16_t *adc));
+
 private:
     static void         read(uint32_t);
+    bool                _long_gap(uint8_t ch, uint32_t time_us);
+    float               _average(const struct sensor_adc &s, uint32_t time_us, uint8_t ch);
+
+    // the channel totals already averaged by Ch() and Ch6(), and the
+    // time each channel was last averaged
+    uint32_t            _used_sum[8];
+    uint16_t            _used_count[8];
+    uint32_t            _used_time_us[8];
+    // time of the newest sample used by Ch6()
+    uint32_t            _ch6_time_us;
 
 };
 
@@ -198,6 +198,7 @@ protected:
 };
 
 #include <AP_AHRS_DCM.h>
+#include <AP_AHRS_Quaternion.h>
 #include <AP_AHRS_MPU6000.h>
 #include <AP_AHRS_HIL.h>
 
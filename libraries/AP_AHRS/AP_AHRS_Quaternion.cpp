@@ -0,0 +1,514 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+ *       AP_AHRS_Quaternion.cpp
+ *
+ *       AHRS system using a quaternion attitude and a 6 state
+ *       error-state Kalman filter (attitude error and gyro bias).
+ *       The accelerometers, corrected for GPS or airspeed derived
+ *       acceleration, give the roll/pitch reference and the compass
+ *       or GPS ground course gives the yaw reference.
+ *
+ *       The DCM estimator runs alongside on the same IMU samples.
+ *
+ *       This library is free software; you can redistribute it and/or
+ *       modify it under the terms of the GNU Lesser General Public License
+ *       as published by the Free Software Foundation; either version 2.1
+ *       of the License, or (at your option) any later version.
+ */
+#include <FastSerial.h>
+#include <AP_AHRS.h>
+
+// this is the speed in cm/s above which we use the GPS ground
+// course as a yaw reference
+#define GPS_SPEED_MIN 300
+
+// gyro noise in rad/s, used for attitude process noise
+#define QUAT_GYRO_NOISE     0.02
+
+// accelerometer noise in units of gravity
+#define QUAT_ACCEL_NOISE    0.05
+
+// heading noise of the compass and GPS ground course in radians
+#define QUAT_COMPASS_NOISE  0.1
+#define QUAT_GPS_YAW_NOISE  0.2
+
+// initial attitude uncertainty in radians and gyro bias uncertainty
+// in rad/s
+#define QUAT_INIT_ATT_SD    0.3
+#define QUAT_INIT_BIAS_SD   0.02
+
+// table of user settable parameters
+const AP_Param::GroupInfo AP_AHRS_Quaternion::var_info[] PROGMEM = {
+    // @Param: QUAT_USE
+    // @DisplayName: AHRS use quaternion estimator
+    // @Description: This controls whether the quaternion Kalman filter attitude is used by the flight code instead of DCM. Both estimators run and are logged when the quaternion AHRS is built in
+    // @Values: 0:Use DCM,1:Use Quaternion
+    // @User: Advanced
+    AP_GROUPINFO("QUAT_USE",  0,    AP_AHRS_Quaternion, _quat_use, 0),
+
+    AP_GROUPEND
+};
+
+// outer product of two vectors
+static Matrix3f outer(const Vector3f &u, const Vector3f &v)
+{
+    return Matrix3f(v * u.x, v * u.y, v * u.z);
+}
+
+// a diagonal matrix
+static Matrix3f diagonal(float d)
+{
+    return Matrix3f(d, 0, 0,
+                    0, d, 0,
+                    0, 0, d);
+}
+
+// wrap an angle in radians to -PI ~ PI
+static float wrap_angle(float angle)
+{
+    if (angle > PI) {
+        angle -= 2*PI;
+    } else if (angle < -PI) {
+        angle += 2*PI;
+    }
+    return angle;
+}
+
+// run a full DCM and quaternion update round
+void
+AP_AHRS_Quaternion::update(void)
+{
+    uint32_t start_us = micros();
+
+    // the DCM drift correction works on its own euler angles, not on
+    // whatever we reported to the flight code last time
+    roll  = _dcm_roll;
+    pitch = _dcm_pitch;
+    yaw   = _dcm_yaw;
+
+    // this also tells the IMU to grab some data
+    _in_dcm_update = true;
+    AP_AHRS_DCM::update();
+    _in_dcm_update = false;
+
+    set_dcm_outputs();
+
+    uint32_t dcm_done_us = micros();
+    _dcm_update_us = min(dcm_done_us - start_us, 0xFFFF);
+
+    // use the same IMU sample as DCM
+    float delta_t = _ins->get_delta_time();
+    if (delta_t > 0 && delta_t <= 0.2) {
+        if (!_initialised) {
+            init_attitude();
+        } else {
+            predict(delta_t);
+            fuse_accel();
+            fuse_yaw();
+        }
+    }
+
+    quat_euler_angles();
+
+    _quat_update_us = min(micros() - dcm_done_us, 0xFFFF);
+
+    if (using_quaternion()) {
+        roll         = _quat_roll;
+        pitch        = _quat_pitch;
+        yaw          = _quat_yaw;
+        roll_sensor  = _quat_sensor.x;
+        pitch_sensor = _quat_sensor.y;
+        yaw_sensor   = _quat_sensor.z;
+    }
+}
+
+// remember the DCM solution
+void
+AP_AHRS_Quaternion::set_dcm_outputs(void)
+{
+    _dcm_roll  = roll;
+    _dcm_pitch = pitch;
+    _dcm_yaw   = yaw;
+    _dcm_sensor.x = roll_sensor;
+    _dcm_sensor.y = pitch_sensor;
+    _dcm_sensor.z = yaw_sensor;
+}
+
+/*
+ *  reset the attitude. Used on ground start, on new IMU calibration
+ *  and by DCM on extreme errors in its own matrix, in which case we
+ *  leave the quaternion filter alone
+ */
+void
+AP_AHRS_Quaternion::reset(bool recover_eulers)
+{
+    AP_AHRS_DCM::reset(recover_eulers);
+    if (_in_dcm_update) {
+        return;
+    }
+
+    reset_filter();
+
+    if (recover_eulers && !isnan(roll) && !isnan(pitch) && !isnan(yaw)) {
+        _q.from_euler(roll, pitch, yaw);
+        _initialised = true;
+    } else {
+        // level again from the accels on the next update
+        _initialised = false;
+    }
+}
+
+// restart the quaternion filter from the DCM attitude, leaving DCM
+// itself alone. Used when the quaternion solution has gone bad
+void
+AP_AHRS_Quaternion::reset_from_dcm(void)
+{
+    Matrix3f m = AP_AHRS_DCM::get_dcm_matrix();
+
+    reset_filter();
+    if (m.is_nan()) {
+        // level again from the accels on the next update
+        _initialised = false;
+        return;
+    }
+    _q.from_rotation_matrix(m);
+    _q.normalize();
+}
+
+// reset the filter covariance and bias estimate
+void
+AP_AHRS_Quaternion::reset_filter(void)
+{
+    _gyro_bias.zero();
+    _omega.zero();
+    _P_att   = diagonal(sq(QUAT_INIT_ATT_SD));
+    _P_cross.zero();
+    _P_bias  = diagonal(sq(QUAT_INIT_BIAS_SD));
+}
+
+// set roll and pitch from the accels. Yaw comes from DCM if it has
+// already got a heading reference
+void
+AP_AHRS_Quaternion::init_attitude(void)
+{
+    Vector3f accel = _ins->get_accel();
+    if (accel.length() < 0.5 * _gravity) {
+        // wait for a sensible accel reading
+        return;
+    }
+
+    float init_roll  = atan2(-accel.y, -accel.z);
+    float init_pitch = atan2(accel.x, sqrt(sq(accel.y) + sq(accel.z)));
+    float init_yaw   = 0;
+
+    _have_quat_yaw = _have_initial_yaw;
+    if (_have_quat_yaw) {
+        init_yaw = _dcm_yaw;
+    }
+
+    _q.from_euler(init_roll, init_pitch, init_yaw);
+    reset_filter();
+    _initialised = true;
+}
+
+// integrate the gyros and propagate the error covariance
+void
+AP_AHRS_Quaternion::predict(float deltat)
+{
+    _omega = _ins->get_gyro() - _gyro_bias;
+
+    Vector3f delta_angle = _omega * deltat;
+    _q.rotate(delta_angle);
+    _q.normalize();
+
+    // state transition for the attitude error is the transpose of
+    // the small rotation we just applied, and the bias error feeds
+    // into the attitude error over the time step
+    Matrix3f F;
+    F.identity();
+    F.rotate(delta_angle);
+    F.transpose();
+
+    Matrix3f FB = F * _P_cross;
+    _P_att   = F * _P_att * F.transposed()
+               - (FB + FB.transposed()) * deltat
+               + _P_bias * sq(deltat)
+               + diagonal(sq(QUAT_GYRO_NOISE) * deltat);
+    _P_cross = FB - _P_bias * deltat;
+    _P_bias += diagonal(sq(_gyro_drift_limit) * deltat);
+}
+
+// work out the earth frame acceleration from the GPS velocity.
+// Returns false if the GPS can't be used
+bool
+AP_AHRS_Quaternion::update_gps_accel(void)
+{
+    if (!_gps || _gps->status() != GPS::GPS_OK || !_gps_use) {
+        _have_gps_velocity = false;
+        _gps_accel.zero();
+        return false;
+    }
+    if (_gps->last_fix_time == _gps_last_fix_time) {
+        // hold the last value until the next fix
+        return true;
+    }
+
+    Vector3f velocity = Vector3f(_gps->velocity_north(), _gps->velocity_east(), _gps->velocity_down());
+
+    // as with DCM, only use the barometer climb rate once it has
+    // enough samples to be smooth
+    if (_baro_use && _barometer != NULL && _barometer->get_pressure_samples() >= 5) {
+        // Z velocity is down
+        velocity.z = -_barometer->get_climb_rate();
+    }
+
+    float dt = (_gps->last_fix_time - _gps_last_fix_time) * 1.0e-3;
+    if (_have_gps_velocity && dt > 0 && dt < 1.0) {
+        _gps_accel = (velocity - _gps_last_velocity) / dt;
+        // limit vertical acceleration to 0.5 gravities. The
+        // barometer sometimes gives crazy acceleration changes
+        _gps_accel.z = constrain(_gps_accel.z, -0.5 * _gravity, 0.5 * _gravity);
+    } else {
+        _gps_accel.zero();
+    }
+
+    _gps_last_velocity = velocity;
+    _gps_last_fix_time = _gps->last_fix_time;
+    _have_gps_velocity = true;
+    return true;
+}
+
+// use the accelerometers as a reference for gravity. The predicted
+// specific force is gravity plus the GPS derived acceleration, or
+// the centripetal acceleration from the airspeed if there is no GPS
+void
+AP_AHRS_Quaternion::fuse_accel(void)
+{
+    Matrix3f rot;
+    _q.rotation_matrix(rot);
+
+    // apply trim
+    rot.rotate(_trim);
+
+    Vector3f force_ef = Vector3f(0, 0, -_gravity);
+    if (update_gps_accel()) {
+        force_ef += _gps_accel;
+    }
+
+    // gravity part of the prediction, which is what depends on the
+    // attitude
+    Vector3f h = rot.mul_transpose(force_ef) / _gravity;
+    Vector3f predicted = h;
+
+    if (!_have_gps_velocity && _fly_forward && _airspeed && _airspeed->use()) {
+        Vector3f velocity_bf = Vector3f(_airspeed->get_airspeed(), 0, 0);
+        predicted += (_omega % velocity_bf) / _gravity;
+    }
+
+    Vector3f measured = _ins->get_accel() / _gravity;
+    Vector3f innovation = measured - predicted;
+
+    if (innovation.is_nan() || innovation.is_inf()) {
+        return;
+    }
+
+    // trust the accels less when they see more than gravity and the
+    // acceleration we know about
+    float variance = sq(QUAT_ACCEL_NOISE) + sq(measured.length() - predicted.length());
+    if (_fast_ground_gains) {
+        variance *= 0.02;
+    }
+
+    // the measurement jacobian for the attitude error is the cross
+    // product matrix of the predicted gravity vector
+    _err_att.zero();
+    _err_bias.zero();
+    fuse(Vector3f(0, -h.z, h.y),   innovation.x, variance);
+    fuse(Vector3f(h.z, 0, -h.x),   innovation.y, variance);
+    fuse(Vector3f(-h.y, h.x, 0),   innovation.z, variance);
+    apply_errors();
+
+    _quat_error_rp_sum += innovation.length();
+    _quat_error_rp_count++;
+}
+
+// use the compass or GPS ground course as a heading reference
+void
+AP_AHRS_Quaternion::fuse_yaw(void)
+{
+    float heading;
+    float variance;
+    Matrix3f rot;
+    _q.rotation_matrix(rot);
+
+    if (_compass && _compass->use_for_yaw()) {
+        if (_compass->last_update == _yaw_compass_last_update) {
+            return;
+        }
+        _yaw_compass_last_update = _compass->last_update;
+        heading  = _compass->calculate_heading(rot);
+        variance = sq(QUAT_COMPASS_NOISE);
+    } else if (_fly_forward && _gps && _gps->status() == GPS::GPS_OK && _gps_use &&
+               _gps->last_fix_time != _yaw_gps_last_update &&
+               _gps->ground_speed >= GPS_SPEED_MIN) {
+        _yaw_gps_last_update = _gps->last_fix_time;
+        heading  = ToRad(_gps->ground_course * 0.01);
+        variance = sq(QUAT_GPS_YAW_NOISE);
+    } else {
+        return;
+    }
+
+    float cur_roll, cur_pitch, cur_yaw;
+    _q.to_euler(&cur_roll, &cur_pitch, &cur_yaw);
+
+    if (!_have_quat_yaw) {
+        // take the first heading as is
+        _q.from_euler(cur_roll, cur_pitch, heading);
+        _have_quat_yaw = true;
+        return;
+    }
+
+    float innovation = wrap_angle(heading - cur_yaw);
+
+    // a body frame attitude error shows up as a yaw error through
+    // the earth frame Z axis
+    _err_att.zero();
+    _err_bias.zero();
+    fuse(rot.c, innovation, variance);
+    apply_errors();
+
+    _quat_error_yaw_sum += fabs(innovation);
+    _quat_error_yaw_count++;
+}
+
+// sequential scalar Kalman update for a measurement that depends on
+// the attitude error only, with jacobian h_att. The state correction
+// is accumulated in _err_att and _err_bias
+void
+AP_AHRS_Quaternion::fuse(const Vector3f &h_att, float innovation, float variance)
+{
+    // P * H'
+    Vector3f ph_att  = _P_att * h_att;
+    Vector3f ph_bias = _P_cross.mul_transpose(h_att);
+
+    float s = h_att * ph_att + variance;
+    if (!(s > 0) || isinf(s)) {
+        // the covariance has gone bad, start again
+        reset_filter();
+        return;
+    }
+
+    // allow for the correction from earlier measurements in this set
+    float residual = innovation - h_att * _err_att;
+
+    _err_att  += ph_att  * (residual / s);
+    _err_bias += ph_bias * (residual / s);
+
+    _P_att   -= outer(ph_att,  ph_att)  / s;
+    _P_cross -= outer(ph_att,  ph_bias) / s;
+    _P_bias  -= outer(ph_bias, ph_bias) / s;
+}
+
+// move the estimated errors into the attitude and bias
+void
+AP_AHRS_Quaternion::apply_errors(void)
+{
+    if (_err_att.is_nan() || _err_bias.is_nan()) {
+        return;
+    }
+    _q.rotate(_err_att);
+    _q.normalize();
+
+    // keep the bias within what the sensor can physically drift to
+    // over a few minutes
+    float bias_limit = max(_gyro_drift_limit * 300, ToRad(5.0));
+    _gyro_bias += _err_bias;
+    _gyro_bias.x = constrain(_gyro_bias.x, -bias_limit, bias_limit);
+    _gyro_bias.y = constrain(_gyro_bias.y, -bias_limit, bias_limit);
+    _gyro_bias.z = constrain(_gyro_bias.z, -bias_limit, bias_limit);
+}
+
+// calculate the euler angles of the quaternion solution
+void
+AP_AHRS_Quaternion::quat_euler_angles(void)
+{
+    if (_q.is_nan()) {
+        SITL_debug("ERROR: AHRS quaternion NAN\n");
+        renorm_blowup_count++;
+        reset_from_dcm();
+    }
+
+    _q.to_euler(&_quat_roll, &_quat_pitch, &_quat_yaw);
+
+    _quat_sensor.x = degrees(_quat_roll)  * 100;
+    _quat_sensor.y = degrees(_quat_pitch) * 100;
+    _quat_sensor.z = degrees(_quat_yaw)   * 100;
+
+    if (_quat_sensor.z < 0)
+        _quat_sensor.z += 36000;
+}
+
+// return the gyro vector corrected for the estimated bias
+Vector3f
+AP_AHRS_Quaternion::get_gyro(void)
+{
+    if (using_quaternion()) {
+        return _omega;
+    }
+    return AP_AHRS_DCM::get_gyro();
+}
+
+// return the current attitude as a rotation matrix
+Matrix3f
+AP_AHRS_Quaternion::get_dcm_matrix(void)
+{
+    if (using_quaternion()) {
+        Matrix3f m;
+        _q.rotation_matrix(m);
+        return m;
+    }
+    return AP_AHRS_DCM::get_dcm_matrix();
+}
+
+// return the current drift correction, with the same sign as the DCM
+// omega_I term
+Vector3f
+AP_AHRS_Quaternion::get_gyro_drift(void)
+{
+    if (using_quaternion()) {
+        return -_gyro_bias;
+    }
+    return AP_AHRS_DCM::get_gyro_drift();
+}
+
+/* reporting of filter state for MAVLink */
+
+// average size of the accel innovation since last call
+float AP_AHRS_Quaternion::get_error_rp(void)
+{
+    if (!using_quaternion()) {
+        return AP_AHRS_DCM::get_error_rp();
+    }
+    if (_quat_error_rp_count == 0) {
+        return _quat_error_rp_last;
+    }
+    _quat_error_rp_last = _quat_error_rp_sum / _quat_error_rp_count;
+    _quat_error_rp_sum = 0;
+    _quat_error_rp_count = 0;
+    return _quat_error_rp_last;
+}
+
+// average size of the heading innovation since last call
+float AP_AHRS_Quaternion::get_error_yaw(void)
+{
+    if (!using_quaternion()) {
+        return AP_AHRS_DCM::get_error_yaw();
+    }
+    if (_quat_error_yaw_count == 0) {
+        return _quat_error_yaw_last;
+    }
+    _quat_error_yaw_last = _quat_error_yaw_sum / _quat_error_yaw_count;
+    _quat_error_yaw_sum = 0;
+    _quat_error_yaw_count = 0;
+    return _quat_error_yaw_last;
+}
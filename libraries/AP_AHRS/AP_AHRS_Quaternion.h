@@ -0,0 +1,146 @@
+#ifndef AP_AHRS_QUATERNION_H
+#define AP_AHRS_QUATERNION_H
+/*
+ *  Quaternion based AHRS (Attitude Heading Reference System) for
+ *  ArduPilot, using a small error-state Kalman filter over the
+ *  attitude error and gyro bias.
+ *
+ *  The DCM estimator is kept running on the same IMU samples so the
+ *  two solutions can be compared in flight. AHRS_QUAT_USE selects
+ *  which of the two is reported to the flight code.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ */
+
+class AP_AHRS_Quaternion : public AP_AHRS_DCM
+{
+public:
+    // Constructors
+    AP_AHRS_Quaternion(AP_InertialSensor *ins, GPS *&gps) :
+        AP_AHRS_DCM(ins, gps),
+        _in_dcm_update(false),
+        _initialised(false)
+    {
+        reset_filter();
+    }
+
+    // return the gyro vector corrected for the estimated bias
+    Vector3f        get_gyro(void);
+
+    // return the current attitude as a rotation matrix
+    Matrix3f        get_dcm_matrix(void);
+
+    // return the current gyro bias estimate
+    Vector3f        get_gyro_drift(void);
+
+    // Methods
+    void            update(void);
+    void            reset(bool recover_eulers = false);
+
+    // status reporting
+    float           get_error_rp(void);
+    float           get_error_yaw(void);
+
+    // true when the quaternion solution is driving the flight code
+    bool            using_quaternion(void) {
+        return _quat_use && _initialised;
+    }
+
+    // attitude solutions of the two estimators, degrees * 100
+    int32_t         dcm_roll_sensor(void)  { return _dcm_sensor.x; }
+    int32_t         dcm_pitch_sensor(void) { return _dcm_sensor.y; }
+    int32_t         dcm_yaw_sensor(void)   { return _dcm_sensor.z; }
+    int32_t         quat_roll_sensor(void)  { return _quat_sensor.x; }
+    int32_t         quat_pitch_sensor(void) { return _quat_sensor.y; }
+    int32_t         quat_yaw_sensor(void)   { return _quat_sensor.z; }
+
+    // time taken by the last update of each estimator, in microseconds
+    uint16_t        dcm_update_us(void)  { return _dcm_update_us; }
+    uint16_t        quat_update_us(void) { return _quat_update_us; }
+
+    // settable parameters, a group of their own so the keys of the
+    // AP_AHRS parameters are unchanged
+    AP_Int8         _quat_use;
+
+    static const struct AP_Param::GroupInfo var_info[];
+
+private:
+    // Methods
+    void            reset_filter(void);
+    void            reset_from_dcm(void);
+    void            init_attitude(void);
+    void            predict(float deltat);
+    void            fuse_accel(void);
+    void            fuse_yaw(void);
+    void            fuse(const Vector3f &h_att, float innovation, float variance);
+    void            apply_errors(void);
+    bool            update_gps_accel(void);
+    void            quat_euler_angles(void);
+    void            set_dcm_outputs(void);
+
+    // attitude (body to earth) and gyro bias
+    Quaternion      _q;
+    Vector3f        _gyro_bias;
+
+    // error covariance, held as 3x3 blocks of the 6x6 matrix
+    // [ attitude, cross ; cross', bias ]
+    Matrix3f        _P_att;
+    Matrix3f        _P_cross;
+    Matrix3f        _P_bias;
+
+    // state correction accumulated over one measurement set
+    Vector3f        _err_att;
+    Vector3f        _err_bias;
+
+    // latest corrected gyro vector
+    Vector3f        _omega;
+
+    // quaternion solution as euler angles
+    float           _quat_roll;
+    float           _quat_pitch;
+    float           _quat_yaw;
+
+    // DCM solution as euler angles, restored before each DCM step
+    float           _dcm_roll;
+    float           _dcm_pitch;
+    float           _dcm_yaw;
+
+    // integer euler angles of each estimator (degrees * 100)
+    Vector3l        _dcm_sensor;
+    Vector3l        _quat_sensor;
+
+    // earth frame acceleration derived from GPS velocity, m/s/s
+    Vector3f        _gps_accel;
+    Vector3f        _gps_last_velocity;
+    uint32_t        _gps_last_fix_time;
+    bool            _have_gps_velocity;
+
+    // time of last yaw reference used
+    uint32_t        _yaw_compass_last_update;
+    uint32_t        _yaw_gps_last_update;
+    bool            _have_quat_yaw;
+
+    // state to support status reporting
+    float           _quat_error_rp_sum;
+    uint16_t        _quat_error_rp_count;
+    float           _quat_error_rp_last;
+    float           _quat_error_yaw_sum;
+    uint16_t        _quat_error_yaw_count;
+    float           _quat_error_yaw_last;
+
+    // CPU cost of each estimator
+    uint16_t        _dcm_update_us;
+    uint16_t        _quat_update_us;
+
+    // true while the DCM step is running, so a DCM triggered
+    // reset does not also reset the quaternion filter
+    bool            _in_dcm_update;
+
+    // true once roll and pitch have been set from the accels
+    bool            _initialised;
+};
+
+#endif // AP_AHRS_QUATERNION_H
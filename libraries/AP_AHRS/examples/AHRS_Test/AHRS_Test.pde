@@ -58,6 +58,7 @@ AP_GPS_Auto     g_gps_driver(&Serial1, &g_gps);
 // choose which AHRS system to use
 AP_AHRS_DCM  ahrs(&ins, g_gps);
 //AP_AHRS_MPU6000  ahrs(&ins, g_gps);		// only works with APM2
+//AP_AHRS_Quaternion  ahrs(&ins, g_gps);	// DCM and quaternion filter side by side
 
 AP_Baro_BMP085_HIL barometer;
 
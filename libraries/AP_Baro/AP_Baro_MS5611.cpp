@@ -52,13 +52,17 @@
 #define CMD_CONVERT_D1_OSR4096 0x48   // Maximum resolution (oversampling)
 #define CMD_CONVERT_D2_OSR4096 0x58   // Maximum resolution (oversampling)
 
-uint32_t volatile AP_Baro_MS5611::_s_D1;
-uint32_t volatile AP_Baro_MS5611::_s_D2;
-uint8_t volatile AP_Baro_MS5611::_d1_count;
-uint8_t volatile AP_Baro_MS5611::_d2_count;
+// more conversions than this could overflow the difference of the
+// totals, so after a long gap read() takes the newest one instead. It
+// does the same after SENSOR_MAX_AVERAGE_US, when the counts
+// themselves may have wrapped
+#define MS5611_MAX_SUMMED 128
+
+struct sensor_baro AP_Baro_MS5611::_totals;
 uint8_t AP_Baro_MS5611::_state;
 uint32_t AP_Baro_MS5611::_timer;
-bool volatile AP_Baro_MS5611::_updated;
+
+AP_TopicOf<struct sensor_baro> sensor_baro_topic(SENSOR_TOPIC_BARO);
 
 uint8_t AP_Baro_MS5611::_spi_read(uint8_t reg)
 {
@@ -138,16 +142,11 @@ bool AP_Baro_MS5611::init( AP_PeriodicProcess *scheduler )
     Temp=0;
     Press=0;
 
-    _s_D1 = 0;
-    _s_D2 = 0;
-    _d1_count = 0;
-    _d2_count = 0;
-
     scheduler->resume_timer();
     scheduler->register_process( AP_Baro_MS5611::_update );
 
     // wait for at least one value to be read
-    while (!_updated) ;
+    while (!sensor_baro_topic.updated_since(_used_version)) ;
 
     healthy = true;
     return true;
@@ -169,29 +168,17 @@ void AP_Baro_MS5611::_update(uint32_t tnow)
     _timer = tnow;
 
     if (_state == 0) {
-        _s_D2 += _spi_read_adc();                                // On state 0 we read temp
-        _d2_count++;
-        if (_d2_count == 32) {
-            // we have summed 32 values. This only happens
-            // when we stop reading the barometer for a long time
-            // (more than 1.2 seconds)
-            _s_D2 >>= 1;
-            _d2_count = 16;
-        }
+        _totals.d2 = _spi_read_adc();                            // On state 0 we read temp
+        _totals.d2_sum += _totals.d2;
+        _totals.d2_count++;
         _state++;
         _spi_write(CMD_CONVERT_D1_OSR4096);      // Command to read pressure
     } else {
-        _s_D1 += _spi_read_adc();
-        _d1_count++;
-        if (_d1_count == 128) {
-            // we have summed 128 values. This only happens
-            // when we stop reading the barometer for a long time
-            // (more than 1.2 seconds)
-            _s_D1 >>= 1;
-            _d1_count = 64;
-        }
+        _totals.d1 = _spi_read_adc();
+        _totals.d1_sum += _totals.d1;
+        _totals.d1_count++;
         _state++;
-        _updated = true;                                                        // New pressure reading
+        sensor_baro_topic.publish(_totals, tnow);                // New pressure reading
         if (_state == 5) {
             _spi_write(CMD_CONVERT_D2_OSR4096); // Command to read temperature
             _state = 0;
@@ -203,26 +190,29 @@ void AP_Baro_MS5611::_update(uint32_t tnow)
 
 uint8_t AP_Baro_MS5611::read()
 {
-    bool updated = _updated;
+    bool updated = sensor_baro_topic.updated_since(_used_version);
     if (updated) {
-        uint32_t sD1, sD2;
-        uint8_t d1count, d2count;
-        // we need to disable interrupts to access
-        // _s_D1 and _s_D2 as they are not atomic
-        uint8_t oldSREG = SREG;
-        cli();
-        sD1 = _s_D1; _s_D1 = 0;
-        sD2 = _s_D2; _s_D2 = 0;
-        d1count = _d1_count; _d1_count = 0;
-        d2count = _d2_count; _d2_count = 0;
-        _updated = false;
-        SREG = oldSREG;
-        if (d1count != 0) {
-            D1 = ((float)sD1) / d1count;
+        struct sensor_baro s;
+        uint32_t time_us;
+        _used_version = sensor_baro_topic.read(s, &time_us);
+
+        // average the conversions since the last read
+        bool long_gap = time_us - _used_time_us > SENSOR_MAX_AVERAGE_US;
+        uint16_t d1count = s.d1_count - _used.d1_count;
+        uint16_t d2count = s.d2_count - _used.d2_count;
+        if (long_gap || d1count > MS5611_MAX_SUMMED) {
+            D1 = s.d1;
+            d1count = 1;
+        } else if (d1count != 0) {
+            D1 = ((float)(s.d1_sum - _used.d1_sum)) / d1count;
         }
-        if (d2count != 0) {
-            D2 = ((float)sD2) / d2count;
+        if (long_gap || d2count > MS5611_MAX_SUMMED) {
+            D2 = s.d2;
+        } else if (d2count != 0) {
+            D2 = ((float)(s.d2_sum - _used.d2_sum)) / d2count;
         }
+        _used = s;
+        _used_time_us = time_us;
         _pressure_samples = d1count;
         _raw_press = D1;
         _raw_temp = D2;
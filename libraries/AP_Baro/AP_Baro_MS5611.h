@@ -4,11 +4,15 @@
 #define __AP_BARO_MS5611_H__
 
 #include "AP_Baro.h"
+#include "../AP_SensorBus/AP_SensorBus.h"
 
 class AP_Baro_MS5611 : public AP_Baro
 {
 public:
-    AP_Baro_MS5611() {
+    AP_Baro_MS5611() :
+        _used_version(0),
+        _used_time_us(0) {
+        memset(&_used, 0, sizeof(_used));
     }                  // Constructor
 
     /* AP_Baro public interface: */
@@ -25,11 +29,8 @@ public:
 private:
     /* Asynchronous handler functions: */
     static void                     _update(uint32_t );
-    /* Asynchronous state: */
-    static volatile bool            _updated;
-    static volatile uint8_t         _d1_count;
-    static volatile uint8_t         _d2_count;
-    static volatile uint32_t        _s_D1, _s_D2;
+    /* Asynchronous state, published on the sensor bus: */
+    static struct sensor_baro       _totals;
     static uint8_t                  _state;
     static uint32_t                 _timer;
     /* Gates access to asynchronous state: */
@@ -45,6 +46,11 @@ private:
     float                           Temp;
     float                           Press;
 
+    /* The totals already averaged by read(), and their time: */
+    struct sensor_baro              _used;
+    uint16_t                        _used_version;
+    uint32_t                        _used_time_us;
+
     int32_t                         _raw_press;
     int32_t                         _raw_temp;
     // Internal calibration registers
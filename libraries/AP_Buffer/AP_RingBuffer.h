@@ -0,0 +1,201 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_RingBuffer.h
+/// @brief	Wait-free single producer, single consumer ring
+///
+/// For handing items from an interrupt or timer process to the main
+/// loop, or back. The producer only moves the head and the consumer
+/// only moves the tail, so neither side needs to disable interrupts.
+/// Both indices run freely and are masked on use, so SIZE must be a
+/// power of 2, and no more than 128 so that an index fits in a byte,
+/// which the AVR loads and stores atomically.
+///
+/// Unlike AP_Buffer, a full ring refuses new items rather than
+/// overwriting the oldest, as the consumer may be reading it. A single
+/// push() or pop() costs more than AP_Buffer's add/get, since each
+/// one loads the other side's index with acquire ordering. Move
+/// several items at a time through the span calls where possible.
+///
+/// FastSerial keeps its own byte rings. Their size is set in begin()
+/// at run time, from RNAV_RX_BUF and RNAV_TX_BUF for the Rel NAV port,
+/// and can be larger than this ring allows. Their head and tail are
+/// already each moved from one side only, by the UART interrupt and
+/// by the main loop.
+
+#ifndef AP_RINGBUFFER_H
+#define AP_RINGBUFFER_H
+
+#include <stdint.h>
+#include <string.h>
+
+/// @class	AP_RingBuffer
+template <class T, uint8_t SIZE>
+class AP_RingBuffer {
+public:
+    AP_RingBuffer() :
+        _head(0),
+        _tail(0)
+    {}
+
+    /// @name	Producer side
+    //@{
+
+    /// free slots
+    uint8_t         space(void) const {
+        return SIZE - (uint8_t)(_head - load_acquire(_tail));
+    }
+
+    /// add an item
+    ///
+    /// @returns false if the ring is full
+    bool            push(const T &item) {
+        if (space() == 0) {
+            return false;
+        }
+        _buf[_head & MASK] = item;
+        store_release(_head, _head + 1);
+        return true;
+    }
+
+    /// add as many of count items as there is room for
+    ///
+    /// @returns the number added
+    uint8_t         push(const T *items, uint8_t count) {
+        uint8_t done = 0;
+        while (done < count) {
+            T *p;
+            uint8_t n = write_span(&p);
+            if (n == 0) {
+                break;
+            }
+            if (n > count - done) {
+                n = count - done;
+            }
+            memcpy(p, &items[done], n * sizeof(T));
+            commit(n);
+            done += n;
+        }
+        return done;
+    }
+
+    /// the contiguous free slots, to be filled in place and then
+    /// passed to commit()
+    ///
+    /// @returns the number of slots at *p
+    uint8_t         write_span(T **p) {
+        uint8_t ofs = _head & MASK;
+        uint8_t n = space();
+        if (n > SIZE - ofs) {
+            n = SIZE - ofs;
+        }
+        *p = &_buf[ofs];
+        return n;
+    }
+
+    /// publish count slots filled through write_span()
+    void            commit(uint8_t count) {
+        store_release(_head, _head + count);
+    }
+    //@}
+
+    /// @name	Consumer side
+    //@{
+
+    /// items waiting
+    uint8_t         available(void) const {
+        return load_acquire(_head) - _tail;
+    }
+
+    /// take the oldest item
+    ///
+    /// @returns false if the ring is empty
+    bool            pop(T &item) {
+        if (available() == 0) {
+            return false;
+        }
+        item = _buf[_tail & MASK];
+        store_release(_tail, _tail + 1);
+        return true;
+    }
+
+    /// take up to count items
+    ///
+    /// @returns the number taken
+    uint8_t         pop(T *items, uint8_t count) {
+        uint8_t done = 0;
+        while (done < count) {
+            const T *p;
+            uint8_t n = peek_span(&p);
+            if (n == 0) {
+                break;
+            }
+            if (n > count - done) {
+                n = count - done;
+            }
+            memcpy(&items[done], p, n * sizeof(T));
+            consume(n);
+            done += n;
+        }
+        return done;
+    }
+
+    /// the contiguous waiting items, to be read in place and then
+    /// released with consume()
+    ///
+    /// @returns the number of items at *p
+    uint8_t         peek_span(const T **p) const {
+        uint8_t ofs = _tail & MASK;
+        uint8_t n = available();
+        if (n > SIZE - ofs) {
+            n = SIZE - ofs;
+        }
+        *p = &_buf[ofs];
+        return n;
+    }
+
+    /// release count items read through peek_span()
+    void            consume(uint8_t count) {
+        store_release(_tail, _tail + count);
+    }
+
+    /// discard everything waiting
+    void            clear(void) {
+        store_release(_tail, load_acquire(_head));
+    }
+    //@}
+
+private:
+    enum { MASK = SIZE - 1 };
+
+    // fails to compile unless SIZE is a power of 2 no larger than 128
+    typedef char size_check[(SIZE != 0 && (SIZE & (SIZE-1)) == 0 && SIZE <= 128) ? 1 : -1];
+
+    // the other side's index is read with acquire, and our own is
+    // published with release, so the slots are written before the
+    // index that hands them over. The AVR doesn't reorder memory
+    // accesses, so there only the compiler has to be held back
+    static uint8_t  load_acquire(const uint8_t &v) {
+#ifdef __AVR__
+        uint8_t r = *(const volatile uint8_t *)&v;
+        __asm__ __volatile__("" ::: "memory");
+        return r;
+#else
+        return __atomic_load_n(&v, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    static void     store_release(uint8_t &v, uint8_t x) {
+#ifdef __AVR__
+        __asm__ __volatile__("" ::: "memory");
+        *(volatile uint8_t *)&v = x;
+#else
+        __atomic_store_n(&v, x, __ATOMIC_RELEASE);
+#endif
+    }
+
+    T               _buf[SIZE];
+    uint8_t         _head;
+    uint8_t         _tail;
+};
+
+#endif // AP_RINGBUFFER_H
@@ -0,0 +1,159 @@
+/*
+ *       Throughput of AP_RingBuffer against AP_Buffer, and a check that
+ *       items handed over from the timer process arrive in order.
+ */
+
+#include <FastSerial.h>
+#include <AP_Common.h>
+#include <AP_Math.h>
+#include <Arduino_Mega_ISR_Registry.h>
+#include <AP_PeriodicProcess.h>
+#include <AP_Buffer.h>
+#include <AP_RingBuffer.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Serial ports
+////////////////////////////////////////////////////////////////////////////////
+FastSerialPort0(Serial);        // FTDI/console
+
+Arduino_Mega_ISR_Registry isr_registry;
+AP_TimerProcess scheduler;
+
+#define ITERATIONS  1000
+#define BLOCK       16
+
+struct sample {
+    uint32_t time_us;
+    int16_t  v[6];
+};
+
+AP_Buffer<uint8_t,32> old_bytes;
+AP_RingBuffer<uint8_t,32> ring_bytes;
+AP_RingBuffer<struct sample,16> ring_samples;
+
+// filled by the timer process, checked by loop()
+AP_RingBuffer<uint16_t,64> handoff;
+static volatile uint16_t handoff_full;
+static uint16_t handoff_next, handoff_seq, handoff_bad;
+static uint32_t handoff_count;
+
+static void handoff_producer(uint32_t now)
+{
+    // a few items per tick so the consumer sees both ends of the ring
+    for (uint8_t i=0; i<4; i++) {
+        if (!handoff.push(handoff_seq)) {
+            handoff_full++;
+            return;
+        }
+        handoff_seq++;
+    }
+}
+
+static void report(const char *name, uint32_t t_us, uint32_t items)
+{
+    Serial.printf("%-28s %8.3f us/item\n", name, t_us / (float)items);
+}
+
+static void bench_bytes(void)
+{
+    uint32_t t0;
+    uint8_t buf[BLOCK];
+    volatile uint8_t sink = 0;
+
+    t0 = micros();
+    for (uint16_t n=0; n<ITERATIONS; n++) {
+        for (uint8_t i=0; i<BLOCK; i++) {
+            old_bytes.add(i);
+        }
+        for (uint8_t i=0; i<BLOCK; i++) {
+            sink = old_bytes.get();
+        }
+    }
+    report("AP_Buffer add/get", micros() - t0, (uint32_t)ITERATIONS * BLOCK);
+
+    t0 = micros();
+    for (uint16_t n=0; n<ITERATIONS; n++) {
+        for (uint8_t i=0; i<BLOCK; i++) {
+            ring_bytes.push(i);
+        }
+        for (uint8_t i=0; i<BLOCK; i++) {
+            uint8_t c;
+            ring_bytes.pop(c);
+            sink = c;
+        }
+    }
+    report("AP_RingBuffer push/pop", micros() - t0, (uint32_t)ITERATIONS * BLOCK);
+
+    for (uint8_t i=0; i<BLOCK; i++) {
+        buf[i] = i;
+    }
+    t0 = micros();
+    for (uint16_t n=0; n<ITERATIONS; n++) {
+        ring_bytes.push(buf, BLOCK);
+        ring_bytes.pop(buf, BLOCK);
+    }
+    report("AP_RingBuffer bulk", micros() - t0, (uint32_t)ITERATIONS * BLOCK);
+    (void)sink;
+}
+
+static void bench_samples(void)
+{
+    uint32_t t0;
+    uint32_t sum = 0;
+
+    // filled and read in place, as the IMU logging does
+    t0 = micros();
+    for (uint16_t n=0; n<ITERATIONS; n++) {
+        struct sample *s;
+        while (ring_samples.write_span(&s) != 0) {
+            s->time_us = n;
+            ring_samples.commit(1);
+        }
+        const struct sample *p;
+        uint8_t count;
+        while ((count = ring_samples.peek_span(&p)) != 0) {
+            for (uint8_t i=0; i<count; i++) {
+                sum += p[i].time_us;
+            }
+            ring_samples.consume(count);
+        }
+    }
+    report("AP_RingBuffer 16 byte spans", micros() - t0, (uint32_t)ITERATIONS * 16);
+    if (sum == 1) {
+        Serial.println();
+    }
+}
+
+void setup()
+{
+    Serial.begin(115200, 128, 128);
+    Serial.println("AP_RingBuffer benchmark");
+
+    bench_bytes();
+    bench_samples();
+
+    isr_registry.init();
+    scheduler.init(&isr_registry);
+    scheduler.register_process(handoff_producer);
+}
+
+void loop()
+{
+    static uint32_t last_report;
+    uint16_t v;
+
+    while (handoff.pop(v)) {
+        if (v != handoff_next) {
+            handoff_bad++;
+        }
+        handoff_next = v + 1;
+        handoff_count++;
+    }
+
+    if (millis() - last_report >= 1000) {
+        last_report = millis();
+        Serial.printf("handoff: %lu items, %u out of order, %u refused\n",
+                      (unsigned long)handoff_count, (unsigned)handoff_bad,
+                      (unsigned)handoff_full);
+    }
+}
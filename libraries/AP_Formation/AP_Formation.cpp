@@ -0,0 +1,120 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include <AP_Formation.h>
+
+const AP_Param::GroupInfo AP_Formation::var_info[] PROGMEM = {
+    // @Param: ID1
+    // @DisplayName: Slot 1 aircraft
+    // @Description: MAVLink system ID of the aircraft flying slot 1, 0 for an empty slot. IDs above 127 are shown as the ID less 256
+    // @Range: 0 255
+    // @User: Standard
+    AP_GROUPINFO("ID1",  0, AP_Formation, _sysid[0], 0),
+
+    // @Param: ID2
+    // @DisplayName: Slot 2 aircraft
+    // @Description: MAVLink system ID of the aircraft flying slot 2, 0 for an empty slot. IDs above 127 are shown as the ID less 256
+    // @Range: 0 255
+    // @User: Standard
+    AP_GROUPINFO("ID2",  1, AP_Formation, _sysid[1], 0),
+
+    // @Param: ID3
+    // @DisplayName: Slot 3 aircraft
+    // @Description: MAVLink system ID of the aircraft flying slot 3, 0 for an empty slot. IDs above 127 are shown as the ID less 256
+    // @Range: 0 255
+    // @User: Standard
+    AP_GROUPINFO("ID3",  2, AP_Formation, _sysid[2], 0),
+
+    // @Param: ID4
+    // @DisplayName: Slot 4 aircraft
+    // @Description: MAVLink system ID of the aircraft flying slot 4, 0 for an empty slot. IDs above 127 are shown as the ID less 256
+    // @Range: 0 255
+    // @User: Standard
+    AP_GROUPINFO("ID4",  3, AP_Formation, _sysid[3], 0),
+
+    // @Param: ID5
+    // @DisplayName: Slot 5 aircraft
+    // @Description: MAVLink system ID of the aircraft flying slot 5, 0 for an empty slot. IDs above 127 are shown as the ID less 256
+    // @Range: 0 255
+    // @User: Standard
+    AP_GROUPINFO("ID5",  4, AP_Formation, _sysid[4], 0),
+
+    // @Param: OFS1
+    // @DisplayName: Slot 1 offset
+    // @Description: Offset of slot 1 from the leader in the formation frame. X is forward (negative is behind), Y right and Z down
+    // @Units: meters
+    // @User: Standard
+    AP_GROUPINFO("OFS1", 5, AP_Formation, _offset[0], 0),
+
+    // @Param: OFS2
+    // @DisplayName: Slot 2 offset
+    // @Description: Offset of slot 2 from the leader in the formation frame
+    // @Units: meters
+    // @User: Standard
+    AP_GROUPINFO("OFS2", 6, AP_Formation, _offset[1], 0),
+
+    // @Param: OFS3
+    // @DisplayName: Slot 3 offset
+    // @Description: Offset of slot 3 from the leader in the formation frame
+    // @Units: meters
+    // @User: Standard
+    AP_GROUPINFO("OFS3", 7, AP_Formation, _offset[2], 0),
+
+    // @Param: OFS4
+    // @DisplayName: Slot 4 offset
+    // @Description: Offset of slot 4 from the leader in the formation frame
+    // @Units: meters
+    // @User: Standard
+    AP_GROUPINFO("OFS4", 8, AP_Formation, _offset[3], 0),
+
+    // @Param: OFS5
+    // @DisplayName: Slot 5 offset
+    // @Description: Offset of slot 5 from the leader in the formation frame
+    // @Units: meters
+    // @User: Standard
+    AP_GROUPINFO("OFS5", 9, AP_Formation, _offset[4], 0),
+
+    AP_GROUPEND
+};
+
+uint8_t
+AP_Formation::slot(int16_t sysid)
+{
+    if (sysid <= 0 || sysid > 255) {
+        return 0;
+    }
+    for (uint8_t i=0; i<FORMATION_MAX_SLOTS; i++) {
+        // the IDs are kept in a byte
+        if ((uint8_t)_sysid[i].get() == sysid) {
+            return i+1;
+        }
+    }
+    return 0;
+}
+
+bool
+AP_Formation::get_offset(int16_t sysid, Vector3f &offset)
+{
+    uint8_t i = slot(sysid);
+    if (i == 0) {
+        return false;
+    }
+    offset = _offset[i-1].get();
+    return true;
+}
+
+bool
+AP_Formation::upload_msg(mavlink_message_t *msg)
+{
+    mavlink_formation_t packet;
+    mavlink_msg_formation_decode(msg, &packet);
+    if (packet.target_system != 0 &&
+        mavlink_check_target(packet.target_system, packet.target_component)) {
+        // not for us
+        return false;
+    }
+    for (uint8_t i=0; i<FORMATION_MAX_SLOTS; i++) {
+        _sysid[i].set_and_save((int8_t)packet.sysid[i]);
+        _offset[i].set_and_save(Vector3f(packet.x[i], packet.y[i], packet.z[i]));
+    }
+    return true;
+}
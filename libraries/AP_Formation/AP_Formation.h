@@ -0,0 +1,49 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_Formation.h
+/// @brief	Slot geometry of a multi-ship formation, with EEPROM-backed
+///			storage of the slot table.
+///
+/// Each slot is an offset from the leader in the formation frame:
+/// forward, right and down in metres, level and aligned with the
+/// leader's heading. A slot is assigned to an aircraft by its MAVLink
+/// system ID, so one table can be uploaded to every aircraft in the
+/// formation.
+
+#ifndef AP_FORMATION_H
+#define AP_FORMATION_H
+
+#include <AP_Common.h>
+#include <AP_Math.h>
+#include <GCS_MAVLink.h>
+
+#define FORMATION_MAX_SLOTS     5
+
+/// @class	AP_Formation
+/// @brief	Table of formation slots
+class AP_Formation {
+public:
+    AP_Formation() {}
+
+    /// slot flown by an aircraft, 1 to FORMATION_MAX_SLOTS, or 0 if it
+    /// has none or sysid is not a MAVLink system ID (1 to 255)
+    uint8_t         slot(int16_t sysid);
+
+    /// offset of an aircraft's slot from the leader, metres
+    ///
+    /// @returns false if the aircraft has no slot
+    bool            get_offset(int16_t sysid, Vector3f &offset);
+
+    /// replace the whole table from a FORMATION message
+    ///
+    /// @returns true if the message was for us
+    bool            upload_msg(mavlink_message_t *msg);
+
+    static const struct AP_Param::GroupInfo        var_info[];
+
+private:
+    AP_Int8         _sysid[FORMATION_MAX_SLOTS];   // system IDs as bytes
+    AP_Vector3f     _offset[FORMATION_MAX_SLOTS];
+};
+
+#endif // AP_FORMATION_H
@@ -0,0 +1,301 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include <AP_GainSchedule.h>
+
+const AP_Param::GroupInfo AP_GainSchedule::var_info[] PROGMEM = {
+    // @Param: ENABLE
+    // @DisplayName: RelNAV gain scheduling
+    // @Description: Scale the RelNAV pitch and throttle PIDs by the separation and airspeed tables. When disabled the PIDs fly their fixed gains
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("ENABLE", 0, AP_GainSchedule, _enable, 0),
+    // @Param: SEP1
+    // @DisplayName: Separation breakpoint 1
+    // @Description: Separation from the leader at breakpoint 1 of the separation tables. Breakpoints must increase
+    // @Units: meters
+    // @Range: 0 500
+    // @User: Advanced
+    AP_GROUPINFO("SEP1", 1, AP_GainSchedule, _sep[0], 10),
+
+    // @Param: SEP2
+    // @DisplayName: Separation breakpoint 2
+    // @Description: Separation from the leader at breakpoint 2 of the separation tables. Breakpoints must increase
+    // @Units: meters
+    // @Range: 0 500
+    // @User: Advanced
+    AP_GROUPINFO("SEP2", 2, AP_GainSchedule, _sep[1], 20),
+
+    // @Param: SEP3
+    // @DisplayName: Separation breakpoint 3
+    // @Description: Separation from the leader at breakpoint 3 of the separation tables. Breakpoints must increase
+    // @Units: meters
+    // @Range: 0 500
+    // @User: Advanced
+    AP_GROUPINFO("SEP3", 3, AP_GainSchedule, _sep[2], 40),
+
+    // @Param: SEP4
+    // @DisplayName: Separation breakpoint 4
+    // @Description: Separation from the leader at breakpoint 4 of the separation tables. Breakpoints must increase
+    // @Units: meters
+    // @Range: 0 500
+    // @User: Advanced
+    AP_GROUPINFO("SEP4", 4, AP_GainSchedule, _sep[3], 80),
+
+    // @Param: PSEP1
+    // @DisplayName: Pitch gain at separation 1
+    // @Description: Multiplier on the RelNAV pitch PID at separation breakpoint 1
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("PSEP1", 5, AP_GainSchedule, _sep_pitch[0], 1),
+
+    // @Param: PSEP2
+    // @DisplayName: Pitch gain at separation 2
+    // @Description: Multiplier on the RelNAV pitch PID at separation breakpoint 2
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("PSEP2", 6, AP_GainSchedule, _sep_pitch[1], 1),
+
+    // @Param: PSEP3
+    // @DisplayName: Pitch gain at separation 3
+    // @Description: Multiplier on the RelNAV pitch PID at separation breakpoint 3
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("PSEP3", 7, AP_GainSchedule, _sep_pitch[2], 1),
+
+    // @Param: PSEP4
+    // @DisplayName: Pitch gain at separation 4
+    // @Description: Multiplier on the RelNAV pitch PID at separation breakpoint 4
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("PSEP4", 8, AP_GainSchedule, _sep_pitch[3], 1),
+
+    // @Param: TSEP1
+    // @DisplayName: Throttle gain at separation 1
+    // @Description: Multiplier on the RelNAV throttle PID at separation breakpoint 1
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("TSEP1", 9, AP_GainSchedule, _sep_thr[0], 1),
+
+    // @Param: TSEP2
+    // @DisplayName: Throttle gain at separation 2
+    // @Description: Multiplier on the RelNAV throttle PID at separation breakpoint 2
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("TSEP2", 10, AP_GainSchedule, _sep_thr[1], 1),
+
+    // @Param: TSEP3
+    // @DisplayName: Throttle gain at separation 3
+    // @Description: Multiplier on the RelNAV throttle PID at separation breakpoint 3
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("TSEP3", 11, AP_GainSchedule, _sep_thr[2], 1),
+
+    // @Param: TSEP4
+    // @DisplayName: Throttle gain at separation 4
+    // @Description: Multiplier on the RelNAV throttle PID at separation breakpoint 4
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("TSEP4", 12, AP_GainSchedule, _sep_thr[3], 1),
+
+    // @Param: SPD1
+    // @DisplayName: Airspeed breakpoint 1
+    // @Description: Airspeed at breakpoint 1 of the airspeed tables. Breakpoints must increase
+    // @Units: m/s
+    // @Range: 0 50
+    // @User: Advanced
+    AP_GROUPINFO("SPD1", 13, AP_GainSchedule, _spd[0], 10),
+
+    // @Param: SPD2
+    // @DisplayName: Airspeed breakpoint 2
+    // @Description: Airspeed at breakpoint 2 of the airspeed tables. Breakpoints must increase
+    // @Units: m/s
+    // @Range: 0 50
+    // @User: Advanced
+    AP_GROUPINFO("SPD2", 14, AP_GainSchedule, _spd[1], 14),
+
+    // @Param: SPD3
+    // @DisplayName: Airspeed breakpoint 3
+    // @Description: Airspeed at breakpoint 3 of the airspeed tables. Breakpoints must increase
+    // @Units: m/s
+    // @Range: 0 50
+    // @User: Advanced
+    AP_GROUPINFO("SPD3", 15, AP_GainSchedule, _spd[2], 18),
+
+    // @Param: SPD4
+    // @DisplayName: Airspeed breakpoint 4
+    // @Description: Airspeed at breakpoint 4 of the airspeed tables. Breakpoints must increase
+    // @Units: m/s
+    // @Range: 0 50
+    // @User: Advanced
+    AP_GROUPINFO("SPD4", 16, AP_GainSchedule, _spd[3], 22),
+
+    // @Param: PSPD1
+    // @DisplayName: Pitch gain at airspeed 1
+    // @Description: Multiplier on the RelNAV pitch PID at airspeed breakpoint 1
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("PSPD1", 17, AP_GainSchedule, _spd_pitch[0], 1),
+
+    // @Param: PSPD2
+    // @DisplayName: Pitch gain at airspeed 2
+    // @Description: Multiplier on the RelNAV pitch PID at airspeed breakpoint 2
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("PSPD2", 18, AP_GainSchedule, _spd_pitch[1], 1),
+
+    // @Param: PSPD3
+    // @DisplayName: Pitch gain at airspeed 3
+    // @Description: Multiplier on the RelNAV pitch PID at airspeed breakpoint 3
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("PSPD3", 19, AP_GainSchedule, _spd_pitch[2], 1),
+
+    // @Param: PSPD4
+    // @DisplayName: Pitch gain at airspeed 4
+    // @Description: Multiplier on the RelNAV pitch PID at airspeed breakpoint 4
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("PSPD4", 20, AP_GainSchedule, _spd_pitch[3], 1),
+
+    // @Param: TSPD1
+    // @DisplayName: Throttle gain at airspeed 1
+    // @Description: Multiplier on the RelNAV throttle PID at airspeed breakpoint 1
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("TSPD1", 21, AP_GainSchedule, _spd_thr[0], 1),
+
+    // @Param: TSPD2
+    // @DisplayName: Throttle gain at airspeed 2
+    // @Description: Multiplier on the RelNAV throttle PID at airspeed breakpoint 2
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("TSPD2", 22, AP_GainSchedule, _spd_thr[1], 1),
+
+    // @Param: TSPD3
+    // @DisplayName: Throttle gain at airspeed 3
+    // @Description: Multiplier on the RelNAV throttle PID at airspeed breakpoint 3
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("TSPD3", 23, AP_GainSchedule, _spd_thr[2], 1),
+
+    // @Param: TSPD4
+    // @DisplayName: Throttle gain at airspeed 4
+    // @Description: Multiplier on the RelNAV throttle PID at airspeed breakpoint 4
+    // @Range: 0 5
+    // @User: Advanced
+    AP_GROUPINFO("TSPD4", 24, AP_GainSchedule, _spd_thr[3], 1),
+
+    AP_GROUPEND
+};
+
+AP_GainSchedule::AP_GainSchedule() :
+    _k1(0),
+    _k3(0),
+    _k5(0),
+    _have_shape(false)
+{
+}
+
+void
+AP_GainSchedule::update(float k1, float k3, float k5)
+{
+    if (!_have_shape || k1 != _k1 || k3 != _k3 || k5 != _k5) {
+        build_shape(k1, k3, k5);
+    }
+    build_curve(_pitch_sep, _sep, _sep_pitch);
+    build_curve(_thr_sep, _sep, _sep_thr);
+    build_curve(_pitch_spd, _spd, _spd_pitch);
+    build_curve(_thr_spd, _spd, _spd_thr);
+}
+
+/*
+  tabulate k1*e + 1e-2*k3*100*(e/100)^3 + 1e-5*k5*100*(e/100)^5 for
+  e >= 0 in centi-degrees. The breakpoints are spaced quadratically so
+  the table is finest near zero error, where the aircraft spends its
+  time
+ */
+void
+AP_GainSchedule::build_shape(float k1, float k3, float k5)
+{
+    for (uint8_t i=0; i<GAINSCHED_SHAPE_POINTS; i++) {
+        float f = i / (float)(GAINSCHED_SHAPE_POINTS-1);
+        float e = GAINSCHED_SHAPE_MAX * f * f;
+        float d = e * 0.01;
+        float d3 = d*d*d;
+        _shape_x[i] = e;
+        _shape_y[i] = k1*e + k3*d3 + 1e-3*k5*d3*d*d;
+        if (i > 0) {
+            _shape_k[i-1] = (_shape_y[i] - _shape_y[i-1]) / (e - _shape_x[i-1]);
+        }
+    }
+    _shape_k[GAINSCHED_SHAPE_POINTS-1] = _shape_k[GAINSCHED_SHAPE_POINTS-2];
+    _k1 = k1;
+    _k3 = k3;
+    _k5 = k5;
+    _have_shape = true;
+}
+
+void
+AP_GainSchedule::build_curve(AP_Curve<float,GAINSCHED_POINTS> &curve,
+                             AP_Float *x, AP_Float *y)
+{
+    float last = x[0];
+    curve.clear();
+    curve.add_point(x[0], y[0]);
+    for (uint8_t i=1; i<GAINSCHED_POINTS; i++) {
+        // skip breakpoints that don't increase, they would give an
+        // infinite or negative slope
+        if (x[i] > last) {
+            curve.add_point(x[i], y[i]);
+            last = x[i];
+        }
+    }
+}
+
+/*
+  the breakpoints are at GAINSCHED_SHAPE_MAX * (i/(N-1))^2, so the
+  segment holding e starts at breakpoint sqrt(e/GAINSCHED_SHAPE_MAX) *
+  (N-1). This runs on every calc_nav_roll(), where a search through
+  the 24 breakpoints would cost more than the square root
+ */
+float
+AP_GainSchedule::shape_roll(int32_t bearing_error_cd)
+{
+    float e = labs(bearing_error_cd);
+    uint8_t i;
+
+    if (e >= GAINSCHED_SHAPE_MAX) {
+        i = GAINSCHED_SHAPE_POINTS-1;
+    } else {
+        i = sqrt(e / GAINSCHED_SHAPE_MAX) * (GAINSCHED_SHAPE_POINTS-1);
+        if (i > GAINSCHED_SHAPE_POINTS-2) {
+            i = GAINSCHED_SHAPE_POINTS-2;
+        }
+        // rounding can put e just outside the segment
+        if (e < _shape_x[i] && i > 0) {
+            i--;
+        } else if (e > _shape_x[i+1]) {
+            i++;
+        }
+    }
+    float y = _shape_y[i] + (e - _shape_x[i]) * _shape_k[i];
+    return (bearing_error_cd < 0) ? -y : y;
+}
+
+float
+AP_GainSchedule::pitch_scaler(float separation, float airspeed)
+{
+    if (!_enable) {
+        return 1.0;
+    }
+    return _pitch_sep.get_y(separation) * _pitch_spd.get_y(airspeed);
+}
+
+float
+AP_GainSchedule::throttle_scaler(float separation, float airspeed)
+{
+    if (!_enable) {
+        return 1.0;
+    }
+    return _thr_sep.get_y(separation) * _thr_spd.get_y(airspeed);
+}
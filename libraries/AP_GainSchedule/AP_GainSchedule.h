@@ -0,0 +1,82 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_GainSchedule.h
+/// @brief	Gain scheduling for the RelNAV controllers from piecewise
+///			linear lookup tables.
+///
+/// The tables are rebuilt from the parameters at a low rate by update(),
+/// so the control loops only interpolate. The roll shaping table holds
+/// the odd polynomial k1*e + k3*e^3 + k5*e^5 of the bearing error, and
+/// the gain tables hold multipliers for the RelNAV pitch and throttle
+/// PIDs as functions of the separation from the leader and of airspeed.
+/// The two multipliers for each PID are applied together.
+
+#ifndef AP_GAINSCHEDULE_H
+#define AP_GAINSCHEDULE_H
+
+#include <AP_Common.h>
+#include <AP_Math.h>
+#include <AP_Curve.h>
+
+// breakpoints in each gain table
+#define GAINSCHED_POINTS        4
+
+// breakpoints in the roll shaping table, bunched towards zero error
+#define GAINSCHED_SHAPE_POINTS  24
+
+// bearing error covered by the roll shaping table, centi-degrees. The
+// last segment is extended to larger errors
+#define GAINSCHED_SHAPE_MAX     9000
+
+/// @class	AP_GainSchedule
+/// @brief	Lookup tables for the RelNAV control laws
+class AP_GainSchedule {
+public:
+    AP_GainSchedule();
+
+    /// rebuild the gain tables from the parameters, and the roll shaping
+    /// table if the shaping coefficients have changed
+    void            update(float k1, float k3, float k5);
+
+    /// shaped bearing error, centi-degrees
+    float           shape_roll(int32_t bearing_error_cd);
+
+    /// multiplier for the RelNAV pitch PID at a separation (m) and
+    /// airspeed (m/s). 1 when scheduling is disabled
+    float           pitch_scaler(float separation, float airspeed);
+
+    /// multiplier for the RelNAV throttle PID
+    float           throttle_scaler(float separation, float airspeed);
+
+    static const struct AP_Param::GroupInfo        var_info[];
+
+private:
+    void            build_shape(float k1, float k3, float k5);
+    void            build_curve(AP_Curve<float,GAINSCHED_POINTS> &curve,
+                                AP_Float *x, AP_Float *y);
+
+    AP_Int8         _enable;
+    AP_Float        _sep[GAINSCHED_POINTS];
+    AP_Float        _sep_pitch[GAINSCHED_POINTS];
+    AP_Float        _sep_thr[GAINSCHED_POINTS];
+    AP_Float        _spd[GAINSCHED_POINTS];
+    AP_Float        _spd_pitch[GAINSCHED_POINTS];
+    AP_Float        _spd_thr[GAINSCHED_POINTS];
+
+    AP_Curve<float,GAINSCHED_POINTS> _pitch_sep;
+    AP_Curve<float,GAINSCHED_POINTS> _thr_sep;
+    AP_Curve<float,GAINSCHED_POINTS> _pitch_spd;
+    AP_Curve<float,GAINSCHED_POINTS> _thr_spd;
+
+    // coefficients the shaping table was built with
+    float           _k1, _k3, _k5;
+
+    // roll shaping table. Its breakpoints are at known positions, so
+    // shape_roll() finds the segment directly rather than searching
+    float           _shape_x[GAINSCHED_SHAPE_POINTS];
+    float           _shape_y[GAINSCHED_SHAPE_POINTS];
+    float           _shape_k[GAINSCHED_SHAPE_POINTS];   // slope from each point, the last one is used beyond the table
+    bool            _have_shape;
+};
+
+#endif // AP_GAINSCHEDULE_H
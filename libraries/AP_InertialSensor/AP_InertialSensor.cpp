@@ -10,6 +10,8 @@
 
 #define SAMPLE_UNIT 1
 
+AP_InertialSensor::raw_sample_cb AP_InertialSensor::_raw_sample_cb;
+
 // Class level parameters
 const AP_Param::GroupInfo AP_InertialSensor::var_info[] PROGMEM = {
     // @Param: PRODUCT_ID
@@ -124,6 +124,13 @@ public:
     // get number of samples read from the sensors
     virtual uint16_t        num_samples_available() = 0;
 
+    // a function to be called from the sensor interrupt or timer
+    // process with every raw sample. The sample is gyro x,y,z then
+    // accel x,y,z in sensor counts, mapped to the board axes. It
+    // must be quick
+    typedef void (*raw_sample_cb)(const int16_t sample[6]);
+    void                    set_raw_sample_callback(raw_sample_cb cb) { _raw_sample_cb = cb; }
+
     // class level parameters
     static const struct AP_Param::GroupInfo var_info[];
 
@@ -149,6 +156,9 @@ protected:
     // save parameters to eeprom
     void                    _save_parameters();
 
+    // called with each raw sample, if set
+    static raw_sample_cb    _raw_sample_cb;
+
     // Most recent accelerometer reading obtained by ::update
     Vector3f                _accel;
 
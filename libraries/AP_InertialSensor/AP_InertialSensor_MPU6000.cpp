@@ -184,8 +184,8 @@ const uint8_t AP_InertialSensor_MPU6000::_temp_data_index = 3;
 int16_t AP_InertialSensor_MPU6000::_mpu6000_product_id = AP_PRODUCT_ID_NONE;
 
 // variables to calculate time period over which a group of samples were collected
-static volatile uint32_t _delta_time_micros = 1;   // time period overwhich samples were collected (initialise to non-zero number but will be overwritten on 2nd read in any case)
-static volatile uint32_t _delta_time_start_micros = 0;  // time we start collecting sample (reset on update)
+static uint32_t _delta_time_micros = 1;   // time period overwhich samples were collected (initialise to non-zero number but will be overwritten on 2nd read in any case)
+static uint32_t _delta_time_start_micros = 0;  // time we start collecting sample (reset on update)
 static volatile uint32_t _last_sample_time_micros = 0;  // time latest sample was collected
 
 // DMP related static variables
@@ -221,17 +221,29 @@ uint16_t AP_InertialSensor_MPU6000::_init_sensor( AP_PeriodicProcess * scheduler
     return _mpu6000_product_id;
 }
 
-// accumulation in ISR - must be read with interrupts disabled
-// the sum of the values since last read
-static volatile int32_t _sum[7];
+// running totals, only touched by the timer process and published to
+// the sensor bus after each read
+static struct sensor_imu _totals;
 
-// how many values we've accumulated since last read
-static volatile uint16_t _count;
+AP_TopicOf<struct sensor_imu> sensor_imu_topic(SENSOR_TOPIC_IMU);
+
+// the totals already averaged by update(), and their version
+static struct sensor_imu _used;
+static uint16_t _used_version;
+
+// true if update() has not averaged for so long that the count may
+// have wrapped
+static bool long_gap(uint32_t sample_time_micros)
+{
+    return sample_time_micros - _delta_time_start_micros > SENSOR_MAX_AVERAGE_US;
+}
 
 /*================ AP_INERTIALSENSOR PUBLIC INTERFACE ==================== */
 
 bool AP_InertialSensor_MPU6000::update( void )
 {
+    struct sensor_imu s;
+    uint32_t sample_time_micros;
     int32_t sum[7];
     uint16_t count;
     float count_scale;
@@ -240,22 +252,28 @@ bool AP_InertialSensor_MPU6000::update( void )
     Vector3f accel_offset = _accel_offset.get();
 
     // wait for at least 1 sample
-    while (_count == 0) /* nop */;
-
-    // disable interrupts for mininum time
-    uint8_t oldSREG = SREG;
-    cli();
-    for (int i=0; i<7; i++) {
-        sum[i] = _sum[i];
-        _sum[i] = 0;
+    do {
+        _used_version = sensor_imu_topic.read(s, &sample_time_micros);
+    } while (s.count == _used.count && !long_gap(sample_time_micros));
+
+    if (long_gap(sample_time_micros)) {
+        // the count may have wrapped, take the newest sample
+        for (int i=0; i<7; i++) {
+            sum[i] = s.raw[i];
+        }
+        count = 1;
+    } else {
+        // the totals since the last update
+        for (int i=0; i<7; i++) {
+            sum[i] = (int32_t)(s.sum[i] - _used.sum[i]);
+        }
+        count = s.count - _used.count;
     }
-    count = _count;
-    _count = 0;
+    _used = s;
 
     // record sample time
-    _delta_time_micros = _last_sample_time_micros - _delta_time_start_micros;
-    _delta_time_start_micros = _last_sample_time_micros;
-    SREG = oldSREG;
+    _delta_time_micros = sample_time_micros - _delta_time_start_micros;
+    _delta_time_start_micros = sample_time_micros;
 
     count_scale = 1.0 / count;
 
@@ -276,7 +294,7 @@ bool AP_InertialSensor_MPU6000::update( void )
 
 bool AP_InertialSensor_MPU6000::new_data_available( void )
 {
-    return _count != 0;
+    return sensor_imu_topic.updated_since(_used_version);
 }
 
 float AP_InertialSensor_MPU6000::temperature() {
@@ -295,7 +313,7 @@ static int16_t spi_transfer_16(void)
 
 /*
  *  this is called from the data_interrupt which fires when the MPU6000 has new sensor data available
- *  and add it to _sum[]
+ *  and adds it to the totals published on the sensor bus
  *  Note: it is critical that no other devices on the same SPI bus attempt to read at the same time
  *        to ensure this is the case, these other devices must perform their SPI reads after being
  *        called by the AP_TimerProcess.
@@ -304,19 +322,28 @@ void AP_InertialSensor_MPU6000::read(uint32_t)
 {
     // now read the data
     digitalWrite(MPU6000_CS_PIN, LOW);
+    int16_t *raw = _totals.raw;
     byte addr = MPUREG_ACCEL_XOUT_H | 0x80;
     SPI.transfer(addr);
     for (uint8_t i=0; i<7; i++) {
-        _sum[i] += spi_transfer_16();
+        raw[i] = spi_transfer_16();
+        _totals.sum[i] += raw[i];
     }
     digitalWrite(MPU6000_CS_PIN, HIGH);
 
-    _count++;
-    if (_count == 0) {
-        // rollover - v unlikely
-        memset((void*)_sum, 0, sizeof(_sum));
+    if (_raw_sample_cb != NULL) {
+        int16_t sample[6];
+        for (uint8_t i=0; i<3; i++) {
+            sample[i]   = _gyro_data_sign[i]  * raw[_gyro_data_index[i]];
+            sample[i+3] = _accel_data_sign[i] * raw[_accel_data_index[i]];
+        }
+        _raw_sample_cb(sample);
     }
 
+    // the totals wrap, update() only uses differences
+    _totals.count++;
+    sensor_imu_topic.publish(_totals, _last_sample_time_micros);
+
     // should also read FIFO data if enabled
     if( _dmp_initialised ) {
         if( FIFO_ready() ) {
@@ -477,7 +504,14 @@ float AP_InertialSensor_MPU6000::get_gyro_drift_rate(void)
 // get number of samples read from the sensors
 uint16_t AP_InertialSensor_MPU6000::num_samples_available()
 {
-    return _count;
+    struct sensor_imu s;
+    uint32_t sample_time_micros;
+    sensor_imu_topic.read(s, &sample_time_micros);
+    if (long_gap(sample_time_micros)) {
+        // plenty, whatever the wrapped count says
+        return 0xFFFF;
+    }
+    return s.count - _used.count;
 }
 
 // get_delta_time returns the time period in seconds overwhich the sensor data was collected
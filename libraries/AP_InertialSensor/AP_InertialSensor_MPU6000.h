@@ -8,6 +8,7 @@
 
 #include "../AP_PeriodicProcess/AP_PeriodicProcess.h"
 #include "../AP_Math/AP_Math.h"
+#include "../AP_SensorBus/AP_SensorBus.h"
 #include "AP_InertialSensor.h"
 
 #define MPU6000_CS_PIN       53        // APM pin connected to mpu6000's chip select pin
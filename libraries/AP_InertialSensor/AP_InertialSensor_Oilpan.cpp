@@ -41,9 +41,27 @@ AP_InertialSensor_Oilpan::AP_InertialSensor_Oilpan( AP_ADC * adc ) :
 {
 }
 
+/*
+ *  called from the ADC timer process with every raw sample, to pass
+ *  it on to the raw sample callback as offset-corrected counts
+ */
+void AP_InertialSensor_Oilpan::_adc_sample(const uint16_t *adc)
+{
+    if (_raw_sample_cb == NULL) {
+        return;
+    }
+    int16_t sample[6];
+    for (uint8_t i=0; i<3; i++) {
+        sample[i]   = _sensor_signs[i]   * ((int16_t)adc[_sensors[i]]   - (int16_t)OILPAN_RAW_GYRO_OFFSET);
+        sample[i+3] = _sensor_signs[i+3] * ((int16_t)adc[_sensors[i+3]] - (int16_t)OILPAN_RAW_ACCEL_OFFSET);
+    }
+    _raw_sample_cb(sample);
+}
+
 uint16_t AP_InertialSensor_Oilpan::_init_sensor( AP_PeriodicProcess * scheduler, Sample_rate sample_rate)
 {
     _adc->Init(scheduler);
+    _adc->set_sample_callback(_adc_sample);
 
     switch (sample_rate) {
     case RATE_50HZ:
@@ -31,6 +31,7 @@ protected:
     uint16_t        _init_sensor(AP_PeriodicProcess * scheduler, Sample_rate sample_rate);
 
 private:
+    static void                 _adc_sample(const uint16_t *adc);
 
     AP_ADC *                    _adc;
 
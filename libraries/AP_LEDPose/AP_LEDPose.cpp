@@ -0,0 +1,639 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_LEDPose.cpp
+/// @brief	Five LED perspective-n-point pose solver
+
+#include <math.h>
+#include <string.h>
+#include "AP_LEDPose.h"
+
+// small fixed size linear algebra, kept local so the library does not
+// depend on the Arduino side of AP_Math
+
+static inline float dot3(const float a[3], const float b[3])
+{
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+static inline void cross3(const float a[3], const float b[3], float r[3])
+{
+    r[0] = a[1]*b[2] - a[2]*b[1];
+    r[1] = a[2]*b[0] - a[0]*b[2];
+    r[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+static inline void sub3(const float a[3], const float b[3], float r[3])
+{
+    r[0] = a[0] - b[0];
+    r[1] = a[1] - b[1];
+    r[2] = a[2] - b[2];
+}
+
+static inline bool normalize3(float v[3])
+{
+    float len = sqrtf(dot3(v, v));
+    if (len < 1.0e-9f) {
+        return false;
+    }
+    v[0] /= len;
+    v[1] /= len;
+    v[2] /= len;
+    return true;
+}
+
+// r = A * v
+static inline void mul33v(const float A[3][3], const float v[3], float r[3])
+{
+    r[0] = A[0][0]*v[0] + A[0][1]*v[1] + A[0][2]*v[2];
+    r[1] = A[1][0]*v[0] + A[1][1]*v[1] + A[1][2]*v[2];
+    r[2] = A[2][0]*v[0] + A[2][1]*v[1] + A[2][2]*v[2];
+}
+
+// C = A * B
+static void mul33(const float A[3][3], const float B[3][3], float C[3][3])
+{
+    for (uint8_t i=0; i<3; i++) {
+        for (uint8_t j=0; j<3; j++) {
+            C[i][j] = A[i][0]*B[0][j] + A[i][1]*B[1][j] + A[i][2]*B[2][j];
+        }
+    }
+}
+
+/*
+  evaluate c[0] x^n + c[1] x^(n-1) + ... + c[n]
+ */
+static double poly_eval(const double *c, uint8_t n, double x)
+{
+    double p = c[0];
+    for (uint8_t i=1; i<=n; i++) {
+        p = p*x + c[i];
+    }
+    return p;
+}
+
+/*
+  real roots of a polynomial of degree n <= 4 in [lo, hi], in
+  increasing order. The roots of the derivative split the range into
+  monotonic pieces, and each sign change is found by bisection
+ */
+static uint8_t poly_roots(const double *c, uint8_t n, double lo, double hi, double *roots)
+{
+    // drop vanishing leading terms
+    while (n > 0 && fabs(c[0]) < 1.0e-12) {
+        c++;
+        n--;
+    }
+    if (n == 0) {
+        return 0;
+    }
+    if (n == 1) {
+        double x = -c[1] / c[0];
+        if (x >= lo && x <= hi) {
+            roots[0] = x;
+            return 1;
+        }
+        return 0;
+    }
+
+    double d[4];
+    double ends[5];
+    uint8_t nends;
+    for (uint8_t i=0; i<n; i++) {
+        d[i] = c[i] * (n - i);
+    }
+    ends[0] = lo;
+    nends = 1 + poly_roots(d, n-1, lo, hi, &ends[1]);
+    ends[nends++] = hi;
+
+    uint8_t count = 0;
+    for (uint8_t i=0; i<nends-1; i++) {
+        double a = ends[i], b = ends[i+1];
+        double fa = poly_eval(c, n, a);
+        double fb = poly_eval(c, n, b);
+        if (fa == 0) {
+            if (count == 0 || roots[count-1] != a) {
+                roots[count++] = a;
+            }
+            continue;
+        }
+        if ((fa < 0) == (fb < 0)) {
+            continue;
+        }
+        for (uint8_t k=0; k<60; k++) {
+            double m = 0.5*(a + b);
+            double fm = poly_eval(c, n, m);
+            if ((fm < 0) == (fa < 0)) {
+                a = m;
+                fa = fm;
+            } else {
+                b = m;
+            }
+        }
+        roots[count++] = 0.5*(a + b);
+    }
+    return count;
+}
+
+/*
+  rotation R and translation t taking three points P (leader frame) to
+  Q (camera frame), from an orthonormal triad built on each set
+ */
+static bool absolute_orientation(const float P[3][3], const float Q[3][3], float R[3][3], float t[3])
+{
+    float eP[3][3], eQ[3][3], v[3];
+
+    sub3(P[1], P[0], eP[0]);
+    sub3(P[2], P[0], v);
+    cross3(eP[0], v, eP[2]);
+    sub3(Q[1], Q[0], eQ[0]);
+    sub3(Q[2], Q[0], v);
+    cross3(eQ[0], v, eQ[2]);
+    if (!normalize3(eP[0]) || !normalize3(eP[2]) ||
+        !normalize3(eQ[0]) || !normalize3(eQ[2])) {
+        return false;
+    }
+    cross3(eP[2], eP[0], eP[1]);
+    cross3(eQ[2], eQ[0], eQ[1]);
+
+    // R = sum of eQ_k eP_k'
+    for (uint8_t i=0; i<3; i++) {
+        for (uint8_t j=0; j<3; j++) {
+            R[i][j] = eQ[0][i]*eP[0][j] + eQ[1][i]*eP[1][j] + eQ[2][i]*eP[2][j];
+        }
+    }
+
+    // match the centroids
+    float cP[3], cQ[3], RcP[3];
+    for (uint8_t i=0; i<3; i++) {
+        cP[i] = (P[0][i] + P[1][i] + P[2][i]) / 3;
+        cQ[i] = (Q[0][i] + Q[1][i] + Q[2][i]) / 3;
+    }
+    mul33v(R, cP, RcP);
+    sub3(cQ, RcP, t);
+    return true;
+}
+
+/*
+  solve H x = b for a symmetric positive definite 6x6 H by Cholesky
+  decomposition, in place
+ */
+static bool cholesky_solve6(float H[6][6], float b[6])
+{
+    for (uint8_t j=0; j<6; j++) {
+        float s = H[j][j];
+        for (uint8_t k=0; k<j; k++) {
+            s -= H[j][k]*H[j][k];
+        }
+        if (s <= 1.0e-12f) {
+            return false;
+        }
+        H[j][j] = sqrtf(s);
+        for (uint8_t i=j+1; i<6; i++) {
+            float r = H[i][j];
+            for (uint8_t k=0; k<j; k++) {
+                r -= H[i][k]*H[j][k];
+            }
+            H[i][j] = r / H[j][j];
+        }
+    }
+    for (uint8_t i=0; i<6; i++) {
+        float s = b[i];
+        for (uint8_t k=0; k<i; k++) {
+            s -= H[i][k]*b[k];
+        }
+        b[i] = s / H[i][i];
+    }
+    for (int8_t i=5; i>=0; i--) {
+        float s = b[i];
+        for (uint8_t k=i+1; k<6; k++) {
+            s -= H[k][i]*b[k];
+        }
+        b[i] = s / H[i][i];
+    }
+    return true;
+}
+
+AP_LEDPose::AP_LEDPose() :
+    _fx(1), _fy(1), _cx(0), _cy(0),
+    _count(0),
+    _led_mask(0),
+    _rms_error(0),
+    _iterations(0),
+    _valid(false),
+    _tracking(false),
+    _have_pose(false),
+    _tracked(false)
+{
+    memset(_leds, 0, sizeof(_leds));
+    memset(_R, 0, sizeof(_R));
+    memset(_t, 0, sizeof(_t));
+    memset(_offset, 0, sizeof(_offset));
+
+    // forward looking camera: body x is the optical axis, body y is
+    // image right and body z is image down
+    memset(_mount, 0, sizeof(_mount));
+    _mount[0][2] = 1;
+    _mount[1][0] = 1;
+    _mount[2][1] = 1;
+}
+
+void AP_LEDPose::set_camera(float fx, float fy, float cx, float cy)
+{
+    _fx = fx;
+    _fy = fy;
+    _cx = cx;
+    _cy = cy;
+}
+
+void AP_LEDPose::set_leds(const float leds[LEDPOSE_NUM_LEDS][3])
+{
+    memcpy(_leds, leds, sizeof(_leds));
+    _have_pose = false;
+}
+
+void AP_LEDPose::set_mount(const float rotation[3][3], const float offset[3])
+{
+    memcpy(_mount, rotation, sizeof(_mount));
+    memcpy(_offset, offset, sizeof(_offset));
+}
+
+/*
+  normalised image coordinates of the LEDs in view. Returns their number
+ */
+uint8_t AP_LEDPose::load_centroids(const float centroids[LEDPOSE_NUM_LEDS][2], uint8_t led_mask)
+{
+    _count = 0;
+    for (uint8_t i=0; i<LEDPOSE_NUM_LEDS; i++) {
+        if (led_mask & (1<<i)) {
+            _idx[_count] = i;
+            _m[_count][0] = (centroids[i][0] - _cx) / _fx;
+            _m[_count][1] = (centroids[i][1] - _cy) / _fy;
+            _count++;
+        }
+    }
+    _led_mask = led_mask & RELNAV_LED_ALL;
+    _valid = false;
+    _tracked = false;
+    _iterations = 0;
+    return _count;
+}
+
+bool AP_LEDPose::solve(const float centroids[LEDPOSE_NUM_LEDS][2], uint8_t led_mask)
+{
+    if (load_centroids(centroids, led_mask) < 4) {
+        _have_pose = false;
+        return false;
+    }
+
+    // continue from the last pose if we have one
+    if (_tracking && _have_pose) {
+        if (refine() && _rms_error < LEDPOSE_MAX_ERROR) {
+            _valid = true;
+            _tracked = true;
+            return true;
+        }
+    }
+
+    if (p3p_init() && refine() && _rms_error < LEDPOSE_MAX_ERROR) {
+        _valid = true;
+    }
+    _have_pose = _valid;
+    return _valid;
+}
+
+/*
+  with the rotation known, each LED gives two equations that are linear
+  in the translation:
+
+    t.x - x t.z = x q.z - q.x
+    t.y - y t.z = y q.z - q.y
+
+  where q = R P and (x,y) is its normalised image position. They are
+  solved in the least squares sense
+ */
+bool AP_LEDPose::solve_position(const float centroids[LEDPOSE_NUM_LEDS][2], uint8_t led_mask,
+                                const float rotation[3][3])
+{
+    if (load_centroids(centroids, led_mask) < 2) {
+        _have_pose = false;
+        return false;
+    }
+
+    // leader body to camera, R = mount' rotation
+    for (uint8_t i=0; i<3; i++) {
+        for (uint8_t j=0; j<3; j++) {
+            _R[i][j] = _mount[0][i]*rotation[0][j] + _mount[1][i]*rotation[1][j] + _mount[2][i]*rotation[2][j];
+        }
+    }
+
+    // normal equations A'A t = A'b
+    float sx = 0, sy = 0, sxy2 = 0, bx = 0, by = 0, bz = 0;
+    for (uint8_t i=0; i<_count; i++) {
+        float q[3];
+        mul33v(_R, _leds[_idx[i]], q);
+        float x = _m[i][0], y = _m[i][1];
+        float rx = x*q[2] - q[0];
+        float ry = y*q[2] - q[1];
+        sx += x;
+        sy += y;
+        sxy2 += x*x + y*y;
+        bx += rx;
+        by += ry;
+        bz -= x*rx + y*ry;
+    }
+    float n = _count;
+    float N[3][3] = {
+        { n,   0,   -sx  },
+        { 0,   n,   -sy  },
+        { -sx, -sy, sxy2 }
+    };
+    float det = n*(n*sxy2 - sy*sy) - sx*sx*n;
+    if (fabsf(det) < 1.0e-9f) {
+        _have_pose = false;
+        return false;
+    }
+
+    // Cramer's rule
+    float b[3] = { bx, by, bz };
+    for (uint8_t k=0; k<3; k++) {
+        float M[3][3];
+        memcpy(M, N, sizeof(M));
+        for (uint8_t i=0; i<3; i++) {
+            M[i][k] = b[i];
+        }
+        _t[k] = (M[0][0]*(M[1][1]*M[2][2] - M[1][2]*M[2][1])
+                 - M[0][1]*(M[1][0]*M[2][2] - M[1][2]*M[2][0])
+                 + M[0][2]*(M[1][0]*M[2][1] - M[1][1]*M[2][0])) / det;
+    }
+
+    _rms_error = reprojection_error(_R, _t);
+    _valid = _rms_error < LEDPOSE_MAX_ERROR;
+    _have_pose = _valid;
+    return _valid;
+}
+
+/*
+  RMS reprojection error over the visible LEDs, pixels
+ */
+float AP_LEDPose::reprojection_error(const float R[3][3], const float t[3])
+{
+    float err2 = 0;
+    for (uint8_t i=0; i<_count; i++) {
+        float X[3];
+        mul33v(R, _leds[_idx[i]], X);
+        X[0] += t[0];
+        X[1] += t[1];
+        X[2] += t[2];
+        if (X[2] <= 0) {
+            return INFINITY;
+        }
+        float ex = _fx * (X[0]/X[2] - _m[i][0]);
+        float ey = _fy * (X[1]/X[2] - _m[i][1]);
+        err2 += ex*ex + ey*ey;
+    }
+    return sqrtf(err2 / _count);
+}
+
+/*
+  closed form initial pose. Each P3P solution over three of the
+  visible LEDs is scored on all of them, and the best kept. Further
+  triples are only tried if the first gives no acceptable pose, e.g.
+  when its LEDs are nearly collinear in the image
+ */
+bool AP_LEDPose::p3p_init(void)
+{
+    float R[4][3][3], t[4][3];
+    float best = INFINITY;
+
+    for (uint8_t a=0; a<_count-2; a++) {
+        for (uint8_t b=a+1; b<_count-1; b++) {
+            for (uint8_t c=b+1; c<_count; c++) {
+                const uint8_t pts[3] = { a, b, c };
+                uint8_t n = p3p(pts, R, t);
+                for (uint8_t k=0; k<n; k++) {
+                    float err = reprojection_error(R[k], t[k]);
+                    if (err < best) {
+                        best = err;
+                        memcpy(_R, R[k], sizeof(_R));
+                        memcpy(_t, t[k], sizeof(_t));
+                    }
+                }
+                if (best < LEDPOSE_MAX_ERROR) {
+                    return true;
+                }
+            }
+        }
+    }
+    // let Gauss-Newton try to pull in a rough start
+    return best < 10*LEDPOSE_MAX_ERROR;
+}
+
+/*
+  Grunert's P3P solution (see Haralick et al, "Review and analysis of
+  solutions of the three point perspective pose estimation problem").
+  The distances along the rays are s1, u*s1 and v*s1, where v is a root
+  of a quartic. Returns the number of solutions, at most four
+ */
+uint8_t AP_LEDPose::p3p(const uint8_t pts[3], float R[4][3][3], float t[4][3])
+{
+    float f[3][3], P[3][3], v3[3];
+
+    for (uint8_t i=0; i<3; i++) {
+        f[i][0] = _m[pts[i]][0];
+        f[i][1] = _m[pts[i]][1];
+        f[i][2] = 1;
+        normalize3(f[i]);
+        memcpy(P[i], _leds[_idx[pts[i]]], sizeof(P[i]));
+    }
+
+    sub3(P[1], P[2], v3);
+    double a2 = dot3(v3, v3);
+    sub3(P[0], P[2], v3);
+    double b2 = dot3(v3, v3);
+    sub3(P[0], P[1], v3);
+    double c2 = dot3(v3, v3);
+    if (b2 < 1.0e-6) {
+        return 0;
+    }
+
+    double ca = dot3(f[1], f[2]);
+    double cb = dot3(f[0], f[2]);
+    double cg = dot3(f[0], f[1]);
+
+    double amc = (a2 - c2) / b2;
+    double apc = (a2 + c2) / b2;
+    double bmc = (b2 - c2) / b2;
+    double bma = (b2 - a2) / b2;
+    double c2b = c2 / b2;
+    double a2b = a2 / b2;
+
+    double coef[5];
+    coef[0] = (amc - 1)*(amc - 1) - 4*c2b*ca*ca;
+    coef[1] = 4*(amc*(1 - amc)*cb - (1 - apc)*ca*cg + 2*c2b*ca*ca*cb);
+    coef[2] = 2*(amc*amc - 1 + 2*amc*amc*cb*cb + 2*bmc*ca*ca
+                 - 4*apc*ca*cb*cg + 2*bma*cg*cg);
+    coef[3] = 4*(-amc*(1 + amc)*cb + 2*a2b*cg*cg*cb - (1 - apc)*ca*cg);
+    coef[4] = (1 + amc)*(1 + amc) - 4*a2b*cg*cg;
+
+    // v is a ratio of distances in front of the camera
+    double roots[4];
+    uint8_t nroots = poly_roots(coef, 4, 0, 1.0e3, roots);
+
+    uint8_t n = 0;
+    for (uint8_t k=0; k<nroots; k++) {
+        double v = roots[k];
+        double den = 2*(cg - v*ca);
+        if (fabs(den) < 1.0e-9) {
+            continue;
+        }
+        double u = ((amc - 1)*v*v - 2*amc*cb*v + 1 + amc) / den;
+        if (u <= 0) {
+            continue;
+        }
+        double s1sq = c2 / (1 + u*u - 2*u*cg);
+        if (s1sq <= 0) {
+            continue;
+        }
+        double s1 = sqrt(s1sq);
+        double s[3] = { s1, u*s1, v*s1 };
+
+        float Q[3][3];
+        for (uint8_t i=0; i<3; i++) {
+            Q[i][0] = s[i]*f[i][0];
+            Q[i][1] = s[i]*f[i][1];
+            Q[i][2] = s[i]*f[i][2];
+        }
+        if (absolute_orientation(P, Q, R[n], t[n])) {
+            n++;
+        }
+    }
+    return n;
+}
+
+/*
+  Gauss-Newton refinement of _R and _t on the reprojection error in
+  normalised image coordinates. The rotation is updated by a small
+  rotation on the left, R <- exp([w]x) R
+ */
+bool AP_LEDPose::refine(void)
+{
+    for (_iterations=0; _iterations<LEDPOSE_MAX_ITERATIONS; ) {
+        float H[6][6], g[6];
+        memset(H, 0, sizeof(H));
+        memset(g, 0, sizeof(g));
+
+        for (uint8_t i=0; i<_count; i++) {
+            float RP[3];
+            mul33v(_R, _leds[_idx[i]], RP);
+            float X = RP[0] + _t[0];
+            float Y = RP[1] + _t[1];
+            float Z = RP[2] + _t[2];
+            if (Z <= 0) {
+                return false;
+            }
+            float iz = 1.0f / Z;
+            float x = X*iz, y = Y*iz;
+            float r[2] = { x - _m[i][0], y - _m[i][1] };
+
+            // d(x,y)/dX, and dX/dw = -[RP]x
+            float J[2][6];
+            J[0][3] = iz;  J[0][4] = 0;   J[0][5] = -x*iz;
+            J[1][3] = 0;   J[1][4] = iz;  J[1][5] = -y*iz;
+            for (uint8_t k=0; k<2; k++) {
+                J[k][0] = J[k][5]*RP[1] - J[k][4]*RP[2];
+                J[k][1] = J[k][3]*RP[2] - J[k][5]*RP[0];
+                J[k][2] = J[k][4]*RP[0] - J[k][3]*RP[1];
+            }
+
+            for (uint8_t a=0; a<6; a++) {
+                g[a] -= J[0][a]*r[0] + J[1][a]*r[1];
+                for (uint8_t b=0; b<=a; b++) {
+                    H[a][b] += J[0][a]*J[0][b] + J[1][a]*J[1][b];
+                }
+            }
+        }
+        for (uint8_t a=0; a<6; a++) {
+            for (uint8_t b=a+1; b<6; b++) {
+                H[a][b] = H[b][a];
+            }
+        }
+
+        if (!cholesky_solve6(H, g)) {
+            return false;
+        }
+        _iterations++;
+
+        // apply the rotation step by Rodrigues' formula
+        float theta = sqrtf(g[0]*g[0] + g[1]*g[1] + g[2]*g[2]);
+        if (theta > 1.0e-9f) {
+            float k[3] = { g[0]/theta, g[1]/theta, g[2]/theta };
+            float s = sinf(theta), c = 1 - cosf(theta);
+            float dR[3][3] = {
+                { 1 - c*(k[1]*k[1] + k[2]*k[2]), -s*k[2] + c*k[0]*k[1],          s*k[1] + c*k[0]*k[2] },
+                { s*k[2] + c*k[0]*k[1],          1 - c*(k[0]*k[0] + k[2]*k[2]), -s*k[0] + c*k[1]*k[2] },
+                { -s*k[1] + c*k[0]*k[2],         s*k[0] + c*k[1]*k[2],          1 - c*(k[0]*k[0] + k[1]*k[1]) }
+            };
+            float Rn[3][3];
+            mul33(dR, _R, Rn);
+            memcpy(_R, Rn, sizeof(_R));
+        }
+        _t[0] += g[3];
+        _t[1] += g[4];
+        _t[2] += g[5];
+
+        // converged when the step is well below the measurement noise
+        if (theta < 1.0e-5f && fabsf(g[3]) + fabsf(g[4]) + fabsf(g[5]) < 1.0e-5f*_t[2]) {
+            break;
+        }
+    }
+
+    _rms_error = reprojection_error(_R, _t);
+    return _rms_error < INFINITY;
+}
+
+void AP_LEDPose::get_position(float pos[3]) const
+{
+    mul33v(_mount, _t, pos);
+    pos[0] += _offset[0];
+    pos[1] += _offset[1];
+    pos[2] += _offset[2];
+}
+
+void AP_LEDPose::get_euler(float *roll, float *pitch, float *yaw) const
+{
+    // leader body to follower body
+    float M[3][3];
+    mul33(_mount, _R, M);
+
+    *roll = atan2f(M[2][1], M[2][2]);
+    float s = -M[2][0];
+    if (s > 1) {
+        s = 1;
+    } else if (s < -1) {
+        s = -1;
+    }
+    *pitch = asinf(s);
+    *yaw = atan2f(M[1][0], M[0][0]);
+}
+
+void AP_LEDPose::get_data(struct relnav_data *pkt) const
+{
+    float pos[3], roll, pitch, yaw;
+
+    memcpy(pkt->header, RELNAV_DATA_HEADER, sizeof(pkt->header));
+    if (_valid) {
+        get_position(pos);
+        get_euler(&roll, &pitch, &yaw);
+        pkt->x = pos[0];
+        pkt->y = pos[1];
+        pkt->z = pos[2];
+        pkt->bank = roll * (180 / M_PI);
+        pkt->pitch = pitch * (180 / M_PI);
+        pkt->hdg = yaw * (180 / M_PI);
+    } else {
+        pkt->x = pkt->y = pkt->z = NAN;
+        pkt->bank = pkt->pitch = pkt->hdg = NAN;
+    }
+    pkt->led_mask = _led_mask;
+    pkt->chk = relnav_checksum(pkt, sizeof(*pkt));
+}
@@ -0,0 +1,132 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_LEDPose.h
+/// @brief	Relative pose of the leader from the image centroids of its
+///			five LEDs.
+///
+/// A closed form P3P solution over the visible LEDs (the fourth and
+/// fifth LED pick between the P3P solutions) is refined by Gauss-Newton
+/// on the reprojection error. When tracking, each solve starts from the
+/// previous pose and only falls back to P3P if that fails. With fewer
+/// than four LEDs in view the position can still be solved for, given
+/// the relative attitude.
+///
+/// The library only needs <math.h>, <stdint.h> and RelNAV_Protocol.h,
+/// and does no heap allocation, so it builds unchanged for the vision
+/// computer:
+///
+///   g++ -O2 -I../RelNAV_Protocol -c AP_LEDPose.cpp
+///
+/// Frames:
+///   leader body	x forward, y right, z down, inches
+///   camera		x right, y down, z along the optical axis
+///   follower body	x forward, y right, z down, inches
+
+#ifndef AP_LEDPose_h
+#define AP_LEDPose_h
+
+#include <stdint.h>
+#include <RelNAV_Protocol.h>
+
+#define LEDPOSE_NUM_LEDS        5
+
+// Gauss-Newton iteration limit per solve
+#define LEDPOSE_MAX_ITERATIONS  10
+
+// largest RMS reprojection error, in pixels, of an accepted pose
+#define LEDPOSE_MAX_ERROR       4.0f
+
+/// @class	AP_LEDPose
+/// @brief	Five LED perspective-n-point pose solver
+class AP_LEDPose {
+public:
+    AP_LEDPose();
+
+    /// pinhole camera model in pixels. Centroids given to solve() must
+    /// already be undistorted
+    void            set_camera(float fx, float fy, float cx, float cy);
+
+    /// LED positions in the leader body frame, inches, in the order of
+    /// the RELNAV_LED_* bits
+    void            set_leds(const float leds[LEDPOSE_NUM_LEDS][3]);
+
+    /// camera to follower body rotation and the camera position in the
+    /// follower body frame (inches). Defaults to a forward looking
+    /// camera at the origin
+    void            set_mount(const float rotation[3][3], const float offset[3]);
+
+    /// start each solve from the previous pose while it keeps succeeding
+    void            set_tracking(bool enable) {
+        _tracking = enable;
+        _have_pose = false;
+    }
+
+    /// solve for the leader pose from the pixel centroids of the LEDs
+    /// set in led_mask. At least four LEDs are needed
+    ///
+    /// @returns true if a pose within LEDPOSE_MAX_ERROR was found
+    bool            solve(const float centroids[LEDPOSE_NUM_LEDS][2], uint8_t led_mask);
+
+    /// solve for the leader position only, with its attitude relative to
+    /// the follower known from elsewhere. rotation takes leader body
+    /// axes to follower body axes. Two LEDs are enough
+    ///
+    /// @returns true if a position within LEDPOSE_MAX_ERROR was found
+    bool            solve_position(const float centroids[LEDPOSE_NUM_LEDS][2], uint8_t led_mask,
+                                   const float rotation[3][3]);
+
+    /// relative position of the leader in the follower body frame, inches
+    void            get_position(float pos[3]) const;
+
+    /// attitude of the leader relative to the follower, radians
+    void            get_euler(float *roll, float *pitch, float *yaw) const;
+
+    /// fill a DATA frame from the last solve. x is NaN if it failed
+    void            get_data(struct relnav_data *pkt) const;
+
+    /// RMS reprojection error of the last solve, pixels
+    float           rms_error(void) const { return _rms_error; }
+
+    /// Gauss-Newton iterations used by the last solve
+    uint8_t         iterations(void) const { return _iterations; }
+
+    /// true if the last solve started from the previous pose
+    bool            tracked(void) const { return _tracked; }
+
+private:
+    uint8_t         load_centroids(const float centroids[LEDPOSE_NUM_LEDS][2], uint8_t led_mask);
+    bool            p3p_init(void);
+    uint8_t         p3p(const uint8_t pts[3], float R[4][3][3], float t[4][3]);
+    bool            refine(void);
+    float           reprojection_error(const float R[3][3], const float t[3]);
+
+    // camera
+    float           _fx, _fy, _cx, _cy;
+
+    // leader geometry, inches
+    float           _leds[LEDPOSE_NUM_LEDS][3];
+
+    // camera to follower body
+    float           _mount[3][3];
+    float           _offset[3];
+
+    // normalised image coordinates of the visible LEDs
+    float           _m[LEDPOSE_NUM_LEDS][2];
+    uint8_t         _idx[LEDPOSE_NUM_LEDS];
+    uint8_t         _count;
+    uint8_t         _led_mask;
+
+    // leader body to camera rotation and leader origin in the camera
+    // frame, inches
+    float           _R[3][3];
+    float           _t[3];
+
+    float           _rms_error;
+    uint8_t         _iterations;
+    bool            _valid;
+    bool            _tracking;
+    bool            _have_pose;
+    bool            _tracked;
+};
+
+#endif // AP_LEDPose_h
@@ -0,0 +1,283 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Accuracy and speed of the five LED pose solver on synthetic images
+// of the leader, with Gaussian noise added to the LED centroids
+//
+
+#include <FastSerial.h>
+#include <AP_Common.h>
+#include <RelNAV_Protocol.h>
+#include <AP_LEDPose.h>
+
+FastSerialPort0(Serial);
+
+// poses per noise level
+#define NUM_TRIALS      100
+
+// images in the timing runs
+#define NUM_FRAMES      32
+
+// leader LEDs, inches: wingtips, nose, tail and fin top
+static const float leds[LEDPOSE_NUM_LEDS][3] = {
+    {   0, -36,   0 },
+    {   0,  36,   0 },
+    {  18,   0,   0 },
+    { -30,   0,  -2 },
+    { -28,   0, -12 }
+};
+
+// 640x480 camera
+#define FOCAL           700.0f
+#define CX              320.0f
+#define CY              240.0f
+
+static AP_LEDPose pose;
+
+static uint32_t seed = 1;
+
+// uniform in [0,1)
+static float rand_uniform(void)
+{
+    seed = seed * 1664525UL + 1013904223UL;
+    return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+static float rand_range(float lo, float hi)
+{
+    return lo + (hi - lo) * rand_uniform();
+}
+
+// Box-Muller
+static float rand_gauss(void)
+{
+    float u = rand_uniform();
+    if (u < 1.0e-7f) {
+        u = 1.0e-7f;
+    }
+    return sqrtf(-2*logf(u)) * cosf(2*M_PI*rand_uniform());
+}
+
+struct truth {
+    float pos[3];
+    float roll, pitch, yaw;
+    float R[3][3];
+};
+
+static float wrap_PI(float a)
+{
+    while (a > M_PI) a -= 2*M_PI;
+    while (a < -M_PI) a += 2*M_PI;
+    return a;
+}
+
+/*
+  image the leader at a random pose in front of the default forward
+  looking camera. Returns false if an LED falls outside the image
+ */
+static bool make_image(struct truth *t, float sigma, float centroids[LEDPOSE_NUM_LEDS][2])
+{
+    t->pos[0] = rand_range(120, 600);
+    t->pos[1] = rand_range(-0.2f, 0.2f) * t->pos[0];
+    t->pos[2] = rand_range(-0.15f, 0.15f) * t->pos[0];
+    t->roll  = radians(rand_range(-20, 20));
+    t->pitch = radians(rand_range(-10, 10));
+    t->yaw   = radians(rand_range(-20, 20));
+
+    float cr = cosf(t->roll), sr = sinf(t->roll);
+    float cp = cosf(t->pitch), sp = sinf(t->pitch);
+    float cy = cosf(t->yaw), sy = sinf(t->yaw);
+
+    // leader body to follower body, 3-2-1
+    float M[3][3] = {
+        { cp*cy, sr*sp*cy - cr*sy, cr*sp*cy + sr*sy },
+        { cp*sy, sr*sp*sy + cr*cy, cr*sp*sy - sr*cy },
+        { -sp,   sr*cp,            cr*cp }
+    };
+    memcpy(t->R, M, sizeof(M));
+
+    for (uint8_t i=0; i<LEDPOSE_NUM_LEDS; i++) {
+        float b[3];
+        for (uint8_t k=0; k<3; k++) {
+            b[k] = M[k][0]*leds[i][0] + M[k][1]*leds[i][1] + M[k][2]*leds[i][2] + t->pos[k];
+        }
+        // body (fwd, right, down) to camera (right, down, fwd)
+        centroids[i][0] = CX + FOCAL * b[1] / b[0] + sigma * rand_gauss();
+        centroids[i][1] = CY + FOCAL * b[2] / b[0] + sigma * rand_gauss();
+        if (centroids[i][0] < 0 || centroids[i][0] >= 2*CX ||
+            centroids[i][1] < 0 || centroids[i][1] >= 2*CY) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_accuracy(float sigma)
+{
+    float centroids[LEDPOSE_NUM_LEDS][2];
+    struct truth t;
+    float pos_err2 = 0, range_err2 = 0, att_err2 = 0;
+    uint16_t count = 0, failures = 0, iterations = 0;
+
+    pose.set_tracking(false);
+    seed = 1;
+    while (count + failures < NUM_TRIALS) {
+        if (!make_image(&t, sigma, centroids)) {
+            continue;
+        }
+        if (!pose.solve(centroids, RELNAV_LED_ALL)) {
+            failures++;
+            continue;
+        }
+        float p[3], roll, pitch, yaw;
+        pose.get_position(p);
+        pose.get_euler(&roll, &pitch, &yaw);
+
+        // position error relative to the range
+        float range = sqrtf(t.pos[0]*t.pos[0] + t.pos[1]*t.pos[1] + t.pos[2]*t.pos[2]);
+        float e2 = 0;
+        for (uint8_t k=0; k<3; k++) {
+            e2 += (p[k] - t.pos[k]) * (p[k] - t.pos[k]);
+        }
+        pos_err2 += e2;
+        range_err2 += e2 / (range*range);
+        float er = wrap_PI(roll - t.roll);
+        float ep = wrap_PI(pitch - t.pitch);
+        float ey = wrap_PI(yaw - t.yaw);
+        att_err2 += (er*er + ep*ep + ey*ey) / 3;
+        iterations += pose.iterations();
+        count++;
+    }
+
+    if (count == 0) {
+        Serial.printf_P(PSTR("noise %4.1f px: no solutions\n"), sigma);
+        return;
+    }
+    Serial.printf_P(PSTR("noise %4.1f px: pos %6.2f in (%5.2f%% range)  att %5.2f deg  iter %4.1f  failed %u/%u\n"),
+                    sigma,
+                    sqrtf(pos_err2 / count),
+                    100 * sqrtf(range_err2 / count),
+                    degrees(sqrtf(att_err2 / count)),
+                    iterations / (float)count,
+                    failures, NUM_TRIALS);
+}
+
+/*
+  position only solutions from a subset of the LEDs, given the true
+  relative attitude
+ */
+static void test_partial(const char *name, uint8_t led_mask, float sigma)
+{
+    float centroids[LEDPOSE_NUM_LEDS][2];
+    struct truth t;
+    float range_err2 = 0;
+    uint16_t count = 0, failures = 0;
+
+    seed = 1;
+    while (count + failures < NUM_TRIALS) {
+        if (!make_image(&t, sigma, centroids)) {
+            continue;
+        }
+        if (!pose.solve_position(centroids, led_mask, t.R)) {
+            failures++;
+            continue;
+        }
+        float p[3];
+        pose.get_position(p);
+        float range2 = t.pos[0]*t.pos[0] + t.pos[1]*t.pos[1] + t.pos[2]*t.pos[2];
+        float e2 = 0;
+        for (uint8_t k=0; k<3; k++) {
+            e2 += (p[k] - t.pos[k]) * (p[k] - t.pos[k]);
+        }
+        range_err2 += e2 / range2;
+        count++;
+    }
+    Serial.printf_P(PSTR("%-14s noise %4.1f px: pos %5.2f%% range  failed %u/%u\n"),
+                    name, sigma,
+                    count ? 100 * sqrtf(range_err2 / count) : 0,
+                    failures, NUM_TRIALS);
+}
+
+/*
+  solve rate from a cold start (P3P then Gauss-Newton), and tracking a
+  slowly moving leader from the previous pose
+ */
+static void test_speed(void)
+{
+    static float centroids[NUM_FRAMES][LEDPOSE_NUM_LEDS][2];
+    struct truth t;
+    uint32_t start_time, usec;
+    uint16_t i;
+
+    seed = 1;
+    for (i=0; i<NUM_FRAMES; ) {
+        if (make_image(&t, 1.0f, centroids[i])) {
+            i++;
+        }
+    }
+    pose.set_tracking(false);
+    start_time = micros();
+    for (i=0; i<NUM_FRAMES; i++) {
+        pose.solve(centroids[i], RELNAV_LED_ALL);
+    }
+    usec = micros() - start_time;
+    Serial.printf_P(PSTR("cold start  %7lu solves/s  (%lu usec/solve)\n"),
+                    (unsigned long)(NUM_FRAMES * 1.0e6 / usec),
+                    (unsigned long)(usec / NUM_FRAMES));
+
+    // a leader drifting 0.5 px/frame across the image
+    make_image(&t, 0, centroids[0]);
+    for (i=1; i<NUM_FRAMES; i++) {
+        for (uint8_t k=0; k<LEDPOSE_NUM_LEDS; k++) {
+            centroids[i][k][0] = centroids[0][k][0] + 0.5f*i + 0.5f*rand_gauss();
+            centroids[i][k][1] = centroids[0][k][1] + 0.5f*rand_gauss();
+        }
+    }
+    pose.set_tracking(true);
+    uint16_t tracked = 0;
+    start_time = micros();
+    for (i=0; i<NUM_FRAMES; i++) {
+        pose.solve(centroids[i], RELNAV_LED_ALL);
+        if (pose.tracked()) {
+            tracked++;
+        }
+    }
+    usec = micros() - start_time;
+    Serial.printf_P(PSTR("tracking    %7lu solves/s  (%lu usec/solve, %u/%u tracked)\n"),
+                    (unsigned long)(NUM_FRAMES * 1.0e6 / usec),
+                    (unsigned long)(usec / NUM_FRAMES),
+                    tracked, NUM_FRAMES);
+}
+
+void setup(void)
+{
+    Serial.begin(115200);
+    Serial.println("LED pose solver benchmark");
+
+    pose.set_camera(FOCAL, FOCAL, CX, CY);
+    pose.set_leds(leds);
+
+    test_accuracy(0);
+    test_accuracy(0.5f);
+    test_accuracy(1.0f);
+    test_accuracy(2.0f);
+    test_partial("wingtips", RELNAV_LED_1 | RELNAV_LED_2, 1.0f);
+    test_partial("wing+nose+tail", RELNAV_LED_1 | RELNAV_LED_3 | RELNAV_LED_4, 1.0f);
+    test_speed();
+
+    // four LEDs, the fin top hidden
+    float centroids[LEDPOSE_NUM_LEDS][2];
+    struct truth t;
+    struct relnav_data pkt;
+    seed = 7;
+    while (!make_image(&t, 0.5f, centroids)) ;
+    pose.set_tracking(false);
+    pose.solve(centroids, RELNAV_LED_ALL & ~RELNAV_LED_5);
+    pose.get_data(&pkt);
+    Serial.printf_P(PSTR("4 LEDs: true %.1f %.1f %.1f  DATA %.1f %.1f %.1f  mask 0x%02x\n"),
+                    t.pos[0], t.pos[1], t.pos[2],
+                    pkt.x, pkt.y, pkt.z, pkt.led_mask);
+}
+
+void loop(void)
+{
+}
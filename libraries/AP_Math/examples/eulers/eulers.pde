@@ -179,6 +179,11 @@ static void test_conversion(float roll, float pitch, float yaw)
 
     check_result(roll, pitch, yaw, roll2, pitch2, yaw2);
     check_result(roll, pitch, yaw, roll3, pitch3, yaw3);
+
+    // and back from the matrix to a quaternion
+    q.from_rotation_matrix(m2);
+    q.to_euler(&roll2, &pitch2, &yaw2);
+    check_result(roll, pitch, yaw, roll2, pitch2, yaw2);
 }
 
 void test_conversions(void)
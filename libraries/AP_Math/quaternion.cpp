@@ -43,6 +43,41 @@ void Quaternion::rotation_matrix(Matrix3f &m)
     m.c.z = 1-2*(q2q2 + q3q3);
 }
 
+// create a quaternion from a rotation matrix, the inverse of
+// rotation_matrix(). The largest of the four components is found
+// first, to avoid dividing by a small number
+void Quaternion::from_rotation_matrix(const Matrix3f &m)
+{
+    float tr = m.a.x + m.b.y + m.c.z;
+    float s;
+
+    if (tr > 0) {
+        s  = sqrt(tr + 1) * 2;
+        q1 = 0.25 * s;
+        q2 = (m.c.y - m.b.z) / s;
+        q3 = (m.a.z - m.c.x) / s;
+        q4 = (m.b.x - m.a.y) / s;
+    } else if (m.a.x > m.b.y && m.a.x > m.c.z) {
+        s  = sqrt(1 + m.a.x - m.b.y - m.c.z) * 2;
+        q1 = (m.c.y - m.b.z) / s;
+        q2 = 0.25 * s;
+        q3 = (m.a.y + m.b.x) / s;
+        q4 = (m.a.z + m.c.x) / s;
+    } else if (m.b.y > m.c.z) {
+        s  = sqrt(1 + m.b.y - m.a.x - m.c.z) * 2;
+        q1 = (m.a.z - m.c.x) / s;
+        q2 = (m.a.y + m.b.x) / s;
+        q3 = 0.25 * s;
+        q4 = (m.b.z + m.c.y) / s;
+    } else {
+        s  = sqrt(1 + m.c.z - m.a.x - m.b.y) * 2;
+        q1 = (m.b.x - m.a.y) / s;
+        q2 = (m.a.z + m.c.x) / s;
+        q3 = (m.b.z + m.c.y) / s;
+        q4 = 0.25 * s;
+    }
+}
+
 // convert a vector from earth to body frame
 void Quaternion::earth_to_body(Vector3f &v)
 {
@@ -87,3 +122,39 @@ void Quaternion::to_euler(float *roll, float *pitch, float *yaw)
                      1 - 2.0*(q3*q3 + q4*q4));
     }
 }
+
+// rotate this quaternion by a rotation vector given in the body
+// frame. This is used to integrate the gyros, in which case v is
+// the gyro vector multiplied by the time step
+void Quaternion::rotate(const Vector3f &v)
+{
+    float theta = v.length();
+    if (theta == 0) {
+        return;
+    }
+    float s = sin(theta*0.5) / theta;
+    Quaternion r(cos(theta*0.5), v.x*s, v.y*s, v.z*s);
+    *this = *this * r;
+}
+
+// scale the quaternion back to unit length
+void Quaternion::normalize(void)
+{
+    float len = sqrt(q1*q1 + q2*q2 + q3*q3 + q4*q4);
+    if (len != 0) {
+        float inv = 1.0 / len;
+        q1 *= inv;
+        q2 *= inv;
+        q3 *= inv;
+        q4 *= inv;
+    }
+}
+
+// quaternion product
+Quaternion Quaternion::operator *(const Quaternion &v) const
+{
+    return Quaternion(q1*v.q1 - q2*v.q2 - q3*v.q3 - q4*v.q4,
+                      q1*v.q2 + q2*v.q1 + q3*v.q4 - q4*v.q3,
+                      q1*v.q3 - q2*v.q4 + q3*v.q1 + q4*v.q2,
+                      q1*v.q4 + q2*v.q3 - q3*v.q2 + q4*v.q1);
+}
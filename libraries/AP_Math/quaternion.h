@@ -43,6 +43,9 @@ public:
     // return the rotation matrix equivalent for this quaternion
     void        rotation_matrix(Matrix3f &m);
 
+    // create a quaternion from a rotation matrix
+    void        from_rotation_matrix(const Matrix3f &m);
+
     // convert a vector from earth to body frame
     void        earth_to_body(Vector3f &v);
 
@@ -51,5 +54,15 @@ public:
 
     // create eulers from a quaternion
     void        to_euler(float *roll, float *pitch, float *yaw);
+
+    // rotate this quaternion by a rotation vector given in the
+    // body frame (radians)
+    void        rotate(const Vector3f &v);
+
+    // scale the quaternion back to unit length
+    void        normalize(void);
+
+    // quaternion product
+    Quaternion  operator *(const Quaternion &v) const;
 };
 #endif // QUATERNION_H
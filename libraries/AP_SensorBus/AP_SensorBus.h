@@ -0,0 +1,72 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_SensorBus.h
+/// @brief	The sensor topics published by the timer process drivers
+///
+/// Each driver publishes from its timer process into a fixed topic,
+/// defined in the driver's own source file so that a build only pays
+/// for the drivers it uses. The flight code subscribes through
+/// AP_Topic, without disabling interrupts.
+///
+/// A driver that averages between reads publishes running totals of
+/// its samples rather than clearing them on each read. A subscriber
+/// keeps the totals it last used and averages the difference, so any
+/// number of subscribers can share a topic, and a log of the topic
+/// loses nothing between records. The totals wrap, so differences
+/// must be taken in unsigned arithmetic.
+///
+/// The sample counts are only 16 bits, and wrap after a long enough
+/// gap between reads while the 32 bit sums still look sensible. So a
+/// driver also publishes its newest raw sample, and a reader that has
+/// not averaged for more than SENSOR_MAX_AVERAGE_US takes that instead.
+
+#ifndef AP_SENSORBUS_H
+#define AP_SENSORBUS_H
+
+#include "AP_Topic.h"
+
+/// topic ids. They are written to the log, so never renumber them
+enum sensor_topic_id {
+    SENSOR_TOPIC_ADC    = 1,    ///< ADS7844 channels
+    SENSOR_TOPIC_IMU    = 2,    ///< MPU6000 accels, temperature and gyros
+    SENSOR_TOPIC_BARO   = 3,    ///< MS5611 pressure and temperature
+    SENSOR_TOPIC_COUNT
+};
+
+/// longest time a reader averages the totals over. Well short of the
+/// time any of the drivers takes to wrap a 16 bit count
+#define SENSOR_MAX_AVERAGE_US   1000000UL
+
+/// ADS7844 channel totals, published after each read of all channels.
+/// All eight channels are used on an APM1 (the six IMU axes, the gyro
+/// temperature and the pitot), and they are read together, so one
+/// count serves them all
+struct sensor_adc {
+    uint32_t    sum[8];         ///< total of each channel's 12 bit values
+    uint16_t    raw[8];         ///< newest value of each channel
+    uint16_t    count;          ///< number of values in each total
+};
+
+/// MPU6000 register totals, published after each data ready
+/// interrupt and stamped with the interrupt time
+struct sensor_imu {
+    uint32_t    sum[7];         ///< total of each signed 16 bit register
+    int16_t     raw[7];         ///< newest value of each register
+    uint16_t    count;          ///< number of samples in the totals
+};
+
+/// MS5611 conversion totals, published after each pressure conversion
+struct sensor_baro {
+    uint32_t    d1_sum;         ///< total of the pressure conversions
+    uint32_t    d2_sum;         ///< total of the temperature conversions
+    uint32_t    d1;             ///< newest pressure conversion
+    uint32_t    d2;             ///< newest temperature conversion
+    uint16_t    d1_count;
+    uint16_t    d2_count;
+};
+
+extern AP_TopicOf<struct sensor_adc>    sensor_adc_topic;
+extern AP_TopicOf<struct sensor_imu>    sensor_imu_topic;
+extern AP_TopicOf<struct sensor_baro>   sensor_baro_topic;
+
+#endif // AP_SENSORBUS_H
@@ -0,0 +1,217 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_Topic.h
+/// @brief	Latest-sample topic under a sequence lock
+///
+/// A topic holds the newest sample from one publisher, with the time
+/// it was taken. The publisher, normally a timer process, overwrites
+/// it without waiting. A reader copies it out and retries if a publish
+/// landed part way through the copy, so neither side disables
+/// interrupts. Every publish counts up the topic version, which a
+/// reader keeps to tell whether anything has been published since.
+///
+/// Only one context may publish to a topic, and readers must not
+/// interrupt it: read from the main loop, not from a timer process.
+///
+/// Topics link themselves into a list as they are constructed, so a
+/// logger can find every topic linked into the build by its id.
+
+#ifndef AP_TOPIC_H
+#define AP_TOPIC_H
+
+#include <stdint.h>
+#include <string.h>
+
+/// largest sample a generic reader has to make room for, the ADC
+/// totals. It is on the stack of the topic logger
+#define AP_TOPIC_MAX_SIZE   52
+
+/// @class	AP_Topic
+/// @brief	an untyped topic, as seen by generic subscribers
+class AP_Topic {
+public:
+    AP_Topic(uint8_t id, void *sample, uint8_t size) :
+        _seq(0),
+        _time_us(0),
+        _sample(sample),
+        _id(id),
+        _size(size)
+    {
+        _next = list();
+        list() = this;
+    }
+
+    /// @name	Publisher side
+    //@{
+
+    /// overwrite the sample
+    void            publish(const void *sample, uint32_t time_us) {
+        uint16_t seq = _seq;
+        store_seq(seq + 1);             // odd while the sample is torn
+        fence_release();
+        memcpy(_sample, sample, _size);
+        _time_us = time_us;
+        store_seq(seq + 2);
+    }
+
+    /// change the sample in place rather than copying it in, for a
+    /// publisher that keeps its running totals in the sample. Readers
+    /// retry until end_publish(), so keep slow work such as SPI
+    /// transfers outside the pair
+    void            *begin_publish(void) {
+        store_seq(_seq + 1);            // odd while the sample is torn
+        fence_release();
+        return _sample;
+    }
+
+    void            end_publish(uint32_t time_us) {
+        _time_us = time_us;
+        store_seq(_seq + 1);
+    }
+    //@}
+
+    /// @name	Subscriber side
+    //@{
+
+    /// copy out the newest sample, and the time it was taken
+    ///
+    /// @returns the version of the sample, 0 if nothing has been
+    /// published yet
+    uint16_t        read(void *sample, uint32_t *time_us = NULL) const {
+        while (true) {
+            uint16_t seq = load_seq();
+            if (seq & 1) {
+                continue;
+            }
+            memcpy(sample, _sample, _size);
+            uint32_t t = _time_us;
+            fence_acquire();
+            if (load_seq() == seq) {
+                if (time_us != NULL) {
+                    *time_us = t;
+                }
+                return seq >> 1;
+            }
+        }
+    }
+
+    /// the version of the newest complete sample
+    uint16_t        version(void) const {
+        return load_seq() >> 1;
+    }
+
+    /// true if a sample has been published since version was read
+    bool            updated_since(uint16_t version) const {
+        return this->version() != version;
+    }
+
+    uint8_t         id(void) const { return _id; }
+    uint8_t         size(void) const { return _size; }
+    //@}
+
+    /// @name	Registry
+    //@{
+    static AP_Topic *first(void) { return list(); }
+    AP_Topic        *next(void) const { return _next; }
+
+    /// @returns the topic with the given id, or NULL if no driver in
+    /// the build publishes it
+    static AP_Topic *find(uint8_t id) {
+        for (AP_Topic *t = first(); t != NULL; t = t->next()) {
+            if (t->_id == id) {
+                return t;
+            }
+        }
+        return NULL;
+    }
+    //@}
+
+private:
+    // topics are constructed before main(), from whichever translation
+    // unit comes first, so the list head is a function static
+    static AP_Topic *&list(void) {
+        static AP_Topic *head;
+        return head;
+    }
+
+    // the AVR has a single core and a publisher is never interrupted
+    // by a reader, so there only the compiler has to be held back.
+    // A 16 bit load can still be split by an interrupt, so it is
+    // repeated until two agree
+    uint16_t        load_seq(void) const {
+#ifdef __AVR__
+        uint16_t s;
+        do {
+            s = *(const volatile uint16_t *)&_seq;
+        } while (s != *(const volatile uint16_t *)&_seq);
+        __asm__ __volatile__("" ::: "memory");
+        return s;
+#else
+        return __atomic_load_n(&_seq, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    void            store_seq(uint16_t s) {
+#ifdef __AVR__
+        __asm__ __volatile__("" ::: "memory");
+        *(volatile uint16_t *)&_seq = s;
+#else
+        __atomic_store_n(&_seq, s, __ATOMIC_RELEASE);
+#endif
+    }
+
+    static void     fence_release(void) {
+#ifdef __AVR__
+        __asm__ __volatile__("" ::: "memory");
+#else
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+    }
+
+    static void     fence_acquire(void) {
+#ifdef __AVR__
+        __asm__ __volatile__("" ::: "memory");
+#else
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+    }
+
+    uint16_t        _seq;
+    uint32_t        _time_us;
+    void            *_sample;
+    AP_Topic        *_next;
+    uint8_t         _id;
+    uint8_t         _size;
+};
+
+/// @class	AP_TopicOf
+/// @brief	a topic carrying samples of type T
+template <class T>
+class AP_TopicOf : public AP_Topic {
+public:
+    AP_TopicOf(uint8_t id) :
+        AP_Topic(id, &_buf, sizeof(T))
+    {
+        memset(&_buf, 0, sizeof(_buf));
+    }
+
+    void            publish(const T &sample, uint32_t time_us) {
+        AP_Topic::publish(&sample, time_us);
+    }
+
+    T               *begin_publish(void) {
+        return (T *)AP_Topic::begin_publish();
+    }
+
+    uint16_t        read(T &sample, uint32_t *time_us = NULL) const {
+        return AP_Topic::read(&sample, time_us);
+    }
+
+private:
+    // fails to compile if a sample is too big for generic readers
+    typedef char size_check[sizeof(T) <= AP_TOPIC_MAX_SIZE ? 1 : -1];
+
+    T               _buf;
+};
+
+#endif // AP_TOPIC_H
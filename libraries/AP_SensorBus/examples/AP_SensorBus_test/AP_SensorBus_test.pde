@@ -0,0 +1,131 @@
+/*
+ *       Cost of publishing and reading a topic, and a check that
+ *       samples published from the timer process are never read torn.
+ */
+
+#include <FastSerial.h>
+#include <AP_Common.h>
+#include <AP_Math.h>
+#include <Arduino_Mega_ISR_Registry.h>
+#include <AP_PeriodicProcess.h>
+#include <AP_SensorBus.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Serial ports
+////////////////////////////////////////////////////////////////////////////////
+FastSerialPort0(Serial);        // FTDI/console
+
+Arduino_Mega_ISR_Registry isr_registry;
+AP_TimerProcess scheduler;
+
+#define ITERATIONS  1000
+
+// every field holds the same count, so a torn read shows up as a
+// mismatch
+struct test_sample {
+    uint32_t v[8];
+};
+
+AP_TopicOf<struct test_sample> test_topic(SENSOR_TOPIC_COUNT);
+
+static uint32_t published;
+
+// alternately copies a sample in and changes the topic's in place
+static void publisher(uint32_t now)
+{
+    struct test_sample s;
+    struct test_sample *p = &s;
+    published++;
+    if (published & 1) {
+        p = test_topic.begin_publish();
+    }
+    for (uint8_t i=0; i<8; i++) {
+        p->v[i] = published;
+    }
+    if (published & 1) {
+        test_topic.end_publish(now);
+    } else {
+        test_topic.publish(s, now);
+    }
+}
+
+static void report(const char *name, uint32_t t_us)
+{
+    Serial.printf("%-28s %8.3f us\n", name, t_us / (float)ITERATIONS);
+}
+
+static void bench(void)
+{
+    struct test_sample s;
+    uint32_t t0;
+    volatile uint16_t sink = 0;
+
+    memset(&s, 0, sizeof(s));
+
+    t0 = micros();
+    for (uint16_t n=0; n<ITERATIONS; n++) {
+        test_topic.publish(s, n);
+    }
+    report("publish 32 bytes", micros() - t0);
+
+    t0 = micros();
+    for (uint16_t n=0; n<ITERATIONS; n++) {
+        sink = test_topic.read(s);
+    }
+    report("read 32 bytes", micros() - t0);
+
+    t0 = micros();
+    for (uint16_t n=0; n<ITERATIONS; n++) {
+        sink = test_topic.updated_since(sink);
+    }
+    report("updated_since", micros() - t0);
+}
+
+void setup()
+{
+    Serial.begin(115200, 128, 128);
+    Serial.println("AP_SensorBus test");
+
+    bench();
+
+    Serial.print("topics:");
+    for (AP_Topic *t = AP_Topic::first(); t != NULL; t = t->next()) {
+        Serial.printf(" %u(%u bytes)", (unsigned)t->id(), (unsigned)t->size());
+    }
+    Serial.println();
+
+    isr_registry.init();
+    scheduler.init(&isr_registry);
+    scheduler.register_process(publisher);
+}
+
+void loop()
+{
+    static uint32_t last_report, reads, torn, missed;
+    static uint16_t version;
+    static uint32_t last_v;
+    struct test_sample s;
+
+    if (!test_topic.updated_since(version)) {
+        return;
+    }
+    version = test_topic.read(s);
+    reads++;
+    for (uint8_t i=1; i<8; i++) {
+        if (s.v[i] != s.v[0]) {
+            torn++;
+            break;
+        }
+    }
+    if (s.v[0] > last_v) {
+        missed += s.v[0] - last_v - 1;
+    }
+    last_v = s.v[0];
+
+    if (millis() - last_report >= 1000) {
+        last_report = millis();
+        Serial.printf("%lu reads, %lu torn, %lu not seen\n",
+                      (unsigned long)reads, (unsigned long)torn,
+                      (unsigned long)missed);
+    }
+}
@@ -0,0 +1,146 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include <AP_StreamCapture.h>
+
+int
+AP_StreamTap::read(void)
+{
+    int c = _port->read();
+    if (c != -1 && _capture) {
+        uint8_t b = c;
+        record(&b, 1);
+    }
+    return c;
+}
+
+uint16_t
+AP_StreamTap::read_bytes(uint8_t *buffer, uint16_t count)
+{
+    uint16_t n = _port->read_bytes(buffer, count);
+    if (n != 0 && _capture) {
+        record(buffer, n);
+    }
+    return n;
+}
+
+void
+AP_StreamTap::record(const uint8_t *bytes, uint16_t count)
+{
+    uint32_t now = millis();
+
+    while (count > 0) {
+        if (_fill.len != 0 && (_fill.time_ms != now || _fill.len == STREAM_CHUNK_MAX)) {
+            // close this chunk and start another, if there is room
+            if (!_chunks.push(_fill)) {
+                _dropped += count;
+                return;
+            }
+            _fill.len = 0;
+        }
+        if (_fill.len == 0) {
+            _fill.time_ms = now;
+        }
+        uint8_t n = STREAM_CHUNK_MAX - _fill.len;
+        if (n > count) {
+            n = count;
+        }
+        memcpy(&_fill.data[_fill.len], bytes, n);
+        _fill.len += n;
+        bytes += n;
+        count -= n;
+    }
+}
+
+bool
+AP_StreamTap::pop(struct stream_chunk *chunk)
+{
+    if (_chunks.pop(*chunk)) {
+        return true;
+    }
+    // the chunk being filled is complete once its millisecond has
+    // passed
+    if (_fill.len == 0 || _fill.time_ms == millis()) {
+        return false;
+    }
+    memcpy(chunk, &_fill, sizeof(*chunk));
+    _fill.len = 0;
+    return true;
+}
+
+void
+AP_StreamReplay::start(stream_chunk_source source, float speed)
+{
+    _source = source;
+    _speed = (speed > 0) ? speed : 1;
+    _chunk.len = 0;
+    _pos = 0;
+    _have_next = false;
+    _started = false;
+    _finished = false;
+    _written = 0;
+}
+
+// move on to the next chunk if the current one has been read and the
+// next one is due. Returns true if there are bytes to read. The
+// capture's clock is lined up with ours on the first read, so polling
+// available() before the reader starts doesn't make it run ahead
+bool
+AP_StreamReplay::refill(bool reading)
+{
+    if (_pos < _chunk.len) {
+        return true;
+    }
+    if (!_have_next) {
+        if (_source == NULL || _finished || !_source(&_next)) {
+            _finished = (_source != NULL);
+            return false;
+        }
+        _have_next = true;
+    }
+
+    uint32_t now = millis();
+    if (!_started) {
+        if (!reading) {
+            return false;
+        }
+        _first_ms = _next.time_ms;
+        _start_ms = now;
+        _started = true;
+    } else {
+        uint32_t due = _start_ms + (_next.time_ms - _first_ms) / _speed;
+        if ((int32_t)(now - due) < 0) {
+            return false;
+        }
+    }
+    memcpy(&_chunk, &_next, sizeof(_chunk));
+    _pos = 0;
+    _have_next = false;
+    return _chunk.len != 0;
+}
+
+int
+AP_StreamReplay::available(void)
+{
+    if (!refill(false)) {
+        return 0;
+    }
+    return _chunk.len - _pos;
+}
+
+int
+AP_StreamReplay::read(void)
+{
+    if (!refill(true)) {
+        return -1;
+    }
+    return _chunk.data[_pos++];
+}
+
+int
+AP_StreamReplay::peek(void)
+{
+    if (!refill(true)) {
+        return -1;
+    }
+    return _chunk.data[_pos];
+}
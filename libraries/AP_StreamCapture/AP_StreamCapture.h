@@ -0,0 +1,158 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_StreamCapture.h
+/// @brief	Capture and replay of the bytes received on a serial port.
+///
+/// AP_StreamTap sits between a port and its reader and passes
+/// everything through, keeping a timestamped copy of the bytes read
+/// while capturing. The copies are taken from the tap in chunks, to be
+/// logged from idle time.
+///
+/// AP_StreamReplay stands in for the port, handing back the captured
+/// chunks at their recorded times, or faster. Anything written to it is
+/// discarded.
+
+#ifndef AP_STREAMCAPTURE_H
+#define AP_STREAMCAPTURE_H
+
+#include <FastSerial.h>
+#include <AP_Common.h>
+#include <AP_RingBuffer.h>
+
+// bytes per chunk
+#define STREAM_CHUNK_MAX        32
+
+// complete chunks waiting in the tap, a power of 2 up to 128
+#define STREAM_TAP_CHUNKS       8
+
+/// bytes read from the port in the same millisecond
+struct stream_chunk {
+    uint32_t        time_ms;
+    uint8_t         len;
+    uint8_t         data[STREAM_CHUNK_MAX];
+};
+
+/// @class	AP_StreamTap
+/// @brief	Pass-through port that records what is read from it
+class AP_StreamTap : public BetterStream {
+public:
+    AP_StreamTap() :
+        _port(NULL),
+        _capture(false),
+        _dropped(0)
+    {
+        _fill.len = 0;
+    }
+
+    /// the port read through the tap
+    void            set_port(BetterStream *port) { _port = port; }
+
+    /// start or stop keeping copies of the bytes read
+    void            set_capture(bool enable) { _capture = enable; }
+
+    /// take the oldest complete chunk. A chunk is complete once a read
+    /// happens in a later millisecond, or it is full
+    ///
+    /// @returns false if there is none
+    bool            pop(struct stream_chunk *chunk);
+
+    /// bytes lost to a full tap since the last call
+    uint16_t        dropped(void) {
+        uint16_t n = _dropped;
+        _dropped = 0;
+        return n;
+    }
+
+    /// @name	BetterStream
+    //@{
+    virtual int     available(void) { return _port->available(); }
+    virtual int     txspace(void) { return _port->txspace(); }
+    virtual int     read(void);
+    virtual uint16_t read_bytes(uint8_t *buffer, uint16_t count);
+    virtual int     peek(void) { return _port->peek(); }
+    virtual void    flush(void) { _port->flush(); }
+#if defined(ARDUINO) && ARDUINO >= 100
+    virtual size_t  write(uint8_t c) { return _port->write(c); }
+#else
+    virtual void    write(uint8_t c) { _port->write(c); }
+#endif
+    using BetterStream::write;
+    //@}
+
+private:
+    void            record(const uint8_t *bytes, uint16_t count);
+
+    BetterStream    *_port;
+    bool            _capture;
+
+    // the chunk being filled, and the complete ones
+    struct stream_chunk _fill;
+    AP_RingBuffer<struct stream_chunk, STREAM_TAP_CHUNKS> _chunks;
+    uint16_t        _dropped;
+};
+
+/// source of captured chunks for a replay, in time order. Returns false
+/// at the end of the capture
+typedef bool (*stream_chunk_source)(struct stream_chunk *chunk);
+
+/// @class	AP_StreamReplay
+/// @brief	Port that plays back a capture
+class AP_StreamReplay : public BetterStream {
+public:
+    AP_StreamReplay() :
+        _source(NULL),
+        _speed(1),
+        _pos(0),
+        _have_next(false),
+        _started(false),
+        _finished(false),
+        _written(0)
+    {
+        _chunk.len = 0;
+    }
+
+    /// play a capture back. speed 1 gives the recorded timing, larger
+    /// values run it faster
+    void            start(stream_chunk_source source, float speed);
+
+    /// true once the whole capture has been read
+    bool            finished(void) const { return _finished; }
+
+    /// bytes written to the port and discarded
+    uint32_t        written(void) const { return _written; }
+
+    /// @name	BetterStream
+    //@{
+    virtual int     available(void);
+    virtual int     read(void);
+    virtual int     peek(void);
+    virtual void    flush(void) {}
+#if defined(ARDUINO) && ARDUINO >= 100
+    virtual size_t  write(uint8_t) { _written++; return 1; }
+#else
+    virtual void    write(uint8_t) { _written++; }
+#endif
+    using BetterStream::write;
+    //@}
+
+private:
+    bool            refill(bool reading);
+
+    stream_chunk_source _source;
+    float           _speed;
+
+    // the chunk being read, and the next one waiting for its time
+    struct stream_chunk _chunk;
+    uint8_t         _pos;
+    struct stream_chunk _next;
+    bool            _have_next;
+
+    // capture time of the first chunk and our time when it was given out
+    uint32_t        _first_ms;
+    uint32_t        _start_ms;
+    bool            _started;
+    bool            _finished;
+    uint32_t        _written;
+};
+
+#endif // AP_STREAMCAPTURE_H
@@ -0,0 +1,43 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include <AP_Trace.h>
+
+void
+AP_Trace::event(uint8_t id, uint8_t arg, float a, float b, float c)
+{
+    if (!_enabled) {
+        return;
+    }
+    uint16_t seq = _seq++;
+    struct trace_record *rec;
+    if (_ring.write_span(&rec) == 0) {
+        // the drain is behind, the gap in seq marks the loss
+        return;
+    }
+    rec->time_us = micros();
+    rec->seq     = seq;
+    rec->id      = id;
+    rec->arg     = arg;
+    rec->v[0]    = a;
+    rec->v[1]    = b;
+    rec->v[2]    = c;
+    _ring.commit(1);
+}
+
+void
+AP_Trace::drain(FastSerial *port)
+{
+    const struct trace_record *rec;
+    while (_ring.peek_span(&rec) != 0 && port->txspace() >= (int)TRACE_FRAME_LEN) {
+        const uint8_t *b = (const uint8_t *)rec;
+        uint8_t chk = 0;
+        port->write(TRACE_SYNC1);
+        port->write(TRACE_SYNC2);
+        for (uint8_t i=0; i<sizeof(struct trace_record); i++) {
+            chk ^= b[i];
+            port->write(b[i]);
+        }
+        port->write(chk);
+        _ring.consume(1);
+    }
+}
@@ -0,0 +1,58 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_Trace.h
+/// @brief	Lightweight binary event trace for in-flight diagnostics.
+///
+/// Raising an event copies a fixed size record into a RAM ring, which
+/// costs a few microseconds and never touches a port. The ring is
+/// drained to DataFlash or a serial port from idle time, and decoded
+/// to text on the ground. Events are raised and drained from the main
+/// loop, not from interrupts.
+
+#ifndef AP_TRACE_H
+#define AP_TRACE_H
+
+#include <FastSerial.h>
+#include <AP_Common.h>
+#include <AP_RingBuffer.h>
+#include "AP_TraceFormat.h"
+
+#define TRACE_RING_SIZE         16      // records, a power of 2 up to 128
+
+/// @class	AP_Trace
+/// @brief	Ring of trace records
+class AP_Trace {
+public:
+    AP_Trace() :
+        _seq(0),
+        _enabled(false)
+    {}
+
+    /// events raised while disabled are discarded without a record
+    void            set_enabled(bool enable) { _enabled = enable; }
+    bool            enabled(void) const { return _enabled; }
+
+    void            event(uint8_t id, uint8_t arg = 0) {
+        event(id, arg, 0, 0, 0);
+    }
+    void            event(uint8_t id, uint8_t arg, float a, float b, float c);
+
+    /// records waiting in the ring
+    uint8_t         available(void) const { return _ring.available(); }
+
+    /// take the oldest record
+    ///
+    /// @returns false if the ring is empty
+    bool            pop(struct trace_record *rec) { return _ring.pop(*rec); }
+
+    /// send framed records while the port has room for them. Never
+    /// blocks
+    void            drain(FastSerial *port);
+
+private:
+    AP_RingBuffer<struct trace_record, TRACE_RING_SIZE> _ring;
+    uint16_t        _seq;
+    bool            _enabled;
+};
+
+#endif // AP_TRACE_H
@@ -0,0 +1,55 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_TraceFormat.h
+/// @brief	Binary trace records and their serial framing.
+///
+/// Only needs <stdint.h>, so the host decoder in tools/ can include it
+/// directly. Records are little-endian, as on both the APM and the PC.
+
+#ifndef AP_TRACEFORMAT_H
+#define AP_TRACEFORMAT_H
+
+#include <stdint.h>
+
+/// a trace event. seq counts every event raised, including those lost
+/// while the ring was full, so gaps show where records were dropped
+struct trace_record {
+    uint32_t        time_us;
+    uint16_t        seq;
+    uint8_t         id;
+    uint8_t         arg;
+    float           v[3];
+};
+
+// on a serial port each record is sent as
+//   TRACE_SYNC1 TRACE_SYNC2 <record> <xor of the record bytes>
+#define TRACE_SYNC1             0xC5
+#define TRACE_SYNC2             0x5C
+#define TRACE_FRAME_LEN         (2 + sizeof(struct trace_record) + 1)
+
+/// event IDs, with the payload of each
+///
+///   RNAV_NO_MSG       no complete frame waiting
+///   RNAV_ZOH          repeated or failed pose, arg is the LED mask
+///   RNAV_POS          new pose, arg is the LED mask, v is dx_b (inches)
+///   RNAV_ATT          new pose, v is dphi, dtheta, dpsi (degrees)
+///   RNAV_LEDS_MISSING DATA frame without all LEDs, arg is the LED mask
+///   RNAV_BAD_CHKSM    checksum failure, arg is the frame type
+///   RNAV_SHM_AGE      pose taken from shared memory, v[0] is the time
+///                     since its capture (usec)
+#define TRACE_EVENTS(X) \
+    X(RNAV_NO_MSG,          1) \
+    X(RNAV_ZOH,             2) \
+    X(RNAV_POS,             3) \
+    X(RNAV_ATT,             4) \
+    X(RNAV_LEDS_MISSING,    5) \
+    X(RNAV_BAD_CHKSM,       6) \
+    X(RNAV_SHM_AGE,         7)
+
+#define TRACE_ENUM(name, id)    TRACE_ ## name = id,
+enum trace_event {
+    TRACE_EVENTS(TRACE_ENUM)
+};
+#undef TRACE_ENUM
+
+#endif // AP_TRACEFORMAT_H
@@ -0,0 +1,108 @@
+/*
+ * Decode a binary trace captured from a serial port into text, one
+ * event per line:
+ *
+ *   gcc -o tracedump tracedump.c
+ *   ./tracedump capture.bin
+ *
+ * Reads stdin if no file is given. Bytes outside good frames are
+ * skipped, and gaps in the sequence numbers are reported as drops.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../AP_TraceFormat.h"
+
+#define TRACE_NAME(name, id)    case id: return #name;
+static const char *event_name(uint8_t id)
+{
+    switch (id) {
+        TRACE_EVENTS(TRACE_NAME)
+    }
+    return "UNKNOWN";
+}
+#undef TRACE_NAME
+
+static void print_record(const struct trace_record *rec)
+{
+    printf("%10.6f %5u %-18s %3u", rec->time_us * 1.0e-6, (unsigned)rec->seq,
+           event_name(rec->id), (unsigned)rec->arg);
+    switch (rec->id) {
+    case TRACE_RNAV_ZOH:
+    case TRACE_RNAV_LEDS_MISSING:
+        printf(" leds 0x%02x", (unsigned)rec->arg);
+        break;
+    case TRACE_RNAV_POS:
+        printf(" dx %.2f %.2f %.2f in", rec->v[0], rec->v[1], rec->v[2]);
+        break;
+    case TRACE_RNAV_ATT:
+        printf(" att %.2f %.2f %.2f deg", rec->v[0], rec->v[1], rec->v[2]);
+        break;
+    case TRACE_RNAV_SHM_AGE:
+        printf(" age %.0f us", rec->v[0]);
+        break;
+    default:
+        break;
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *fp = stdin;
+    uint8_t frame[TRACE_FRAME_LEN];
+    unsigned len = 0, records = 0, bad = 0, dropped = 0;
+    uint16_t next_seq = 0;
+    int c, first = 1;
+
+    if (argc > 1) {
+        fp = fopen(argv[1], "rb");
+        if (fp == NULL) {
+            perror(argv[1]);
+            exit(1);
+        }
+    }
+
+    while ((c = fgetc(fp)) != EOF) {
+        if (len == 0 && c != TRACE_SYNC1) {
+            continue;
+        }
+        if (len == 1 && c != TRACE_SYNC2) {
+            len = (c == TRACE_SYNC1) ? 1 : 0;
+            continue;
+        }
+        frame[len++] = c;
+        if (len < TRACE_FRAME_LEN) {
+            continue;
+        }
+        len = 0;
+
+        struct trace_record rec;
+        uint8_t chk = 0;
+        unsigned i;
+        for (i=2; i<TRACE_FRAME_LEN-1; i++) {
+            chk ^= frame[i];
+        }
+        if (chk != frame[TRACE_FRAME_LEN-1]) {
+            bad++;
+            continue;
+        }
+        memcpy(&rec, &frame[2], sizeof(rec));
+        if (!first && rec.seq != next_seq) {
+            uint16_t lost = rec.seq - next_seq;
+            printf("# dropped %u\n", (unsigned)lost);
+            dropped += lost;
+        }
+        first = 0;
+        next_seq = rec.seq + 1;
+        print_record(&rec);
+        records++;
+    }
+
+    fprintf(stderr, "%u records, %u dropped, %u bad frames\n", records, dropped, bad);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    return 0;
+}
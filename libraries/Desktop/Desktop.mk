@@ -130,7 +130,11 @@ CFLAGS			=	-g $(DEFINES) $(OPTFLAGS) $(DEPFLAGS) $(COPTS)
 ASFLAGS			=	-g $(DEFINES) $(DEPFLAGS) $(ASOPTS)
 LDFLAGS			=	-g $(OPTFLAGS)
 
-LIBS			=	-lm
+LIBS			=	-lm -lpthread
+ifeq ($(SYSTYPE),Linux)
+# shm_open() is in librt on older glibc
+LIBS			+=	-lrt
+endif
 
 SRCSUFFIXES		=	*.cpp *.c
 
@@ -15,7 +15,18 @@ extern "C" volatile uint8_t __iomem[1024];
 
 #define _SFR_IO8(addr)  __iomem[addr]
 
-extern "C" volatile uint8_t SREG;
+/*
+  the status register, of which only the I bit is emulated. Clearing
+  it from the sketch takes the interrupt lock, which the timer thread
+  holds while it runs the interrupt handlers, so an interrupt waits
+  for the end of a cli() section as on the AVR. Each thread sees its
+  own value
+ */
+struct desktop_sreg {
+	operator uint8_t() const volatile;
+	void operator=(uint8_t v) volatile;
+};
+extern volatile struct desktop_sreg SREG;
 
 #define _interrupts_are_blocked() ((SREG&0x80)==0)
 
@@ -6,12 +6,59 @@
 #include <BetterStream.h>
 #include <sys/time.h>
 #include <signal.h>
+#include <pthread.h>
 #include "desktop.h"
 
+/*
+  the interrupt lock. The sketch holds it while its I bit is clear,
+  and the timer holds it for the whole of each tick. Inside a tick the
+  I bit is only nominal: on the AVR an ISR that re-enables interrupts
+  still can't be preempted by the sketch
+ */
+static pthread_mutex_t interrupt_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread uint8_t sreg = 0x80;
+static __thread uint8_t interrupt_depth;
+
+desktop_sreg::operator uint8_t() const volatile
+{
+	return sreg;
+}
+
+void desktop_sreg::operator=(uint8_t v) volatile
+{
+	if (interrupt_depth == 0) {
+		if ((sreg & 0x80) && !(v & 0x80)) {
+			pthread_mutex_lock(&interrupt_lock);
+		} else if (!(sreg & 0x80) && (v & 0x80)) {
+			pthread_mutex_unlock(&interrupt_lock);
+		}
+	}
+	sreg = v;
+}
+
+volatile struct desktop_sreg SREG;
+
+/*
+  run interrupt handlers. Waits for the end of any cli() section of
+  the sketch
+ */
+void desktop_interrupt_enter(void)
+{
+	if (interrupt_depth++ == 0) {
+		pthread_mutex_lock(&interrupt_lock);
+	}
+}
+
+void desktop_interrupt_exit(void)
+{
+	if (--interrupt_depth == 0) {
+		pthread_mutex_unlock(&interrupt_lock);
+	}
+}
+
 extern "C" {
 
 volatile uint8_t __iomem[1024];
-volatile uint8_t SREG = 0x80;
 
 unsigned __brkval = 0x2000;
 unsigned __bss_end = 0x1000;
@@ -19,13 +66,13 @@ unsigned __bss_end = 0x1000;
 // disable interrupts
 void cli(void)
 {
-	SREG &= ~0x80;
+	SREG = SREG & ~0x80;
 }
 
 // enable interrupts
 void sei(void)
 {
-	SREG |= 0x80;
+	SREG = SREG | 0x80;
 }
 
 void pinMode(uint8_t pin, uint8_t mode)
@@ -36,6 +83,9 @@ void pinMode(uint8_t pin, uint8_t mode)
 
 long unsigned int millis(void)
 {
+	if (desktop_state.replay) {
+		return sitl_replay_micros() / 1000;
+	}
 	struct timeval tp;
 	gettimeofday(&tp,NULL);
 	return 1.0e3*((tp.tv_sec + (tp.tv_usec*1.0e-6)) - 
@@ -45,6 +95,9 @@ long unsigned int millis(void)
 
 long unsigned int micros(void)
 {
+	if (desktop_state.replay) {
+		return sitl_replay_micros();
+	}
 	struct timeval tp;
 	gettimeofday(&tp,NULL);
 	return 1.0e6*((tp.tv_sec + (tp.tv_usec*1.0e-6)) - 
@@ -54,6 +107,10 @@ long unsigned int micros(void)
 
 void delayMicroseconds(unsigned usec)
 {
+	if (desktop_state.replay) {
+		sitl_replay_advance(usec);
+		return;
+	}
 	uint32_t start = micros();
 	while (micros() - start < usec) {
 		usleep(usec - (micros() - start));
@@ -62,7 +119,11 @@ void delayMicroseconds(unsigned usec)
 
 void delay(long unsigned msec)
 {
-	delayMicroseconds(msec*1000);
+	// keep the serial ports moving while setup() and the CLI wait
+	while (msec--) {
+		delayMicroseconds(1000);
+		desktop_serial_io();
+	}
 }
 
 size_t strlcat_P(char *d, PGM_P s, size_t bufsize)
@@ -39,16 +39,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
-#include <sys/ioctl.h>
+#include <termios.h>
 #include <sys/types.h> 
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <arpa/inet.h>
 #include "desktop.h"
 #include "util.h"
+#include "sitl_io.h"
 
 #define LISTEN_BASE_PORT 5760
-#define BUFFER_SIZE 128
 
     
 #if   defined(UDR3)
@@ -65,15 +67,44 @@
 # define MSG_NOSIGNAL 0
 #endif
 
+/*
+  the sockets stand in for the UART. The I/O thread moves bytes
+  between them and the rx/tx queues, and desktop_serial_io() moves
+  them between the queues and the port's ring buffers once per main
+  loop pass and from delay(), so the sketch's serial calls never make
+  a system call and see the buffer occupancy the hardware would give.
+  Everything but the queues belongs to the I/O thread once the port is
+  started
+ */
 static struct tcp_state {
 	bool connected; // true if a client has connected
 	int listen_fd;  // socket we are listening on
 	int fd;         // data socket
 	int serial_port;
 	bool console;
+	bool pipe;      // fed from a capture file when replaying
+	bool gps;       // the emulated GPS
+	bool udp;       // datagram link to another SITL instance
+	bool device;    // a tty or other device, read and written directly
+	bool rx_pending; // input left waiting for queue space
+	bool rx_poll;   // input that can't be waited on
+	uint8_t dgram[512];
+	uint16_t dgram_len, dgram_ofs;
+	struct sitl_queue rxq, txq;
 } tcp_state[FS_MAX_PORTS];
 
+static void serial_input(void *arg);
+static void serial_accept(void *arg);
 
+static void serial_connected(struct tcp_state *s)
+{
+	int one = 1;
+	setsockopt(s->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	setsockopt(s->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	set_nonblocking(s->fd);
+	s->connected = true;
+	sitl_io_watch(s->fd, serial_input, s);
+}
 
 /*
   start a TCP connection for a given serial port. If
@@ -94,6 +125,9 @@ static void tcp_start_connection(unsigned int serial_port, bool wait_for_connect
 		s->serial_port = serial_port;
 		s->console = true;
 		set_nonblocking(0);
+		if (!sitl_io_watch(0, serial_input, s)) {
+			s->rx_poll = true;
+		}
 		return;
 	}
 
@@ -104,7 +138,7 @@ static void tcp_start_connection(unsigned int serial_port, bool wait_for_connect
 #ifdef HAVE_SOCK_SIN_LEN
 	sockaddr.sin_len = sizeof(sockaddr);
 #endif
-	sockaddr.sin_port = htons(LISTEN_BASE_PORT+serial_port);
+	sockaddr.sin_port = htons(LISTEN_BASE_PORT + 10*desktop_state.instance + serial_port);
 	sockaddr.sin_family = AF_INET;
 
 	s->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -130,7 +164,7 @@ static void tcp_start_connection(unsigned int serial_port, bool wait_for_connect
         exit(1);
 	}
 
-	printf("Serial port %u on TCP port %u\n", serial_port, LISTEN_BASE_PORT+serial_port);
+	printf("Serial port %u on TCP port %u\n", serial_port, (unsigned)ntohs(sockaddr.sin_port));
 	fflush(stdout);
 
 	if (wait_for_connection) {
@@ -140,59 +174,348 @@ static void tcp_start_connection(unsigned int serial_port, bool wait_for_connect
             fprintf(stderr, "accept() error - %s", strerror(errno));
             exit(1);
         }
-		setsockopt(s->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
-		setsockopt(s->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
-		s->connected = true;
-		if (!desktop_state.slider) {
-			set_nonblocking(s->fd);
-		}
+		serial_connected(s);
     }
+
+	// later clients are taken by the I/O thread
+	set_nonblocking(s->listen_fd);
+	sitl_io_watch(s->listen_fd, serial_accept, s);
 }
 
 
 /*
-  use select() to see if something is pending
+  link a serial port to another SITL instance over UDP on the
+  loopback interface, as a stand in for a telemetry radio
+ */
+static void udp_start_connection(unsigned int serial_port)
+{
+	struct tcp_state *s = &tcp_state[serial_port];
+	int one=1;
+	struct sockaddr_in sockaddr;
+
+	s->serial_port = serial_port;
+
+	memset(&sockaddr,0,sizeof(sockaddr));
+#ifdef HAVE_SOCK_SIN_LEN
+	sockaddr.sin_len = sizeof(sockaddr);
+#endif
+	sockaddr.sin_family = AF_INET;
+	inet_pton(AF_INET, "127.0.0.1", &sockaddr.sin_addr);
+
+	s->fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (s->fd == -1) {
+		fprintf(stderr, "socket failed - %s\n", strerror(errno));
+		exit(1);
+	}
+	setsockopt(s->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	sockaddr.sin_port = htons(desktop_state.link_port);
+	if (bind(s->fd, (struct sockaddr *)&sockaddr, sizeof(sockaddr)) == -1) {
+		fprintf(stderr, "bind failed on port %u - %s\n",
+				(unsigned)desktop_state.link_port, strerror(errno));
+		exit(1);
+	}
+
+	// only accept datagrams from the other instance
+	sockaddr.sin_port = htons(desktop_state.link_remote);
+	if (connect(s->fd, (struct sockaddr *)&sockaddr, sizeof(sockaddr)) == -1) {
+		fprintf(stderr, "connect failed on port %u - %s\n",
+				(unsigned)desktop_state.link_remote, strerror(errno));
+		exit(1);
+	}
+	set_nonblocking(s->fd);
+
+	s->connected = true;
+	s->udp = true;
+	s->dgram_len = s->dgram_ofs = 0;
+	sitl_io_watch(s->fd, serial_input, s);
+	printf("Serial port %u on UDP port %u linked to %u\n", serial_port,
+		   (unsigned)desktop_state.link_port, (unsigned)desktop_state.link_remote);
+	fflush(stdout);
+}
+
+/*
+  start reading a pipe, for the GPS and when replaying
+ */
+static void pipe_start_connection(unsigned int serial_port, int fd)
+{
+	struct tcp_state *s = &tcp_state[serial_port];
+
+	s->connected = true;
+	s->fd = fd;
+	s->serial_port = serial_port;
+	s->gps = (serial_port == 1);
+	s->pipe = !s->gps;
+	sitl_io_watch(fd, serial_input, s);
+}
+
+
+static speed_t tty_speed(long baud)
+{
+	switch (baud) {
+	case 1200:   return B1200;
+	case 2400:   return B2400;
+	case 4800:   return B4800;
+	case 9600:   return B9600;
+	case 19200:  return B19200;
+	case 38400:  return B38400;
+	case 57600:  return B57600;
+	case 115200: return B115200;
+#ifdef B230400
+	case 230400: return B230400;
+#endif
+#ifdef B460800
+	case 460800: return B460800;
+#endif
+#ifdef B921600
+	case 921600: return B921600;
+#endif
+	}
+	return B0;
+}
+
+/*
+  listen on a unix socket, for a process on the same host such as the
+  vision computer's solver. One client at a time is taken, as with the
+  TCP ports
+ */
+static void unix_start_connection(unsigned int serial_port, const char *path)
+{
+	struct tcp_state *s = &tcp_state[serial_port];
+	struct sockaddr_un sockaddr;
+
+	s->serial_port = serial_port;
+
+	memset(&sockaddr, 0, sizeof(sockaddr));
+	sockaddr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(sockaddr.sun_path)) {
+		fprintf(stderr, "socket path too long - %s\n", path);
+		exit(1);
+	}
+	strcpy(sockaddr.sun_path, path);
+
+	s->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (s->listen_fd == -1) {
+		fprintf(stderr, "socket failed - %s\n", strerror(errno));
+		exit(1);
+	}
+	unlink(path);
+	if (bind(s->listen_fd, (struct sockaddr *)&sockaddr, sizeof(sockaddr)) == -1 ||
+		listen(s->listen_fd, 5) == -1) {
+		fprintf(stderr, "can't listen on %s - %s\n", path, strerror(errno));
+		exit(1);
+	}
+	printf("Serial port %u on unix socket %s\n", serial_port, path);
+	fflush(stdout);
+
+	set_nonblocking(s->listen_fd);
+	sitl_io_watch(s->listen_fd, serial_accept, s);
+}
+
+/*
+  open a serial device, such as a UART or the slave side of a pty
+  shared with another process. A tty is put in raw mode at the baud
+  rate given to begin(). Anything else that can be opened, such as a
+  FIFO, is read and written as it is
  */
-static bool select_check(int fd)
+static void device_start_connection(unsigned int serial_port, const char *path, long baud)
 {
-	fd_set fds;
-	struct timeval tv;
+	struct tcp_state *s = &tcp_state[serial_port];
+	struct termios t;
 
-	FD_ZERO(&fds);
-	FD_SET(fd, &fds);
+	if (strncmp(path, "unix:", 5) == 0) {
+		unix_start_connection(serial_port, path+5);
+		return;
+	}
 
-	// zero time means immediate return from select()
-	tv.tv_sec = 0;
-	tv.tv_usec = 0;
+	s->serial_port = serial_port;
+	s->fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (s->fd == -1) {
+		fprintf(stderr, "can't open %s - %s\n", path, strerror(errno));
+		exit(1);
+	}
+
+	if (tcgetattr(s->fd, &t) == 0) {
+		speed_t speed = tty_speed(baud);
+		if (speed == B0) {
+			fprintf(stderr, "unsupported baud rate %ld for %s\n", baud, path);
+			exit(1);
+		}
+		cfmakeraw(&t);
+		cfsetispeed(&t, speed);
+		cfsetospeed(&t, speed);
+		t.c_cflag |= CLOCAL | CREAD;
+		t.c_cc[VMIN] = 0;
+		t.c_cc[VTIME] = 0;
+		if (tcsetattr(s->fd, TCSANOW, &t) == -1) {
+			fprintf(stderr, "can't set up %s - %s\n", path, strerror(errno));
+			exit(1);
+		}
+		tcflush(s->fd, TCIOFLUSH);
+		printf("Serial port %u on %s at %ld baud\n", serial_port, path, baud);
+	} else {
+		printf("Serial port %u on %s\n", serial_port, path);
+	}
+	fflush(stdout);
 
-	if (select(fd+1, &fds, NULL, NULL, &tv) == 1) {
-		return true;
+	s->connected = true;
+	s->device = true;
+	if (!sitl_io_watch(s->fd, serial_input, s)) {
+		s->rx_poll = true;
 	}
-	return false;
 }
 
 
 /*
-  see if a new connection is coming in
+  see if a new connection is coming in. Called from the I/O thread
  */
-static void check_connection(struct tcp_state *s)
+static void serial_accept(void *arg)
 {
+	struct tcp_state *s = (struct tcp_state *)arg;
+
 	if (s->connected) {
-		// we only want 1 connection at a time
+		// we only want 1 connection at a time. This is tried
+		// again when the current client goes away
 		return;
 	}
-	if (select_check(s->listen_fd)) {
-		s->fd = accept(s->listen_fd, NULL, NULL);
-		if (s->fd != -1) {
-			int one = 1;
-			s->connected = true;
-			setsockopt(s->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
-			setsockopt(s->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
-			printf("New connection on serial port %u\n", s->serial_port);
-			if (!desktop_state.slider) {
-				set_nonblocking(s->fd);
-			}
+	s->fd = accept(s->listen_fd, NULL, NULL);
+	if (s->fd != -1) {
+		serial_connected(s);
+		printf("New connection on serial port %u\n", s->serial_port);
+		fflush(stdout);
+	}
+}
+
+static void serial_close(struct tcp_state *s)
+{
+	sitl_io_unwatch(s->fd);
+	close(s->fd);
+	s->connected = false;
+	fprintf(stdout, "Closed connection on serial port %u\n", s->serial_port);
+	fflush(stdout);
+	serial_accept(s);
+}
+
+/*
+  read up to count waiting bytes from the port's socket, pipe or
+  console. Returns 0 if there are none
+ */
+static ssize_t port_recv(struct tcp_state *s, uint8_t *buf, size_t count)
+{
+	ssize_t n;
+
+	if (s->gps) {
+		n = sitl_gps_read(s->fd, buf, count);
+		return n > 0 ? n : 0;
+	}
+
+	if (s->pipe || s->device) {
+		n = ::read(s->fd, buf, count);
+		return n > 0 ? n : 0;
+	}
+
+	if (s->udp) {
+		// datagrams are staged whole, as a short recv() would
+		// discard the rest
+		if (s->dgram_ofs == s->dgram_len) {
+			n = recv(s->fd, s->dgram, sizeof(s->dgram), MSG_DONTWAIT);
+			s->dgram_len = n > 0 ? n : 0;
+			s->dgram_ofs = 0;
+		}
+		n = s->dgram_len - s->dgram_ofs;
+		if ((size_t)n > count) {
+			n = count;
 		}
+		memcpy(buf, &s->dgram[s->dgram_ofs], n);
+		s->dgram_ofs += n;
+		return n;
+	}
+
+	if (s->console) {
+		n = ::read(0, buf, count);
+		return n > 0 ? n : 0;
+	}
+
+	n = recv(s->fd, buf, count, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (n == 0 || (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+		// the socket has reached EOF
+		serial_close(s);
+		return 0;
+	}
+	return n > 0 ? n : 0;
+}
+
+/*
+  send up to count bytes. Returns the number taken, which is all of
+  them for ports with nowhere to send to
+ */
+static ssize_t port_send(struct tcp_state *s, const uint8_t *buf, size_t count)
+{
+	ssize_t n;
+
+	if (!s->connected || s->pipe || s->gps) {
+		return count;
+	}
+	if (s->console || s->device) {
+		n = ::write(s->fd, buf, count);
+	} else {
+		n = send(s->fd, buf, count, MSG_DONTWAIT | MSG_NOSIGNAL);
+	}
+	return n > 0 ? n : 0;
+}
+
+/*
+  fill the receive queue until the port would block. If the queue
+  fills first the rest is read on a later pass of the I/O thread
+ */
+static void serial_input(void *arg)
+{
+	struct tcp_state *s = (struct tcp_state *)arg;
+
+	s->rx_pending = false;
+	while (s->connected) {
+		uint8_t *p;
+		uint32_t space = sitl_queue_write_span(&s->rxq, &p);
+		if (space == 0) {
+			s->rx_pending = true;
+			break;
+		}
+		ssize_t n = port_recv(s, p, space);
+		if (n <= 0) {
+			break;
+		}
+		sitl_queue_commit(&s->rxq, n);
+	}
+}
+
+/*
+  send what the firmware has queued
+ */
+static void serial_output(struct tcp_state *s)
+{
+	const uint8_t *p;
+	uint32_t n;
+
+	while ((n = sitl_queue_read_span(&s->txq, &p)) > 0) {
+		ssize_t sent = port_send(s, p, n);
+		if (sent <= 0) {
+			break;
+		}
+		sitl_queue_consume(&s->txq, sent);
+		if ((uint32_t)sent < n) {
+			break;
+		}
+	}
+}
+
+static void serial_service(void)
+{
+	for (uint8_t i=0; i<FS_MAX_PORTS; i++) {
+		struct tcp_state *s = &tcp_state[i];
+		if (s->rx_pending || s->rx_poll) {
+			serial_input(s);
+		}
+		serial_output(s);
 	}
 }
 
@@ -200,6 +523,68 @@ static void check_connection(struct tcp_state *s)
 FastSerial::Buffer __FastSerial__rxBuffer[FS_MAX_PORTS];
 FastSerial::Buffer __FastSerial__txBuffer[FS_MAX_PORTS];
 
+/*
+  move data between a port's queues and its ring buffers, in at most
+  two contiguous spans each way
+ */
+static void serial_poll(uint8_t port)
+{
+	struct tcp_state *s = &tcp_state[port];
+	FastSerial::Buffer *b = &__FastSerial__txBuffer[port];
+
+	if (b->bytes != NULL) {
+		while (b->head != b->tail) {
+			uint16_t span = (b->head > b->tail) ? b->head - b->tail : (b->mask + 1) - b->tail;
+			uint32_t n = sitl_queue_write(&s->txq, &b->bytes[b->tail], span);
+			b->tail = (b->tail + n) & b->mask;
+			if (n < span) {
+				break;
+			}
+		}
+	}
+
+	b = &__FastSerial__rxBuffer[port];
+	if (b->bytes != NULL) {
+		uint16_t space = (b->tail - b->head - 1) & b->mask;
+		while (space > 0) {
+			uint16_t span = (b->mask + 1) - b->head;
+			if (span > space) {
+				span = space;
+			}
+			uint32_t n = sitl_queue_read(&s->rxq, &b->bytes[b->head], span);
+			b->head = (b->head + n) & b->mask;
+			space -= n;
+			if (n < span) {
+				break;
+			}
+		}
+	}
+}
+
+void desktop_serial_io(void)
+{
+	if (!sitl_io_threaded()) {
+		// replaying, the pipes are read here to keep it deterministic
+		sitl_io_run(0);
+	}
+	for (uint8_t i=0; i<FS_MAX_PORTS; i++) {
+		serial_poll(i);
+	}
+}
+
+/*
+  refill a port with an empty receive ring. The CLI and init_home()
+  spin on the port without returning to the main loop, and would
+  otherwise never see data
+ */
+static void serial_underrun(uint8_t port)
+{
+	if (!sitl_io_threaded() && sitl_queue_available(&tcp_state[port].rxq) == 0) {
+		sitl_io_run(0);
+	}
+	serial_poll(port);
+}
+
 // Constructor /////////////////////////////////////////////////////////////////
 
 FastSerial::FastSerial(const uint8_t portNumber, volatile uint8_t *ubrrh, volatile uint8_t *ubrrl,
@@ -221,6 +606,51 @@ FastSerial::FastSerial(const uint8_t portNumber, volatile uint8_t *ubrrh, volati
 
 void FastSerial::begin(long baud)
 {
+	begin(baud, 0, 0);
+}
+
+void FastSerial::begin(long baud, unsigned int rxSpace, unsigned int txSpace)
+{
+	bool was_open = _open;
+
+	// size the buffers as the AVR driver does
+	if (_open) {
+		if (0 == rxSpace)
+			rxSpace = _rxBuffer->mask + 1;
+		if (0 == txSpace)
+			txSpace = _txBuffer->mask + 1;
+	}
+	if (!_allocBuffer(_rxBuffer, rxSpace ? : _default_rx_buffer_size) ||
+		!_allocBuffer(_txBuffer, txSpace ? : _default_tx_buffer_size)) {
+		end();
+		return;
+	}
+	_txBuffer->head = _txBuffer->tail = 0;
+	_rxBuffer->head = _rxBuffer->tail = 0;
+	_open = true;
+
+	if (was_open) {
+		// already connected
+		return;
+	}
+
+	static bool service_added;
+	if (!service_added) {
+		sitl_io_add_service(serial_service);
+		service_added = true;
+	}
+
+	if (desktop_state.replay && _u2x != 1) {
+		// everything except the GPS comes from the capture
+		pipe_start_connection(_u2x, sitl_replay_serial_pipe(_u2x));
+		return;
+	}
+
+	if (_u2x < DESKTOP_SERIAL_PORTS && desktop_state.serial_device[_u2x] != NULL) {
+		device_start_connection(_u2x, desktop_state.serial_device[_u2x], baud);
+		return;
+	}
+
 	switch (_u2x) {
 	case 0:
 		tcp_start_connection(_u2x, true);
@@ -228,151 +658,181 @@ void FastSerial::begin(long baud)
 
 	case 1:
 		/* gps */
-		tcp_state[1].connected = true;
-		tcp_state[1].fd = sitl_gps_pipe();
-		tcp_state[1].serial_port = 1;
+		pipe_start_connection(1, sitl_gps_pipe());
 		break;
 
 	default:
-		tcp_start_connection(_u2x, false);
+		if (_u2x == 3 && desktop_state.link_port != 0) {
+			udp_start_connection(_u2x);
+		} else {
+			tcp_start_connection(_u2x, false);
+		}
 		break;
 	}
 }
 
-void FastSerial::begin(long baud, unsigned int rxSpace, unsigned int txSpace)
-{
-	begin(baud);
-}
-
 void FastSerial::end()
 {
+	_freeBuffer(_rxBuffer);
+	_freeBuffer(_txBuffer);
+	_open = false;
 }
 
 int FastSerial::available(void)
 {
-	struct tcp_state *s = &tcp_state[_u2x];
-
-	check_connection(s);
-
-	if (!s->connected) {
-		return 0;
-	}
-
-	if (select_check(s->fd)) {
-#ifdef FIONREAD
-		// use FIONREAD to get exact value if possible
-		int num_ready;
-		if (ioctl(s->fd, FIONREAD, &num_ready) == 0) {
-			if (num_ready > BUFFER_SIZE) {
-				return BUFFER_SIZE;
-			}
-			if (num_ready == 0) {
-				// EOF is reached
-				fprintf(stdout, "Closed connection on serial port %u\n", s->serial_port);
-				close(s->fd);
-				s->connected = false;
-				return 0;
-			}
-			return num_ready;
-		}
-#endif
-		return 1; // best we can do is say 1 byte available
-	}
-	return 0;
+	if (!_open)
+		return (-1);
+	if (_rxBuffer->head == _rxBuffer->tail)
+		serial_underrun(_u2x);
+	return ((_rxBuffer->head - _rxBuffer->tail) & _rxBuffer->mask);
 }
 
 int FastSerial::txspace(void)
 {
-	// always claim there is space available
-	return BUFFER_SIZE;
+	if (!_open)
+		return (-1);
+	return ((_txBuffer->mask+1) - ((_txBuffer->head - _txBuffer->tail) & _txBuffer->mask));
 }
 
 int FastSerial::read(void)
 {
-	struct tcp_state *s = &tcp_state[_u2x];
-	char c;
+	uint8_t c;
 
-	if (available() <= 0) {
-		return -1;
-	}
+	if (!_open)
+		return (-1);
 
-	if (s->serial_port == 1) {
-		if (sitl_gps_read(s->fd, &c, 1) == 1) {
-			return (uint8_t)c;
-		}
-		return -1;
+	if (_rxBuffer->head == _rxBuffer->tail) {
+		serial_underrun(_u2x);
+		if (_rxBuffer->head == _rxBuffer->tail)
+			return (-1);
 	}
 
-	if (s->console) {
-		return ::read(0, &c, 1);
-	}
+	c = _rxBuffer->bytes[_rxBuffer->tail];
+	_rxBuffer->tail = (_rxBuffer->tail + 1) & _rxBuffer->mask;
 
-    int n = recv(s->fd, &c, 1, MSG_DONTWAIT | MSG_NOSIGNAL);
-	if (n <= 0) {
-		// the socket has reached EOF
-		close(s->fd);
-		s->connected = false;
-		fprintf(stdout, "Closed connection on serial port %u\n", s->serial_port);
-		fflush(stdout);
-		return -1;
+	if (_u2x != 1 && !tcp_state[_u2x].pipe) {
+		sitl_record_serial(_u2x, c);
 	}
-    if (n == 1) {
-		return (uint8_t)c;
+	return (c);
+}
+
+uint16_t FastSerial::read_bytes(uint8_t *buffer, uint16_t count)
+{
+	uint16_t head, tail, n, span;
+
+	if (!_open)
+		return 0;
+
+	head = _rxBuffer->head;
+	tail = _rxBuffer->tail;
+	n = (head - tail) & _rxBuffer->mask;
+	if (n > count)
+		n = count;
+	if (n == 0)
+		return 0;
+
+	span = (_rxBuffer->mask + 1) - tail;
+	if (span > n)
+		span = n;
+	memcpy(buffer, &_rxBuffer->bytes[tail], span);
+	if (n > span)
+		memcpy(buffer + span, &_rxBuffer->bytes[0], n - span);
+
+	_rxBuffer->tail = (tail + n) & _rxBuffer->mask;
+
+	if (_u2x != 1 && !tcp_state[_u2x].pipe) {
+		for (uint16_t i=0; i<n; i++) {
+			sitl_record_serial(_u2x, buffer[i]);
+		}
 	}
-	return -1;
+	return n;
 }
 
 int FastSerial::peek(void)
 {
-	return -1;
+	if (!_open)
+		return (-1);
+	if (_rxBuffer->head == _rxBuffer->tail) {
+		serial_underrun(_u2x);
+		if (_rxBuffer->head == _rxBuffer->tail)
+			return (-1);
+	}
+
+	return (_rxBuffer->bytes[_rxBuffer->tail]);
 }
 
 void FastSerial::flush(void)
 {
+	// discards both buffers, as on the AVR
+	_rxBuffer->head = _rxBuffer->tail;
+	_txBuffer->tail = _txBuffer->head;
 }
 
 void FastSerial::write(uint8_t c)
 {
-	struct tcp_state *s = &tcp_state[_u2x];
-	int flags = MSG_NOSIGNAL;
-	check_connection(s);
-	if (!s->connected) {
+	uint16_t i;
+
+	if (!_open)
+		return;
+
+	i = (_txBuffer->head + 1) & _txBuffer->mask;
+
+	// if the port is set into non-blocking mode, then drop the byte
+	// if there isn't enough room for it in the transmit buffer
+	if (_nonblocking_writes && i == _txBuffer->tail) {
 		return;
 	}
-	if (!desktop_state.slider) {
-		flags |= MSG_DONTWAIT;
-	}
-	if (s->console) {
-		::write(s->fd, &c, 1);
-	} else {
-		send(s->fd, &c, 1, flags);
+
+	// otherwise wait for the I/O thread to make room, as the UART
+	// would
+	while (i == _txBuffer->tail) {
+		serial_poll(_u2x);
+		if (i != _txBuffer->tail) {
+			break;
+		}
+		if (sitl_io_threaded()) {
+			usleep(100);
+		} else {
+			sitl_io_run(0);
+		}
 	}
+
+	_txBuffer->bytes[_txBuffer->head] = c;
+	_txBuffer->head = i;
 }
 
 // Buffer management ///////////////////////////////////////////////////////////
 
 bool FastSerial::_allocBuffer(Buffer *buffer, unsigned int size)
 {
-	return false;
-}
+	uint16_t	mask;
+	uint8_t		shift;
 
-void FastSerial::_freeBuffer(Buffer *buffer)
-{
+	buffer->head = buffer->tail = 0;
+
+	// the power of 2 greater or equal to the requested buffer size, up
+	// to _max_buffer_size
+	for (shift = 1; (1U << shift) < min(_max_buffer_size, size); shift++)
+		;
+	mask = (1 << shift) - 1;
+
+	if (buffer->bytes) {
+		if (buffer->mask == mask)
+			return true;
+		free(buffer->bytes);
+	}
+	buffer->mask = mask;
+	buffer->bytes = (uint8_t *) malloc(buffer->mask + 1);
+
+	return (buffer->bytes != NULL);
 }
 
-/*
-  return true if any bytes are pending
- */
-void desktop_serial_select_setup(fd_set *fds, int *fd_high)
+void FastSerial::_freeBuffer(Buffer *buffer)
 {
-	int i;
-
-	for (i=0; i<FS_MAX_PORTS; i++) {
-		if (tcp_state[i].connected) {
-			FD_SET(tcp_state[i].fd, fds);
-			if (tcp_state[i].fd > *fd_high) {
-				*fd_high = tcp_state[i].fd;
-			}
-		}
+	buffer->head = buffer->tail = 0;
+	buffer->mask = 0;
+	if (NULL != buffer->bytes) {
+		free(buffer->bytes);
+		buffer->bytes = NULL;
 	}
 }
@@ -3,6 +3,11 @@
 
 #include <unistd.h>
 #include <sys/time.h>
+#include <stdint.h>
+
+struct sitl_fdm;
+
+#define DESKTOP_SERIAL_PORTS 4
 
 enum vehicle_type {
 	ArduCopter,
@@ -17,11 +22,22 @@ struct desktop_info {
 	unsigned framerate;
 	float initial_height;
 	bool console_mode;
+	bool replay;           // running from a capture file, on a virtual clock
+	uint32_t replay_micros; // virtual time when replaying
+	bool replay_fdm;       // the capture holds flight simulator packets
+	unsigned instance;     // offsets the TCP and FDM ports by 10 per instance
+	uint16_t link_port;    // local UDP port for Serial3 to another instance
+	uint16_t link_remote;  // and the port of the other instance
+	int timer_priority;    // SCHED_FIFO priority of the timer thread, 0 for none
+	unsigned jitter_report; // seconds between timer jitter reports, 0 for none
+	bool fdm_shm;          // also take the FDM over shared memory
+	bool relnav_shm;       // take Rel NAV poses from shared memory
+	const char *serial_device[DESKTOP_SERIAL_PORTS]; // device for a serial port, NULL for TCP
 };
 
 extern struct desktop_info desktop_state;
 
-void desktop_serial_select_setup(fd_set *fds, int *fd_high);
+void desktop_serial_io(void);
 void sitl_input(void);
 void sitl_setup(void);
 int sitl_gps_pipe(void);
@@ -38,4 +54,37 @@ void sitl_update_barometer(float altitude);
 
 void sitl_simstate_send(uint8_t chan);
 
+void sitl_set_adc(double p, double q, double r,
+		  double xAccel, double yAccel, double zAccel,
+		  float airspeed);
+void sitl_set_gps(double latitude, double longitude, float altitude,
+		  double speedN, double speedE, bool have_lock);
+void sitl_set_barometer(float temperature, float pressure);
+void sitl_set_compass(float x, float y, float z);
+
+bool sitl_replay_open(const char *path);
+bool sitl_record_open(const char *path);
+bool sitl_fdm_record_open(const char *path);
+bool sitl_replay_output_open(const char *path);
+bool sitl_stream_capture_open(const char *path);
+bool sitl_stream_replay_open(const char *arg);
+void sitl_replay_advance(uint32_t usec);
+uint32_t sitl_replay_micros(void);
+void sitl_replay_timer(void);
+void desktop_interrupt_enter(void);
+void desktop_interrupt_exit(void);
+int sitl_replay_serial_pipe(uint8_t serial_port);
+void sitl_record_serial(uint8_t serial_port, uint8_t c);
+void sitl_record_imu(double p, double q, double r,
+		     double xAccel, double yAccel, double zAccel,
+		     float airspeed);
+void sitl_record_gps(double latitude, double longitude, float altitude,
+		     double speedN, double speedE, bool have_lock);
+void sitl_record_barometer(float temperature, float pressure);
+void sitl_record_compass(float x, float y, float z);
+void sitl_record_rc(const uint16_t *pwm);
+void sitl_record_fdm(const struct sitl_fdm *fdm);
+void sitl_fdm_state(const struct sitl_fdm *fdm);
+void sitl_record_flush(void);
+
 #endif
@@ -7,6 +7,8 @@
 #include <getopt.h>
 #include <signal.h>
 #include <string.h>
+#include <stdlib.h>
+#include <math.h>
 #include <AP_Common.h>
 #include <AP_Param.h>
 #include "desktop.h"
@@ -32,6 +34,68 @@ static void usage(void)
 	printf("\t-r RATE     set SITL framerate\n");
 	printf("\t-H HEIGHT   initial barometric height\n");
 	printf("\t-C          use console instead of TCP ports\n");
+	printf("\t-W FILE     record sensor data to FILE\n");
+	printf("\t-R FILE     replay sensor data or FDM packets from FILE as fast as possible\n");
+	printf("\t-O FILE     write replayed state to FILE instead of stdout\n");
+	printf("\t-P NAME=VAL set a parameter after startup when replaying\n");
+	printf("\t-I N        instance number, moves the TCP and FDM ports up by 10*N\n");
+	printf("\t-U LOC:REM  link Serial3 to another instance over UDP ports LOC and REM\n");
+	printf("\t-V FILE     capture the raw Rel NAV stream to FILE\n");
+	printf("\t-S FILE[:N] replay a Rel NAV stream capture at N times its recorded speed\n");
+	printf("\t-F PRIO    run the 1kHz timer thread SCHED_FIFO at priority PRIO\n");
+	printf("\t-J SECS    print timer jitter histograms every SECS seconds\n");
+	printf("\t-M         also exchange FDM data with the simulator over shared memory\n");
+	printf("\t-D FILE    record the packets from the flight simulator to FILE\n");
+	printf("\t-A N:DEV   use the tty DEV, or listen on unix:PATH, for serial port N\n");
+	printf("\t-L         take Rel NAV poses from a solver over shared memory\n");
+}
+
+#define MAX_PARAM_OVERRIDES 32
+static const char *param_overrides[MAX_PARAM_OVERRIDES];
+static uint8_t num_param_overrides;
+
+/*
+  set a parameter given as NAME=VALUE, without saving it
+ */
+static void set_parameter(const char *s)
+{
+	char name[AP_MAX_NAME_SIZE+1];
+	const char *eq = strchr(s, '=');
+	enum ap_var_type var_type;
+	AP_Param *vp;
+
+	if (eq == NULL || eq - s > AP_MAX_NAME_SIZE) {
+		fprintf(stderr, "Bad parameter setting '%s'\n", s);
+		exit(1);
+	}
+	strncpy(name, s, eq - s);
+	name[eq - s] = 0;
+
+	vp = AP_Param::find(name, &var_type);
+	if (vp == NULL) {
+		fprintf(stderr, "Unknown parameter '%s'\n", name);
+		exit(1);
+	}
+
+	float value = atof(eq+1);
+	switch (var_type) {
+	case AP_PARAM_FLOAT:
+		((AP_Float *)vp)->set(value);
+		break;
+	case AP_PARAM_INT32:
+		((AP_Int32 *)vp)->set(lrintf(value));
+		break;
+	case AP_PARAM_INT16:
+		((AP_Int16 *)vp)->set(lrintf(value));
+		break;
+	case AP_PARAM_INT8:
+		((AP_Int8 *)vp)->set(lrintf(value));
+		break;
+	default:
+		fprintf(stderr, "Can't set parameter '%s'\n", name);
+		exit(1);
+	}
+	fprintf(stderr, "Set %s to %f\n", name, vp->cast_to_float(var_type));
 }
 
 int main(int argc, char * const argv[])
@@ -43,7 +107,7 @@ int main(int argc, char * const argv[])
 
 	signal(SIGFPE, sig_fpe);
 
-	while ((opt = getopt(argc, argv, "swhr:H:C")) != -1) {
+	while ((opt = getopt(argc, argv, "swhr:H:CW:R:O:P:I:U:V:S:F:J:MD:A:L")) != -1) {
 		switch (opt) {
 		case 's':
 			desktop_state.slider = true;
@@ -61,6 +125,74 @@ int main(int argc, char * const argv[])
 		case 'C':
 			desktop_state.console_mode = true;
 			break;
+		case 'W':
+			if (!sitl_record_open(optarg)) {
+				exit(1);
+			}
+			break;
+		case 'R':
+			if (!sitl_replay_open(optarg)) {
+				exit(1);
+			}
+			break;
+		case 'O':
+			if (!sitl_replay_output_open(optarg)) {
+				exit(1);
+			}
+			break;
+		case 'P':
+			if (num_param_overrides == MAX_PARAM_OVERRIDES) {
+				fprintf(stderr, "Too many parameter settings\n");
+				exit(1);
+			}
+			param_overrides[num_param_overrides++] = optarg;
+			break;
+		case 'I':
+			desktop_state.instance = (unsigned)atoi(optarg);
+			break;
+		case 'U':
+			if (sscanf(optarg, "%hu:%hu", &desktop_state.link_port, &desktop_state.link_remote) != 2) {
+				usage();
+				exit(1);
+			}
+			break;
+		case 'V':
+			if (!sitl_stream_capture_open(optarg)) {
+				exit(1);
+			}
+			break;
+		case 'S':
+			if (!sitl_stream_replay_open(optarg)) {
+				exit(1);
+			}
+			break;
+		case 'F':
+			desktop_state.timer_priority = atoi(optarg);
+			break;
+		case 'J':
+			desktop_state.jitter_report = (unsigned)atoi(optarg);
+			break;
+		case 'M':
+			desktop_state.fdm_shm = true;
+			break;
+		case 'D':
+			if (!sitl_fdm_record_open(optarg)) {
+				exit(1);
+			}
+			break;
+		case 'L':
+			desktop_state.relnav_shm = true;
+			break;
+		case 'A': {
+			char *end;
+			unsigned long port = strtoul(optarg, &end, 10);
+			if (end == optarg || *end != ':' || port >= DESKTOP_SERIAL_PORTS) {
+				usage();
+				exit(1);
+			}
+			desktop_state.serial_device[port] = end+1;
+			break;
+		}
 		default:
 			usage();
 			exit(1);
@@ -91,25 +223,31 @@ int main(int argc, char * const argv[])
 	sitl_setup();
 	setup();
 
+	if (desktop_state.replay) {
+		for (uint8_t i=0; i<num_param_overrides; i++) {
+			set_parameter(param_overrides[i]);
+		}
+		// run on the virtual clock until the capture file ends
+		while (true) {
+			loop();
+			sitl_replay_advance(1000);
+			desktop_serial_io();
+		}
+	}
+
 	while (true) {
-		struct timeval tv;
-		fd_set fds;
-		int fd_high = 0;
-        
 #ifdef __CYGWIN__
         // under windows if this loop is using alot of cpu,
         // the alarm gets called at a slower rate.
         sleep(5);
 #endif
 
-		FD_ZERO(&fds);
 		loop();
 
-		desktop_serial_select_setup(&fds, &fd_high);
-		tv.tv_sec = 0;
-		tv.tv_usec = 100;
+		// the I/O thread fills the serial queues meanwhile
+		usleep(100);
 
-		select(fd_high+1, &fds, NULL, NULL, &tv);
+		desktop_serial_io();
 	}
 	return 0;
 }
@@ -20,17 +20,27 @@
 #include <time.h>
 #include <sys/time.h>
 #include <signal.h>
+#include <pthread.h>
+#include <sched.h>
 #include <math.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 #include <APM_RC.h>
 #include <wiring.h>
 #include <AP_PeriodicProcess.h>
 #include <AP_TimerProcess.h>
 #include <SITL.h>
+#include <RelNAV_Protocol.h>
 #include <avr/interrupt.h>
 #include "sitl_adc.h"
 #include "sitl_rc.h"
 #include "desktop.h"
 #include "util.h"
+#include "sitl_io.h"
 
 #define SIMIN_PORT 5501
 #define RCOUT_PORT 5502
@@ -48,6 +58,20 @@ extern SITL sitl;
 
 static uint32_t update_count;
 
+// FDM and RC input packets from the I/O thread, RC output to it
+static struct sitl_queue fdm_queue, rcout_queue;
+static uint32_t fdm_drops; // packets the FDM queue had no room for
+
+static void fdm_receive(void *);
+static void fdm_service(void);
+
+// the shared memory transport, if started with -M
+static struct sitl_shm *fdm_shm;
+static uint32_t fdm_shm_ack; // last message read from the simulator
+
+// the Rel NAV pose slot, if started with -L
+static struct relnav_shm *relnav_shm;
+
 
 /*
   setup a SITL FDM listening UDP port
@@ -62,7 +86,7 @@ static void setup_fdm(void)
 #ifdef HAVE_SOCK_SIN_LEN
 	sockaddr.sin_len = sizeof(sockaddr);
 #endif
-	sockaddr.sin_port = htons(SIMIN_PORT);
+	sockaddr.sin_port = htons(SIMIN_PORT + 10*desktop_state.instance);
 	sockaddr.sin_family = AF_INET;
 
 	sitl_fd = socket(AF_INET, SOCK_DGRAM, 0);
@@ -82,65 +106,224 @@ static void setup_fdm(void)
 	}
 
 	set_nonblocking(sitl_fd);
+	sitl_io_watch(sitl_fd, fdm_receive, NULL);
+	sitl_io_add_service(fdm_service);
 }
 
 /*
-  check for a SITL FDM packet
+  create the shared memory rings for a simulator on this host. The
+  UDP port stays open as well
  */
-static void sitl_fdm_input(void)
+static void setup_fdm_shm(void)
+{
+	char name[32];
+	int fd;
+
+	snprintf(name, sizeof(name), SITL_SHM_NAME, desktop_state.instance);
+	fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+	if (fd == -1 || ftruncate(fd, sizeof(struct sitl_shm)) == -1) {
+		fprintf(stderr, "SITL: can't create shared memory %s - %s\n", name, strerror(errno));
+		exit(1);
+	}
+	fdm_shm = (struct sitl_shm *)mmap(NULL, sizeof(struct sitl_shm), PROT_READ | PROT_WRITE,
+									  MAP_SHARED, fd, 0);
+	close(fd);
+	if (fdm_shm == MAP_FAILED) {
+		fprintf(stderr, "SITL: can't map shared memory %s - %s\n", name, strerror(errno));
+		exit(1);
+	}
+
+	// a client of an earlier run sees the magic go away
+	__atomic_store_n(&fdm_shm->magic, 0, __ATOMIC_SEQ_CST);
+	memset(&fdm_shm->to_sitl, 0, sizeof(fdm_shm->to_sitl));
+	memset(&fdm_shm->from_sitl, 0, sizeof(fdm_shm->from_sitl));
+	fdm_shm->version = SITL_SHM_VERSION;
+	fdm_shm->size = sizeof(struct sitl_shm);
+	__atomic_store_n(&fdm_shm->magic, SITL_SHM_MAGIC, __ATOMIC_SEQ_CST);
+	printf("FDM shared memory %s\n", name);
+}
+
+/*
+  create the Rel NAV pose slot for a solver on this host
+ */
+static void setup_relnav_shm(void)
+{
+	char name[32];
+	int fd;
+
+	snprintf(name, sizeof(name), RELNAV_SHM_NAME, desktop_state.instance);
+	fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+	if (fd == -1 || ftruncate(fd, sizeof(struct relnav_shm)) == -1) {
+		fprintf(stderr, "SITL: can't create shared memory %s - %s\n", name, strerror(errno));
+		exit(1);
+	}
+	relnav_shm = (struct relnav_shm *)mmap(NULL, sizeof(struct relnav_shm), PROT_READ | PROT_WRITE,
+										   MAP_SHARED, fd, 0);
+	close(fd);
+	if (relnav_shm == MAP_FAILED) {
+		fprintf(stderr, "SITL: can't map shared memory %s - %s\n", name, strerror(errno));
+		exit(1);
+	}
+
+	// a solver left from an earlier run sees the magic go away
+	__atomic_store_n(&relnav_shm->magic, 0, __ATOMIC_SEQ_CST);
+	memset(relnav_shm, 0, sizeof(*relnav_shm));
+	relnav_shm->version = RELNAV_SHM_VERSION;
+	__atomic_store_n(&relnav_shm->magic, RELNAV_SHM_MAGIC, __ATOMIC_SEQ_CST);
+	printf("Rel NAV shared memory %s\n", name);
+}
+
+const struct relnav_shm *sitl_relnav_shm(void)
 {
+	return relnav_shm;
+}
+
+/*
+  queue the packets from the flight sim. Called from the I/O thread.
+  A packet the queue has no room for is dropped and counted, as the
+  next one supersedes it
+ */
+static void fdm_receive(void *)
+{
+	uint8_t pkt[256];
 	ssize_t size;
-	struct pwm_packet {
-		uint16_t pwm[8];
-	};
+
+	while ((size = recv(sitl_fd, pkt, sizeof(pkt), MSG_DONTWAIT)) > 0) {
+		if (!sitl_queue_put_record(&fdm_queue, pkt, size)) {
+			__atomic_add_fetch(&fdm_drops, 1, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+/*
+  send the RC outputs to the flight sim, and make sure we die if our
+  parent dies. Called from the I/O thread
+ */
+static void fdm_service(void)
+{
+	uint8_t pkt[256];
+	uint16_t size;
+
+#ifndef __CYGWIN__
+	if (kill(parent_pid, 0) != 0) {
+		exit(1);
+	}
+#endif
+
+	while ((size = sitl_queue_get_record(&rcout_queue, pkt, sizeof(pkt))) > 0) {
+		sendto(sitl_fd, pkt, size, MSG_DONTWAIT, (const sockaddr *)&rcout_addr, sizeof(rcout_addr));
+	}
+}
+
+/*
+  take a new state from the flight sim, or from an FDM capture
+ */
+void sitl_fdm_state(const struct sitl_fdm *fdm)
+{
+	static uint32_t last_report;
+	static uint32_t count;
+
+	if (!desktop_state.replay) {
+		sitl_record_fdm(fdm);
+	}
+
+	if (fdm->latitude == 0 ||
+	    fdm->longitude == 0 ||
+	    fdm->altitude <= 0) {
+		// garbage input
+		return;
+	}
+
+	sitl.state = *fdm;
+	update_count++;
+
+	count++;
+	if (millis() - last_report > 1000) {
+		//printf("SIM %u FPS\n", count);
+		count = 0;
+		last_report = millis();
+	}
+}
+
+/*
+  take the receiver PWM inputs
+ */
+static void sitl_apply_rc_input(const struct sitl_rc_input *rc)
+{
+	uint8_t i;
+	for (i=0; i<8; i++) {
+		// setup the ICR4 register for the RC channel
+		// inputs
+		if (rc->pwm[i] != 0) {
+			ICR4.set(i, rc->pwm[i]);
+		}
+	}
+	sitl_record_rc(rc->pwm);
+}
+
+/*
+  handle a SITL FDM packet
+ */
+static void sitl_fdm_packet(const uint8_t *pkt, uint16_t size)
+{
 	union {
 		struct sitl_fdm fg_pkt;
-		struct pwm_packet pwm_pkt;
+		struct sitl_rc_input pwm_pkt;
 	} d;
 
-	size = recv(sitl_fd, &d, sizeof(d), MSG_DONTWAIT);
+	if (size > sizeof(d)) {
+		return;
+	}
+	memcpy(&d, pkt, size);
 	switch (size) {
-	case 132:
-		static uint32_t last_report;
-		static uint32_t count;
-
+	case SITL_FDM_PACKET_SIZE:
 		if (d.fg_pkt.magic != 0x4c56414e) {
 			printf("Bad FDM packet - magic=0x%08x\n", d.fg_pkt.magic);
 			return;
 		}
-
-		if (d.fg_pkt.latitude == 0 ||
-		    d.fg_pkt.longitude == 0 ||
-		    d.fg_pkt.altitude <= 0) {
-			// garbage input
-			return;
-		}
-
-		sitl.state = d.fg_pkt;
-		update_count++;
-
-		count++;
-		if (millis() - last_report > 1000) {
-			//printf("SIM %u FPS\n", count);
-			count = 0;
-			last_report = millis();
-		}
+		sitl_fdm_state(&d.fg_pkt);
 		break;
 
-	case 16: {
+	case sizeof(struct sitl_rc_input):
 		// a packet giving the receiver PWM inputs
-		uint8_t i;
-		for (i=0; i<8; i++) {
-			// setup the ICR4 register for the RC channel
-			// inputs
-			if (d.pwm_pkt.pwm[i] != 0) {
-				ICR4.set(i, d.pwm_pkt.pwm[i]);
-			}
-		}
+		sitl_apply_rc_input(&d.pwm_pkt);
 		break;
 	}
+}
+
+/*
+  check for SITL FDM packets
+ */
+static void sitl_fdm_input(void)
+{
+	static uint32_t drops_reported;
+	uint8_t pkt[256];
+	uint16_t size;
+
+	while ((size = sitl_queue_get_record(&fdm_queue, pkt, sizeof(pkt))) > 0) {
+		sitl_fdm_packet(pkt, size);
+	}
+
+	uint32_t drops = __atomic_load_n(&fdm_drops, __ATOMIC_RELAXED);
+	if (drops != drops_reported) {
+		printf("SITL: FDM queue full, dropped %lu packets\n",
+			   (unsigned long)(drops - drops_reported));
+		drops_reported = drops;
 	}
 
+	if (fdm_shm == NULL) {
+		return;
+	}
+	const struct sitl_shm_slot *m;
+	while ((m = sitl_shm_peek(&fdm_shm->to_sitl)) != NULL) {
+		if (m->type == SITL_SHM_FDM && m->length >= SITL_FDM_PACKET_SIZE) {
+			sitl_fdm_state((const struct sitl_fdm *)m->data);
+		} else if (m->type == SITL_SHM_RC && m->length >= sizeof(struct sitl_rc_input)) {
+			sitl_apply_rc_input((const struct sitl_rc_input *)m->data);
+		}
+		fdm_shm_ack = m->seq;
+		sitl_shm_next(&fdm_shm->to_sitl);
+	}
 }
 
 // used for noise generation in the ADC code
@@ -152,10 +335,7 @@ bool sitl_motors_on;
 static void sitl_simulator_output(void)
 {
 	static uint32_t last_update;
-	struct {
-		uint16_t pwm[11];
-		uint16_t speed, direction, turbulance;
-	} control;
+	struct sitl_servos control;
 	/* this maps the registers used for PWM outputs. The RC
 	 * driver updates these whenever it wants the channel output
 	 * to change */
@@ -230,32 +410,35 @@ static void sitl_simulator_output(void)
 		control.speed = 0;
 	}
 
-	sendto(sitl_fd, (void*)&control, sizeof(control), MSG_DONTWAIT, (const sockaddr *)&rcout_addr, sizeof(rcout_addr));
+	if (desktop_state.replay) {
+		// nobody to send them to
+		return;
+	}
+
+	sitl_queue_put_record(&rcout_queue, &control, sizeof(control));
+
+	if (fdm_shm != NULL) {
+		sitl_shm_put(&fdm_shm->from_sitl, SITL_SHM_SERVOS, &control, sizeof(control), fdm_shm_ack);
+#ifdef __linux__
+		if (sitl_shm_reader_waiting(&fdm_shm->from_sitl)) {
+			syscall(SYS_futex, &fdm_shm->from_sitl.head, FUTEX_WAKE, 1, NULL, NULL, 0);
+		}
+#endif
+	}
 }
 
 /*
-  timer called at 1kHz
+  run the interrupts for one 1kHz timer tick
  */
-static void timer_handler(int signum)
+static void timer_tick(void)
 {
 	static uint32_t last_update_count;
-	static bool in_timer;
 
-	if (in_timer || _interrupts_are_blocked()) {
-		return;
-	}
+	desktop_interrupt_enter();
 	uint8_t oldSREG = SREG;
 	cli();
 
-	in_timer = true;
-
-#ifndef __CYGWIN__
-	/* make sure we die if our parent dies */
-	if (kill(parent_pid, 0) != 0) {
-		exit(1);
-	}
-#else
-    
+#ifdef __CYGWIN__
 	static uint16_t count = 0;
 	static uint32_t last_report;
         
@@ -280,62 +463,231 @@ static void timer_handler(int signum)
 
 	if (update_count == 0) {
 		sitl_update_gps(0, 0, 0, 0, 0, false);
-		timer_scheduler.run();
-		SREG = oldSREG;
-		in_timer = false;
-		return;
+	} else if (update_count != last_update_count) {
+		last_update_count = update_count;
+
+		sitl_update_gps(sitl.state.latitude, sitl.state.longitude,
+				sitl.state.altitude,
+				sitl.state.speedN, sitl.state.speedE, !sitl.gps_disable);
+		sitl_update_adc(sitl.state.rollDeg, sitl.state.pitchDeg, sitl.state.yawDeg,
+				sitl.state.rollRate, sitl.state.pitchRate, sitl.state.yawRate,
+				sitl.state.xAccel, sitl.state.yAccel, sitl.state.zAccel,
+				sitl.state.airspeed);
+		sitl_update_barometer(sitl.state.altitude);
+		sitl_update_compass(sitl.state.rollDeg, sitl.state.pitchDeg, sitl.state.heading);
+
+		// clear the ADC conversion flag,
+		// so the ADC code doesn't get stuck
+		ADCSRA &= ~_BV(ADSC);
+
+		sitl_record_flush();
 	}
 
-	if (update_count == last_update_count) {
-		timer_scheduler.run();
-		SREG = oldSREG;
-		in_timer = false;
+	// trigger all APM timers. We do this last as it can re-enable
+	// interrupts, which can lead to recursion
+	timer_scheduler.run();
+
+	SREG = oldSREG;
+	desktop_interrupt_exit();
+}
+
+
+/*
+  run the timer when replaying a capture file. The sensor values
+  have already been set from a sensor capture, while the states from
+  an FDM capture go through the sensor emulation as usual
+ */
+void sitl_replay_timer(void)
+{
+	if (_interrupts_are_blocked()) {
 		return;
 	}
-	last_update_count = update_count;
+	if (desktop_state.replay_fdm) {
+		timer_tick();
+		return;
+	}
+	desktop_interrupt_enter();
+	uint8_t oldSREG = SREG;
+	cli();
 
-	sitl_update_gps(sitl.state.latitude, sitl.state.longitude,
-			sitl.state.altitude,
-			sitl.state.speedN, sitl.state.speedE, !sitl.gps_disable);
-	sitl_update_adc(sitl.state.rollDeg, sitl.state.pitchDeg, sitl.state.yawDeg,
-			sitl.state.rollRate, sitl.state.pitchRate, sitl.state.yawRate,
-			sitl.state.xAccel, sitl.state.yAccel, sitl.state.zAccel,
-			sitl.state.airspeed);
-	sitl_update_barometer(sitl.state.altitude);
-	sitl_update_compass(sitl.state.rollDeg, sitl.state.pitchDeg, sitl.state.heading);
+	// trigger RC input
+	if (isr_registry._registry[ISR_REGISTRY_TIMER4_CAPT]) {
+		isr_registry._registry[ISR_REGISTRY_TIMER4_CAPT]();
+	}
 
 	// clear the ADC conversion flag,
 	// so the ADC code doesn't get stuck
 	ADCSRA &= ~_BV(ADSC);
 
-	// trigger all APM timers. We do this last as it can re-enable
-	// interrupts, which can lead to recursion
 	timer_scheduler.run();
 
 	SREG = oldSREG;
-	in_timer = false;
+	desktop_interrupt_exit();
 }
 
 
+#define TIMER_PERIOD_NS 1000000UL // 1kHz
+
+// a tick more than this late restarts the schedule instead of
+// catching up, such as after stopping in a debugger
+#define TIMER_RESYNC_NS 100000000UL
+
 /*
-  setup a timer used to prod the ISRs
+  tick timing histograms, in microseconds. Bucket i counts values
+  below jitter_limits[i], and the last bucket everything above
  */
-static void setup_timer(void)
+static const uint32_t jitter_limits[] = { 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+#define JITTER_BUCKETS (sizeof(jitter_limits)/sizeof(jitter_limits[0]) + 1)
+
+struct jitter_histogram {
+	uint32_t count[JITTER_BUCKETS];
+	uint32_t max_us;
+};
+
+static struct {
+	struct jitter_histogram wakeup;   // start of a tick after its deadline
+	struct jitter_histogram interval; // between the starts of ticks
+	struct jitter_histogram run;      // time spent in the tick
+	uint32_t ticks;
+	uint32_t resyncs;
+} timer_stats;
+
+static void jitter_add(struct jitter_histogram *h, uint32_t us)
 {
-	struct itimerval it;
-	struct sigaction act;
+	uint8_t i;
+	for (i=0; i<JITTER_BUCKETS-1; i++) {
+		if (us < jitter_limits[i]) {
+			break;
+		}
+	}
+	h->count[i]++;
+	if (us > h->max_us) {
+		h->max_us = us;
+	}
+}
 
-	act.sa_handler = timer_handler;
-        act.sa_flags = SA_RESTART|SA_NODEFER;
-        sigemptyset(&act.sa_mask);
-        sigaddset(&act.sa_mask, SIGALRM);
-        sigaction(SIGALRM, &act, NULL);
+static void jitter_print(const char *name, const struct jitter_histogram *h)
+{
+	printf("%-9s", name);
+	for (uint8_t i=0; i<JITTER_BUCKETS; i++) {
+		printf(" %8lu", (unsigned long)h->count[i]);
+	}
+	printf("  max %lu\n", (unsigned long)h->max_us);
+}
 
-	it.it_interval.tv_sec = 0;
-	it.it_interval.tv_usec = 1000; // 1KHz
-	it.it_value = it.it_interval;
+static void timer_report(void)
+{
+	printf("Timer: %lu ticks, %lu resyncs. Histograms in usec:\n         ",
+		   (unsigned long)timer_stats.ticks, (unsigned long)timer_stats.resyncs);
+	for (uint8_t i=0; i<JITTER_BUCKETS-1; i++) {
+		printf("    <%4lu", (unsigned long)jitter_limits[i]);
+	}
+	printf("    more\n");
+	jitter_print("wakeup", &timer_stats.wakeup);
+	jitter_print("interval", &timer_stats.interval);
+	jitter_print("run", &timer_stats.run);
+	fflush(stdout);
+}
 
-	setitimer(ITIMER_REAL, &it, NULL);
+static int64_t timespec_diff_ns(const struct timespec *a, const struct timespec *b)
+{
+	return (a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
+
+static void timespec_add_ns(struct timespec *ts, uint32_t ns)
+{
+	ts->tv_nsec += ns;
+	while (ts->tv_nsec >= 1000000000L) {
+		ts->tv_nsec -= 1000000000L;
+		ts->tv_sec++;
+	}
+}
+
+static void sleep_until(const struct timespec *deadline)
+{
+#ifdef __APPLE__
+	// no clock_nanosleep()
+	struct timespec now, ts;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	int64_t ns = timespec_diff_ns(deadline, &now);
+	if (ns > 0) {
+		ts.tv_sec = ns / 1000000000LL;
+		ts.tv_nsec = ns % 1000000000LL;
+		nanosleep(&ts, NULL);
+	}
+#else
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL) == EINTR) ;
+#endif
+}
+
+/*
+  the timer thread. Ticks are paced by absolute deadlines, so a late
+  tick is followed by quicker ones and none are lost or merged
+ */
+static void *timer_thread(void *)
+{
+	struct timespec deadline, start, end, last_start;
+	uint32_t last_report = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	last_start = deadline;
+
+	while (true) {
+		timespec_add_ns(&deadline, TIMER_PERIOD_NS);
+		sleep_until(&deadline);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		int64_t late = timespec_diff_ns(&start, &deadline);
+		if (late > (int64_t)TIMER_RESYNC_NS) {
+			deadline = start;
+			timer_stats.resyncs++;
+		}
+		jitter_add(&timer_stats.wakeup, late > 0 ? late / 1000 : 0);
+		jitter_add(&timer_stats.interval, timespec_diff_ns(&start, &last_start) / 1000);
+		last_start = start;
+
+		timer_tick();
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		jitter_add(&timer_stats.run, timespec_diff_ns(&end, &start) / 1000);
+		timer_stats.ticks++;
+
+		if (desktop_state.jitter_report != 0 &&
+			timer_stats.ticks - last_report >= desktop_state.jitter_report * 1000UL) {
+			last_report = timer_stats.ticks;
+			timer_report();
+		}
+	}
+	return NULL;
+}
+
+
+/*
+  start the thread that prods the ISRs. It takes no signals, so they
+  all go to the main thread
+ */
+static void setup_timer(void)
+{
+	pthread_t thread;
+	sigset_t all, old;
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	if (pthread_create(&thread, NULL, timer_thread, NULL) != 0) {
+		fprintf(stderr, "SITL: failed to start timer thread - %s\n", strerror(errno));
+		exit(1);
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (desktop_state.timer_priority > 0) {
+		struct sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = desktop_state.timer_priority;
+		int ret = pthread_setschedparam(thread, SCHED_FIFO, &param);
+		if (ret != 0) {
+			fprintf(stderr, "SITL: can't make the timer SCHED_FIFO - %s\n", strerror(ret));
+		}
+	}
 }
 
 
@@ -348,20 +700,44 @@ void sitl_setup(void)
 	parent_pid = getppid();
 #endif
 
-	rcout_addr.sin_family = AF_INET;
-	rcout_addr.sin_port = htons(RCOUT_PORT);
-	inet_pton(AF_INET, "127.0.0.1", &rcout_addr.sin_addr);
+	if (desktop_state.replay && !desktop_state.replay_fdm) {
+		// no flight simulator or timer signal, the capture
+		// file drives everything
+		sitl_setup_adc();
+		printf("Starting SITL replay\n");
+		return;
+	}
+
+	if (desktop_state.replay) {
+		// the FDM capture stands in for the flight simulator
+		sitl_setup_adc();
+		printf("Starting SITL FDM replay\n");
+	} else {
+		rcout_addr.sin_family = AF_INET;
+		rcout_addr.sin_port = htons(RCOUT_PORT + 10*desktop_state.instance);
+		inet_pton(AF_INET, "127.0.0.1", &rcout_addr.sin_addr);
 
-	setup_timer();
-	setup_fdm();
-	sitl_setup_adc();
-	printf("Starting SITL input\n");
+		setup_fdm();
+		if (desktop_state.fdm_shm) {
+			setup_fdm_shm();
+		}
+		if (desktop_state.relnav_shm) {
+			setup_relnav_shm();
+		}
+		sitl_io_start();
+		sitl_setup_adc();
+		printf("Starting SITL input\n");
+	}
 
 	// setup some initial values
 	sitl_update_barometer(desktop_state.initial_height);
 	sitl_update_adc(0, 0, 0, 0, 0, 0, 0, 0, -9.8, 0);
 	sitl_update_compass(0, 0, 0);
 	sitl_update_gps(0, 0, 0, 0, 0, false);
+
+	if (!desktop_state.replay) {
+		setup_timer();
+	}
 }
 
 
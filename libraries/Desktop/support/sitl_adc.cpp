@@ -81,15 +81,8 @@ void sitl_update_adc(float roll, 	float pitch, 	float yaw,		// Relative to earth
 		     double xAccel, 	double yAccel, 	double zAccel,		// Local to plane
 		     float airspeed)
 {
-	static const uint8_t sensor_map[6] = { 1, 2, 0, 4, 5, 6 };
-	static const float _sensor_signs[6] = { 1, -1, -1, 1, -1, -1 };
-	const float accel_offset = 2041;
-	const float gyro_offset = 1658;
-	const float _gyro_gain_x = ToRad(0.4);
 	const float _gyro_gain_y = ToRad(0.41);
-	const float _gyro_gain_z = ToRad(0.41);
 	const float _accel_scale = 9.80665 / 423.8;
-	double adc[7];
 	double p, q, r;
 	extern bool sitl_motors_on;
 
@@ -117,6 +110,31 @@ void sitl_update_adc(float roll, 	float pitch, 	float yaw,		// Relative to earth
 	q += gyro_drift();
 	r += gyro_drift();
 
+	sitl_set_adc(p, q, r, xAccel, yAccel, zAccel, airspeed);
+}
+
+
+/*
+  set the ADC channels from body frame rates in radians/s,
+  accelerations in m/s/s and airspeed in m/s. This is the
+  point where IMU data is captured and replayed
+ */
+void sitl_set_adc(double p, double q, double r,
+		  double xAccel, double yAccel, double zAccel,
+		  float airspeed)
+{
+	static const uint8_t sensor_map[6] = { 1, 2, 0, 4, 5, 6 };
+	static const float _sensor_signs[6] = { 1, -1, -1, 1, -1, -1 };
+	const float accel_offset = 2041;
+	const float gyro_offset = 1658;
+	const float _gyro_gain_x = ToRad(0.4);
+	const float _gyro_gain_y = ToRad(0.41);
+	const float _gyro_gain_z = ToRad(0.41);
+	const float _accel_scale = 9.80665 / 423.8;
+	double adc[7];
+
+	sitl_record_imu(p, q, r, xAccel, yAccel, zAccel, airspeed);
+
 	/* work out the ADC channel values */
 	adc[0] =  (p   / (_gyro_gain_x * _sensor_signs[0])) + gyro_offset;
 	adc[1] =  (q   / (_gyro_gain_y * _sensor_signs[1])) + gyro_offset;
@@ -23,7 +23,6 @@ extern SITL sitl;
  */
 void sitl_update_barometer(float altitude)
 {
-	extern AP_Baro_BMP085_HIL barometer;
 	double Temp, Press, y;
 	static uint32_t last_update;
 
@@ -42,5 +41,17 @@ void sitl_update_barometer(float altitude)
 
 	Press = y + (rand_float() * sitl.baro_noise);
 
-	barometer.setHIL(Temp, Press);
+	sitl_set_barometer(Temp, Press);
+}
+
+/*
+  give the barometer a new temperature and pressure. This is the
+  point where barometer data is captured and replayed
+ */
+void sitl_set_barometer(float temperature, float pressure)
+{
+	extern AP_Baro_BMP085_HIL barometer;
+
+	sitl_record_barometer(temperature, pressure);
+	barometer.setHIL(temperature, pressure);
 }
@@ -66,9 +66,20 @@ static Vector3f heading_to_mag(float roll, float pitch, float yaw)
  */
 void sitl_update_compass(float roll, float pitch, float yaw)
 {
-	extern AP_Compass_HIL compass;
 	Vector3f m = heading_to_mag(ToRad(roll),
 				    ToRad(pitch),
 				    ToRad(yaw));
-	compass.setHIL(m.x, m.y, m.z);
+	sitl_set_compass(m.x, m.y, m.z);
+}
+
+/*
+  give the compass a new body frame field. This is the point where
+  compass data is captured and replayed
+ */
+void sitl_set_compass(float x, float y, float z)
+{
+	extern AP_Compass_HIL compass;
+
+	sitl_record_compass(x, y, z);
+	compass.setHIL(x, y, z);
 }
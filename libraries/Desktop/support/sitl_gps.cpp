@@ -113,6 +113,50 @@ static void gps_send(uint8_t msgid, uint8_t *buf, uint16_t size)
  */
 void sitl_update_gps(double latitude, double longitude, float altitude,
 		     double speedN, double speedE, bool have_lock)
+{
+	struct gps_data d;
+
+	// 5Hz, to match the real UBlox config in APM
+	if (millis() - gps_state.last_update < 200) {
+		return;
+	}
+	gps_state.last_update = millis();
+
+	d.latitude = latitude;
+	d.longitude = longitude;
+	d.altitude = altitude;
+	d.speedN = speedN;
+	d.speedE = speedE;
+	d.have_lock = have_lock;
+
+	// add in some GPS lag
+	gps_data[next_gps_index++] = d;
+	if (next_gps_index >= gps_delay) {
+		next_gps_index = 0;
+	}
+
+	d = gps_data[next_gps_index];
+
+	if (sitl.gps_delay != gps_delay) {
+		// cope with updates to the delay control
+		gps_delay = sitl.gps_delay;
+		for (uint8_t i=0; i<gps_delay; i++) {
+			gps_data[i] = d;
+		}
+	}
+
+	sitl_set_gps(d.latitude, d.longitude, d.altitude,
+		     d.speedN, d.speedE, d.have_lock);
+}
+
+
+/*
+  send a UBLOX position, status, velocity and solution packet for a
+  GPS sample, after any simulated lag. This is the point where GPS
+  data is captured and replayed
+ */
+void sitl_set_gps(double latitude, double longitude, float altitude,
+		  double speedN, double speedE, bool have_lock)
 {
 	struct ubx_nav_posllh {
 		uint32_t	time; // GPS msToW
@@ -168,12 +212,6 @@ void sitl_update_gps(double latitude, double longitude, float altitude,
         const uint8_t MSG_SOL = 0x6;
 	struct gps_data d;
 
-	// 5Hz, to match the real UBlox config in APM
-	if (millis() - gps_state.last_update < 200) {
-		return;
-	}
-	gps_state.last_update = millis();
-
 	d.latitude = latitude;
 	d.longitude = longitude;
 	d.altitude = altitude;
@@ -181,21 +219,7 @@ void sitl_update_gps(double latitude, double longitude, float altitude,
 	d.speedE = speedE;
 	d.have_lock = have_lock;
 
-	// add in some GPS lag
-	gps_data[next_gps_index++] = d;
-	if (next_gps_index >= gps_delay) {
-		next_gps_index = 0;
-	}
-
-	d = gps_data[next_gps_index];
-
-	if (sitl.gps_delay != gps_delay) {
-		// cope with updates to the delay control
-		gps_delay = sitl.gps_delay;
-		for (uint8_t i=0; i<gps_delay; i++) {
-			gps_data[i] = d;
-		}
-	}
+	sitl_record_gps(latitude, longitude, altitude, speedN, speedE, have_lock);
 
 	pos.time = millis(); // FIX
 	pos.longitude = d.longitude * 1.0e7;
@@ -0,0 +1,281 @@
+/*
+  SITL I/O reactor
+
+  One thread waits on every socket and pipe of the simulation with
+  epoll (poll() where epoll is not available) and moves their data to
+  and from sitl_queue queues. The firmware side of the queues is only
+  touched from the main thread and the timer, so the flight code never
+  blocks or makes a system call on the network.
+
+  When replaying a capture no thread is started and sitl_io_run() is
+  called from the main loop instead, so the replay stays deterministic
+ */
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+#include "sitl_io.h"
+
+#define SITL_IO_MAX_WATCH   16
+#define SITL_IO_MAX_SERVICE 4
+
+static struct {
+	int fd;
+	sitl_io_handler fn;
+	void *arg;
+} watches[SITL_IO_MAX_WATCH];
+
+static sitl_io_service services[SITL_IO_MAX_SERVICE];
+static uint8_t num_services;
+
+// guards the watch table, which the main thread adds to
+static pthread_mutex_t watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t io_thread;
+static bool io_threaded;
+
+#ifdef __linux__
+static int epoll_fd = -1;
+#endif
+
+uint32_t sitl_queue_write(struct sitl_queue *q, const uint8_t *data, uint32_t count)
+{
+	uint32_t done = 0;
+	while (done < count) {
+		uint8_t *p;
+		uint32_t n = sitl_queue_write_span(q, &p);
+		if (n == 0) {
+			break;
+		}
+		if (n > count - done) {
+			n = count - done;
+		}
+		memcpy(p, data + done, n);
+		sitl_queue_commit(q, n);
+		done += n;
+	}
+	return done;
+}
+
+uint32_t sitl_queue_read(struct sitl_queue *q, uint8_t *data, uint32_t count)
+{
+	uint32_t done = 0;
+	while (done < count) {
+		const uint8_t *p;
+		uint32_t n = sitl_queue_read_span(q, &p);
+		if (n == 0) {
+			break;
+		}
+		if (n > count - done) {
+			n = count - done;
+		}
+		memcpy(data + done, p, n);
+		sitl_queue_consume(q, n);
+		done += n;
+	}
+	return done;
+}
+
+bool sitl_queue_put_record(struct sitl_queue *q, const void *data, uint16_t len)
+{
+	if (sitl_queue_space(q) < len + sizeof(len)) {
+		return false;
+	}
+	// publish the length and the data together
+	uint32_t head = q->head;
+	const uint8_t *d = (const uint8_t *)&len;
+	for (uint8_t i=0; i<sizeof(len); i++) {
+		q->buf[head++ & (SITL_QUEUE_SIZE-1)] = d[i];
+	}
+	d = (const uint8_t *)data;
+	for (uint16_t i=0; i<len; i++) {
+		q->buf[head++ & (SITL_QUEUE_SIZE-1)] = d[i];
+	}
+	__atomic_store_n(&q->head, head, __ATOMIC_RELEASE);
+	return true;
+}
+
+uint16_t sitl_queue_get_record(struct sitl_queue *q, void *data, uint16_t maxlen)
+{
+	uint16_t len;
+	if (sitl_queue_available(q) < sizeof(len)) {
+		return 0;
+	}
+	uint32_t tail = q->tail;
+	uint8_t *d = (uint8_t *)&len;
+	for (uint8_t i=0; i<sizeof(len); i++) {
+		d[i] = q->buf[tail++ & (SITL_QUEUE_SIZE-1)];
+	}
+	d = (uint8_t *)data;
+	for (uint16_t i=0; i<len; i++) {
+		uint8_t c = q->buf[tail++ & (SITL_QUEUE_SIZE-1)];
+		if (i < maxlen) {
+			d[i] = c;
+		}
+	}
+	__atomic_store_n(&q->tail, tail, __ATOMIC_RELEASE);
+	return len;
+}
+
+/*
+  watch a descriptor for input. Handlers are edge triggered: they must
+  read until the descriptor would block, or remember to try again from
+  their service function
+ */
+bool sitl_io_watch(int fd, sitl_io_handler fn, void *arg)
+{
+	bool ret = false;
+
+	pthread_mutex_lock(&watch_lock);
+	for (uint8_t i=0; i<SITL_IO_MAX_WATCH; i++) {
+		if (watches[i].fn != NULL) {
+			continue;
+		}
+		watches[i].fd = fd;
+		watches[i].arg = arg;
+		watches[i].fn = fn;
+#ifdef __linux__
+		if (epoll_fd == -1) {
+			epoll_fd = epoll_create(SITL_IO_MAX_WATCH);
+		}
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN | EPOLLET;
+		ev.data.u32 = i;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+			// regular files can't be waited on
+			watches[i].fn = NULL;
+			break;
+		}
+#endif
+		ret = true;
+		break;
+	}
+	pthread_mutex_unlock(&watch_lock);
+	return ret;
+}
+
+void sitl_io_unwatch(int fd)
+{
+	pthread_mutex_lock(&watch_lock);
+	for (uint8_t i=0; i<SITL_IO_MAX_WATCH; i++) {
+		if (watches[i].fn != NULL && watches[i].fd == fd) {
+#ifdef __linux__
+			epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+			watches[i].fn = NULL;
+		}
+	}
+	pthread_mutex_unlock(&watch_lock);
+}
+
+/*
+  add a function to run on every pass of the I/O thread, to send what
+  the firmware has queued
+ */
+void sitl_io_add_service(sitl_io_service fn)
+{
+	pthread_mutex_lock(&watch_lock);
+	if (num_services < SITL_IO_MAX_SERVICE) {
+		services[num_services] = fn;
+		__atomic_store_n(&num_services, num_services+1, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&watch_lock);
+}
+
+static void dispatch(uint8_t i)
+{
+	pthread_mutex_lock(&watch_lock);
+	sitl_io_handler fn = watches[i].fn;
+	void *arg = watches[i].arg;
+	pthread_mutex_unlock(&watch_lock);
+	if (fn != NULL) {
+		fn(arg);
+	}
+}
+
+/*
+  wait up to timeout_ms for input, then run the handlers of the ready
+  descriptors and all the services
+ */
+void sitl_io_run(int timeout_ms)
+{
+#ifdef __linux__
+	struct epoll_event events[SITL_IO_MAX_WATCH];
+	int n = -1;
+
+	if (epoll_fd != -1) {
+		n = epoll_wait(epoll_fd, events, SITL_IO_MAX_WATCH, timeout_ms);
+	} else if (timeout_ms > 0) {
+		usleep(timeout_ms*1000);
+	}
+	for (int i=0; i<n; i++) {
+		dispatch(events[i].data.u32);
+	}
+#else
+	struct pollfd fds[SITL_IO_MAX_WATCH];
+	uint8_t idx[SITL_IO_MAX_WATCH];
+	int nfds = 0;
+
+	pthread_mutex_lock(&watch_lock);
+	for (uint8_t i=0; i<SITL_IO_MAX_WATCH; i++) {
+		if (watches[i].fn != NULL) {
+			fds[nfds].fd = watches[i].fd;
+			fds[nfds].events = POLLIN;
+			fds[nfds].revents = 0;
+			idx[nfds++] = i;
+		}
+	}
+	pthread_mutex_unlock(&watch_lock);
+
+	if (poll(fds, nfds, timeout_ms) > 0) {
+		for (int i=0; i<nfds; i++) {
+			if (fds[i].revents) {
+				dispatch(idx[i]);
+			}
+		}
+	}
+#endif
+	uint8_t n_services = __atomic_load_n(&num_services, __ATOMIC_ACQUIRE);
+	for (uint8_t i=0; i<n_services; i++) {
+		services[i]();
+	}
+}
+
+static void *io_main(void *)
+{
+	while (true) {
+		sitl_io_run(1);
+	}
+	return NULL;
+}
+
+/*
+  start the I/O thread. It blocks all signals, so the timer signal is
+  always taken by the main thread
+ */
+void sitl_io_start(void)
+{
+	sigset_t all, old;
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	if (pthread_create(&io_thread, NULL, io_main, NULL) != 0) {
+		fprintf(stderr, "SITL: failed to start I/O thread - %s\n", strerror(errno));
+		exit(1);
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	io_threaded = true;
+}
+
+bool sitl_io_threaded(void)
+{
+	return io_threaded;
+}
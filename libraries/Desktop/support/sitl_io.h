@@ -0,0 +1,98 @@
+/*
+  SITL I/O reactor
+
+  A thread that waits on all the sockets and pipes of the simulation
+  and exchanges their data with the firmware through single producer,
+  single consumer queues, so the main loop and the timer never make a
+  system call to talk to the outside world
+ */
+#ifndef _SITL_IO_H
+#define _SITL_IO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SITL_QUEUE_SIZE 2048 // must be a power of 2
+
+/*
+  the producer only moves head and the consumer only moves tail, so
+  neither side needs a lock. The side that owns an index may read it
+  without a barrier
+ */
+struct sitl_queue {
+	uint32_t head, tail;
+	uint8_t buf[SITL_QUEUE_SIZE];
+};
+
+static inline uint32_t sitl_queue_available(const struct sitl_queue *q)
+{
+	return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+}
+
+static inline uint32_t sitl_queue_space(const struct sitl_queue *q)
+{
+	return SITL_QUEUE_SIZE - sitl_queue_available(q);
+}
+
+/*
+  the contiguous writable space, and the bytes written into it
+ */
+static inline uint32_t sitl_queue_write_span(struct sitl_queue *q, uint8_t **p)
+{
+	uint32_t ofs = q->head & (SITL_QUEUE_SIZE-1);
+	uint32_t n = sitl_queue_space(q);
+	if (n > SITL_QUEUE_SIZE - ofs) {
+		n = SITL_QUEUE_SIZE - ofs;
+	}
+	*p = &q->buf[ofs];
+	return n;
+}
+
+static inline void sitl_queue_commit(struct sitl_queue *q, uint32_t n)
+{
+	__atomic_store_n(&q->head, q->head + n, __ATOMIC_RELEASE);
+}
+
+/*
+  the contiguous readable data, and the bytes taken from it
+ */
+static inline uint32_t sitl_queue_read_span(struct sitl_queue *q, const uint8_t **p)
+{
+	uint32_t ofs = q->tail & (SITL_QUEUE_SIZE-1);
+	uint32_t n = sitl_queue_available(q);
+	if (n > SITL_QUEUE_SIZE - ofs) {
+		n = SITL_QUEUE_SIZE - ofs;
+	}
+	*p = &q->buf[ofs];
+	return n;
+}
+
+static inline void sitl_queue_consume(struct sitl_queue *q, uint32_t n)
+{
+	__atomic_store_n(&q->tail, q->tail + n, __ATOMIC_RELEASE);
+}
+
+uint32_t sitl_queue_write(struct sitl_queue *q, const uint8_t *data, uint32_t count);
+uint32_t sitl_queue_read(struct sitl_queue *q, uint8_t *data, uint32_t count);
+
+/*
+  whole datagrams, each behind a 16 bit length. A record that does not
+  fit is dropped
+ */
+bool sitl_queue_put_record(struct sitl_queue *q, const void *data, uint16_t len);
+uint16_t sitl_queue_get_record(struct sitl_queue *q, void *data, uint16_t maxlen);
+
+// called by the I/O thread when a watched descriptor is readable
+typedef void (*sitl_io_handler)(void *arg);
+
+// called by the I/O thread on every pass, at least once a millisecond
+typedef void (*sitl_io_service)(void);
+
+bool sitl_io_watch(int fd, sitl_io_handler fn, void *arg);
+void sitl_io_unwatch(int fd);
+void sitl_io_add_service(sitl_io_service fn);
+void sitl_io_start(void);
+bool sitl_io_threaded(void);
+void sitl_io_run(int timeout_ms);
+
+#endif // _SITL_IO_H
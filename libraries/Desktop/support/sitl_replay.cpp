@@ -0,0 +1,539 @@
+/*
+  SITL handling
+
+  Capture and replay of sensor data. When recording, every value
+  given to the emulated sensors, the RC inputs and the bytes read
+  from the serial ports are written to a capture file. When
+  replaying, the same values are fed back to the sketch on a virtual
+  clock, with no flight simulator and no waiting, so a recorded
+  flight can be re-run against different parameters in seconds.
+
+  An FDM capture instead holds the packets from the flight simulator.
+  Replaying one runs the sensor emulation on the virtual clock, so a
+  flight can be re-run without the simulator installed.
+
+  The capture format is described in libraries/SITL/SITL.h
+ */
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <wiring.h>
+#include <SITL.h>
+#include <avr/interrupt.h>
+#include "sitl_rc.h"
+#include "desktop.h"
+#include "util.h"
+
+#define REPLAY_SERIAL_PORTS 4
+
+// reads of the clock with nothing moving it, after which the sketch
+// is taken to be spinning until the timer has run
+#define REPLAY_SPIN_READS 10000
+
+extern struct RC_ICR4 ICR4;
+
+static struct {
+	FILE *in;      // capture being replayed
+	FILE *out;     // estimated state output
+	FILE *record;  // capture being written
+	FILE *fdm_record; // FDM capture being written
+
+	// next record from the capture
+	struct sitl_replay_header hdr;
+	uint8_t payload[255];
+	bool have_record;
+
+	// pipes feeding serial ports when replaying
+	int serial_fd[REPLAY_SERIAL_PORTS];
+	int client_fd[REPLAY_SERIAL_PORTS];
+
+	// bytes read from serial ports not yet written when recording
+	uint8_t serial_buf[REPLAY_SERIAL_PORTS][254];
+	uint8_t serial_len[REPLAY_SERIAL_PORTS];
+	uint32_t serial_time[REPLAY_SERIAL_PORTS];
+
+	uint32_t count;
+	struct timeval start_time;
+	uint32_t next_tick; // virtual time of the next timer tick
+	bool in_tick;
+	uint32_t idle_reads; // clock reads since it last moved
+} replay_state;
+
+
+/*
+  write one record to the capture file
+ */
+static void record_write(FILE **f, uint8_t type, uint32_t time_us, const void *data, uint8_t length)
+{
+	struct sitl_replay_header hdr;
+	hdr.time_us = time_us;
+	hdr.type = type;
+	hdr.length = length;
+	if (fwrite(&hdr, sizeof(hdr), 1, *f) != 1 ||
+	    fwrite(data, length, 1, *f) != 1) {
+		fprintf(stderr, "SITL: capture write failed - %s\n", strerror(errno));
+		fclose(*f);
+		*f = NULL;
+	}
+}
+
+/*
+  write out the pending serial bytes for a port
+ */
+static void record_serial_flush(uint8_t port)
+{
+	uint8_t buf[1+sizeof(replay_state.serial_buf[0])];
+	if (replay_state.serial_len[port] == 0) {
+		return;
+	}
+	buf[0] = port;
+	memcpy(&buf[1], replay_state.serial_buf[port], replay_state.serial_len[port]);
+	record_write(&replay_state.record, SITL_REPLAY_SERIAL, replay_state.serial_time[port],
+		     buf, 1+replay_state.serial_len[port]);
+	replay_state.serial_len[port] = 0;
+}
+
+/*
+  add a sensor record, keeping the order of serial data before it
+ */
+static void record_sensor(uint8_t type, const void *data, uint8_t length)
+{
+	if (replay_state.record == NULL) {
+		return;
+	}
+	uint8_t oldSREG = SREG;
+	cli();
+	for (uint8_t i=0; i<REPLAY_SERIAL_PORTS; i++) {
+		record_serial_flush(i);
+	}
+	if (replay_state.record != NULL) {
+		record_write(&replay_state.record, type, micros(), data, length);
+	}
+	SREG = oldSREG;
+}
+
+/*
+  start writing a capture file
+ */
+bool sitl_record_open(const char *path)
+{
+	uint32_t magic = SITL_REPLAY_MAGIC;
+	replay_state.record = fopen(path, "wb");
+	if (replay_state.record == NULL) {
+		fprintf(stderr, "SITL: failed to create %s - %s\n", path, strerror(errno));
+		return false;
+	}
+	record_write(&replay_state.record, SITL_REPLAY_START, 0, &magic, sizeof(magic));
+	printf("Recording sensor data to %s\n", path);
+	return true;
+}
+
+/*
+  start writing an FDM capture
+ */
+bool sitl_fdm_record_open(const char *path)
+{
+	uint32_t magic = SITL_REPLAY_FDM_MAGIC;
+	replay_state.fdm_record = fopen(path, "wb");
+	if (replay_state.fdm_record == NULL) {
+		fprintf(stderr, "SITL: failed to create %s - %s\n", path, strerror(errno));
+		return false;
+	}
+	record_write(&replay_state.fdm_record, SITL_REPLAY_START, 0, &magic, sizeof(magic));
+	printf("Recording FDM packets to %s\n", path);
+	return true;
+}
+
+/*
+  note a state from the flight simulator, called from the timer
+ */
+void sitl_record_fdm(const struct sitl_fdm *fdm)
+{
+	if (replay_state.fdm_record == NULL) {
+		return;
+	}
+	record_write(&replay_state.fdm_record, SITL_REPLAY_FDM, micros(), fdm, SITL_FDM_PACKET_SIZE);
+}
+
+void sitl_record_imu(double p, double q, double r,
+		     double xAccel, double yAccel, double zAccel,
+		     float airspeed)
+{
+	struct sitl_replay_imu pkt;
+	if (replay_state.record == NULL) {
+		return;
+	}
+	pkt.gyro[0] = p;
+	pkt.gyro[1] = q;
+	pkt.gyro[2] = r;
+	pkt.accel[0] = xAccel;
+	pkt.accel[1] = yAccel;
+	pkt.accel[2] = zAccel;
+	pkt.airspeed = airspeed;
+	record_sensor(SITL_REPLAY_IMU, &pkt, sizeof(pkt));
+}
+
+void sitl_record_gps(double latitude, double longitude, float altitude,
+		     double speedN, double speedE, bool have_lock)
+{
+	struct sitl_replay_gps pkt;
+	if (replay_state.record == NULL) {
+		return;
+	}
+	pkt.latitude = latitude;
+	pkt.longitude = longitude;
+	pkt.altitude = altitude;
+	pkt.speedN = speedN;
+	pkt.speedE = speedE;
+	pkt.have_lock = have_lock;
+	record_sensor(SITL_REPLAY_GPS, &pkt, sizeof(pkt));
+}
+
+void sitl_record_barometer(float temperature, float pressure)
+{
+	struct sitl_replay_baro pkt;
+	if (replay_state.record == NULL) {
+		return;
+	}
+	pkt.temperature = temperature;
+	pkt.pressure = pressure;
+	record_sensor(SITL_REPLAY_BARO, &pkt, sizeof(pkt));
+}
+
+void sitl_record_compass(float x, float y, float z)
+{
+	struct sitl_replay_compass pkt;
+	if (replay_state.record == NULL) {
+		return;
+	}
+	pkt.field[0] = x;
+	pkt.field[1] = y;
+	pkt.field[2] = z;
+	record_sensor(SITL_REPLAY_COMPASS, &pkt, sizeof(pkt));
+}
+
+void sitl_record_rc(const uint16_t *pwm)
+{
+	struct sitl_replay_rc pkt;
+	memcpy(pkt.pwm, pwm, sizeof(pkt.pwm));
+	if (replay_state.fdm_record != NULL) {
+		record_write(&replay_state.fdm_record, SITL_REPLAY_RC, micros(), &pkt, sizeof(pkt));
+	}
+	record_sensor(SITL_REPLAY_RC, &pkt, sizeof(pkt));
+}
+
+/*
+  note a byte the sketch read from a serial port
+ */
+void sitl_record_serial(uint8_t serial_port, uint8_t c)
+{
+	if (replay_state.record == NULL || serial_port >= REPLAY_SERIAL_PORTS) {
+		return;
+	}
+	uint8_t oldSREG = SREG;
+	cli();
+	if (replay_state.serial_len[serial_port] == 0) {
+		replay_state.serial_time[serial_port] = micros();
+	}
+	replay_state.serial_buf[serial_port][replay_state.serial_len[serial_port]++] = c;
+	if (replay_state.serial_len[serial_port] == sizeof(replay_state.serial_buf[0])) {
+		record_serial_flush(serial_port);
+	}
+	SREG = oldSREG;
+}
+
+/*
+  write out any buffered data, called once per timer tick
+ */
+void sitl_record_flush(void)
+{
+	if (replay_state.fdm_record != NULL) {
+		fflush(replay_state.fdm_record);
+	}
+	if (replay_state.record == NULL) {
+		return;
+	}
+	for (uint8_t i=0; i<REPLAY_SERIAL_PORTS; i++) {
+		record_serial_flush(i);
+	}
+	fflush(replay_state.record);
+}
+
+
+/*
+  start replaying a capture file, of either kind
+ */
+bool sitl_replay_open(const char *path)
+{
+	struct sitl_replay_header hdr;
+	uint32_t magic;
+
+	replay_state.in = fopen(path, "rb");
+	if (replay_state.in == NULL) {
+		fprintf(stderr, "SITL: failed to open %s - %s\n", path, strerror(errno));
+		return false;
+	}
+	if (fread(&hdr, sizeof(hdr), 1, replay_state.in) != 1 ||
+	    hdr.type != SITL_REPLAY_START || hdr.length != sizeof(magic) ||
+	    fread(&magic, sizeof(magic), 1, replay_state.in) != 1 ||
+	    (magic != SITL_REPLAY_MAGIC && magic != SITL_REPLAY_FDM_MAGIC)) {
+		fprintf(stderr, "SITL: %s is not a capture file\n", path);
+		fclose(replay_state.in);
+		replay_state.in = NULL;
+		return false;
+	}
+	desktop_state.replay = true;
+	desktop_state.replay_fdm = (magic == SITL_REPLAY_FDM_MAGIC);
+	desktop_state.replay_micros = 0;
+	replay_state.next_tick = 1000;
+	gettimeofday(&replay_state.start_time, NULL);
+	if (replay_state.out == NULL) {
+		replay_state.out = stdout;
+	}
+	return true;
+}
+
+/*
+  set the file for the estimated state output
+ */
+bool sitl_replay_output_open(const char *path)
+{
+	replay_state.out = fopen(path, "w");
+	if (replay_state.out == NULL) {
+		fprintf(stderr, "SITL: failed to create %s - %s\n", path, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+FILE *sitl_replay_output(void)
+{
+	if (!desktop_state.replay) {
+		return NULL;
+	}
+	return replay_state.out;
+}
+
+/*
+  capture and replay of the Rel NAV serial stream on its own, as text
+  lines in the form of the DataFlash log dump. The sketch does the
+  reading and writing
+ */
+static FILE *stream_capture;
+static FILE *stream_replay;
+static float stream_replay_speed;
+
+bool sitl_stream_capture_open(const char *path)
+{
+	stream_capture = fopen(path, "w");
+	if (stream_capture == NULL) {
+		fprintf(stderr, "SITL: failed to create %s - %s\n", path, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/*
+  arg is FILE or FILE:SPEED
+ */
+bool sitl_stream_replay_open(const char *arg)
+{
+	char path[256];
+	const char *colon = strrchr(arg, ':');
+
+	stream_replay_speed = 1;
+	if (colon != NULL) {
+		stream_replay_speed = atof(colon+1);
+		snprintf(path, sizeof(path), "%.*s", (int)(colon - arg), arg);
+	} else {
+		snprintf(path, sizeof(path), "%s", arg);
+	}
+	stream_replay = fopen(path, "r");
+	if (stream_replay == NULL) {
+		fprintf(stderr, "SITL: failed to open %s - %s\n", path, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+FILE *sitl_stream_capture(void)
+{
+	return stream_capture;
+}
+
+FILE *sitl_stream_replay(float *speed)
+{
+	if (speed != NULL) {
+		*speed = stream_replay_speed;
+	}
+	return stream_replay;
+}
+
+/*
+  return a pipe to use for a serial port when replaying
+ */
+int sitl_replay_serial_pipe(uint8_t serial_port)
+{
+	int fd[2];
+	if (replay_state.client_fd[serial_port] != 0) {
+		return replay_state.client_fd[serial_port];
+	}
+	pipe(fd);
+	replay_state.serial_fd[serial_port] = fd[1];
+	replay_state.client_fd[serial_port] = fd[0];
+	set_nonblocking(fd[0]);
+	set_nonblocking(fd[1]);
+	return fd[0];
+}
+
+/*
+  the end of the capture has been reached
+ */
+static void replay_finish(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	float elapsed = (tv.tv_sec - replay_state.start_time.tv_sec) +
+		(tv.tv_usec - replay_state.start_time.tv_usec)*1.0e-6;
+	float simulated = desktop_state.replay_micros * 1.0e-6;
+
+	fflush(replay_state.out);
+	fprintf(stderr, "Replayed %u records, %.1f seconds in %.2f seconds (%.0fx)\n",
+		(unsigned)replay_state.count, simulated, elapsed,
+		elapsed > 0 ? simulated/elapsed : 0);
+	exit(0);
+}
+
+/*
+  give the sketch one record from the capture file
+ */
+static void replay_apply(const struct sitl_replay_header *hdr, const uint8_t *payload)
+{
+	switch (hdr->type) {
+	case SITL_REPLAY_IMU: {
+		const struct sitl_replay_imu *pkt = (const struct sitl_replay_imu *)payload;
+		sitl_set_adc(pkt->gyro[0], pkt->gyro[1], pkt->gyro[2],
+			     pkt->accel[0], pkt->accel[1], pkt->accel[2],
+			     pkt->airspeed);
+		break;
+	}
+
+	case SITL_REPLAY_GPS: {
+		const struct sitl_replay_gps *pkt = (const struct sitl_replay_gps *)payload;
+		sitl_set_gps(pkt->latitude, pkt->longitude, pkt->altitude,
+			     pkt->speedN, pkt->speedE, pkt->have_lock);
+		break;
+	}
+
+	case SITL_REPLAY_BARO: {
+		const struct sitl_replay_baro *pkt = (const struct sitl_replay_baro *)payload;
+		sitl_set_barometer(pkt->temperature, pkt->pressure);
+		break;
+	}
+
+	case SITL_REPLAY_COMPASS: {
+		const struct sitl_replay_compass *pkt = (const struct sitl_replay_compass *)payload;
+		sitl_set_compass(pkt->field[0], pkt->field[1], pkt->field[2]);
+		break;
+	}
+
+	case SITL_REPLAY_RC: {
+		const struct sitl_replay_rc *pkt = (const struct sitl_replay_rc *)payload;
+		for (uint8_t i=0; i<8; i++) {
+			if (pkt->pwm[i] != 0) {
+				ICR4.set(i, pkt->pwm[i]);
+			}
+		}
+		break;
+	}
+
+	case SITL_REPLAY_FDM:
+		if (hdr->length >= SITL_FDM_PACKET_SIZE) {
+			struct sitl_fdm fdm;
+			memcpy(&fdm, payload, SITL_FDM_PACKET_SIZE);
+			sitl_fdm_state(&fdm);
+		}
+		break;
+
+	case SITL_REPLAY_SERIAL: {
+		uint8_t port = payload[0];
+		if (port < REPLAY_SERIAL_PORTS && replay_state.serial_fd[port] != 0) {
+			write(replay_state.serial_fd[port], &payload[1], hdr->length-1);
+		}
+		break;
+	}
+
+	default:
+		// skip record types we don't know about
+		break;
+	}
+	replay_state.count++;
+}
+
+/*
+  give the sketch all records up to the given virtual time, then run
+  the 1kHz timer. For an FDM capture the timer also runs the sensor
+  emulation
+ */
+static void replay_tick(uint32_t tick_micros)
+{
+	while (true) {
+		if (!replay_state.have_record) {
+			if (fread(&replay_state.hdr, sizeof(replay_state.hdr), 1, replay_state.in) != 1 ||
+			    (replay_state.hdr.length > 0 &&
+			     fread(replay_state.payload, replay_state.hdr.length, 1, replay_state.in) != 1)) {
+				replay_finish();
+			}
+			replay_state.have_record = true;
+		}
+		if ((int32_t)(replay_state.hdr.time_us - tick_micros) > 0) {
+			break;
+		}
+		replay_apply(&replay_state.hdr, replay_state.payload);
+		replay_state.have_record = false;
+	}
+
+	sitl_replay_timer();
+}
+
+/*
+  move the virtual clock forward, running the timer for each
+  millisecond passed. The timer runs with the clock at its tick, after
+  the records up to then have been given to the sketch
+ */
+void sitl_replay_advance(uint32_t usec)
+{
+	uint32_t target = desktop_state.replay_micros + usec;
+
+	replay_state.idle_reads = 0;
+	if (replay_state.in_tick) {
+		// a timer process is delaying
+		desktop_state.replay_micros = target;
+		return;
+	}
+	replay_state.in_tick = true;
+	while ((int32_t)(target - replay_state.next_tick) >= 0) {
+		desktop_state.replay_micros = replay_state.next_tick;
+		replay_tick(replay_state.next_tick);
+		replay_state.next_tick += 1000;
+	}
+	desktop_state.replay_micros = target;
+	replay_state.in_tick = false;
+}
+
+/*
+  the virtual time, for millis() and micros(). Reading the clock does
+  not move it, so a replay doesn't depend on how often the sketch looks
+  at the time. Only a sketch that keeps reading it with nothing else
+  moving it, busy-waiting for the timer, is moved on to the next tick
+ */
+uint32_t sitl_replay_micros(void)
+{
+	if (!replay_state.in_tick && ++replay_state.idle_reads >= REPLAY_SPIN_READS) {
+		sitl_replay_advance(replay_state.next_tick - desktop_state.replay_micros);
+	}
+	return desktop_state.replay_micros;
+}
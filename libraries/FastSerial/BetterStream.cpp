@@ -65,3 +65,18 @@ BetterStream::txspace(void)
         // by default claim that there is always space in transmit buffer
         return(INT_MAX);
 }
+
+uint16_t
+BetterStream::read_bytes(uint8_t *buffer, uint16_t count)
+{
+        // by default fall back to reading a byte at a time
+        uint16_t n = 0;
+
+        while (n < count && available() > 0) {
+                int c = read();
+                if (c == -1)
+                        break;
+                buffer[n++] = c;
+        }
+        return(n);
+}
@@ -30,6 +30,7 @@ public:
         void            vprintf_P(const prog_char_t *, va_list);
 
         virtual int     txspace(void);
+        virtual uint16_t read_bytes(uint8_t *buffer, uint16_t count);
 
 #define printf_P(fmt, ...) _printf_P((const prog_char_t *)fmt, ## __VA_ARGS__)
 
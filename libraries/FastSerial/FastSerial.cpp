@@ -31,6 +31,7 @@
 
 //#include "../AP_Common/AP_Common.h"
 #include "FastSerial.h"
+#include <string.h>
 
 #if defined(ARDUINO) && ARDUINO >= 100
 	#include "Arduino.h"
@@ -182,6 +183,35 @@ int FastSerial::read(void)
 	return (c);
 }
 
+uint16_t FastSerial::read_bytes(uint8_t *buffer, uint16_t count)
+{
+	uint16_t head, tail, n, span;
+
+	if (!_open)
+		return 0;
+
+	// the interrupt handler only moves the head, so take one snapshot
+	// of it and copy out at most two contiguous spans
+	head = _rxBuffer->head;
+	tail = _rxBuffer->tail;
+	n = (head - tail) & _rxBuffer->mask;
+	if (n > count)
+		n = count;
+	if (n == 0)
+		return 0;
+
+	span = (_rxBuffer->mask + 1) - tail;
+	if (span > n)
+		span = n;
+	memcpy(buffer, &_rxBuffer->bytes[tail], span);
+	if (n > span)
+		memcpy(buffer + span, &_rxBuffer->bytes[0], n - span);
+
+	_rxBuffer->tail = (tail + n) & _rxBuffer->mask;
+
+	return n;
+}
+
 int FastSerial::peek(void)
 {
 
@@ -146,6 +146,17 @@ public:
 	///
 	virtual void begin(long baud, unsigned int rxSpace, unsigned int txSpace);
 
+	/// Bulk read from the receive buffer
+	///
+	/// Copies up to count bytes that have already been received into the
+	/// caller's buffer, moving the tail once rather than per byte.
+	///
+	/// @param	buffer		Where the received bytes are stored.
+	/// @param	count		Maximum number of bytes to read.
+	/// @returns			The number of bytes read, which may be zero.
+	///
+	virtual uint16_t read_bytes(uint8_t *buffer, uint16_t count);
+
 	/// Transmit/receive buffer descriptor.
 	///
 	/// Public so the interrupt handlers can see it
@@ -103,12 +103,19 @@ float DerivativeFilter<T,FILTER_SIZE>::slope(void)
     return result;
 }
 
-// reset - clear all samples
+// reset - clear all samples and their timestamps
 template <class T, uint8_t FILTER_SIZE>
 void DerivativeFilter<T,FILTER_SIZE>::reset(void)
 {
-    // call parent's apply function to get the sample into the array
+    // call parent's reset function to clear the samples
     FilterWithBuffer<T,FILTER_SIZE>::reset();
+
+    // and forget the timestamps, so the filter behaves as if new
+    for (uint8_t i=0; i<FILTER_SIZE; i++) {
+        _timestamps[i] = 0;
+    }
+    _new_data = false;
+    _last_slope = 0;
 }
 
 // add new instances as needed here
@@ -0,0 +1,93 @@
+/*
+ *       Check that DerivativeFilter forgets its samples on reset(), and
+ *       gives the same slopes as a newly constructed filter.
+ */
+
+#include <FastSerial.h>
+#include <AP_Common.h>
+#include <AP_Math.h>
+#include <Filter.h>
+#include <DerivativeFilter.h>
+#include <AP_Buffer.h>
+
+#ifdef DESKTOP_BUILD
+// all of this is needed to build with SITL
+ #include <DataFlash.h>
+ #include <APM_RC.h>
+ #include <GCS_MAVLink.h>
+ #include <Arduino_Mega_ISR_Registry.h>
+ #include <AP_PeriodicProcess.h>
+ #include <AP_ADC.h>
+ #include <AP_Baro.h>
+ #include <AP_Compass.h>
+ #include <AP_GPS.h>
+ #include <Filter.h>
+ #include <SITL.h>
+ #include <I2C.h>
+ #include <SPI.h>
+ #include <AP_Declination.h>
+ #include <AP_Semaphore.h>
+Arduino_Mega_ISR_Registry isr_registry;
+AP_Baro_BMP085_HIL barometer;
+AP_Compass_HIL compass;
+SITL sitl;
+#endif
+
+FastSerialPort0(Serial);        // FTDI/console
+
+DerivativeFilter<float,7> derivative;
+DerivativeFilter<float,7> fresh;
+
+static uint8_t failures;
+
+static void check(const char *what, float slope, float expected)
+{
+    bool ok = fabs(slope - expected) < 1.0e-3;
+    if (!ok) {
+        failures++;
+    }
+    Serial.printf("%-36s %10.4f %s\n", what, slope, ok ? "OK" : "FAILED");
+}
+
+// feed n samples of a ramp rising by 2 per 1000 time units, also to
+// the never used filter once the other one has been reset
+static void ramp(uint32_t t0, float v0, uint8_t n, bool both)
+{
+    for (uint8_t i=0; i<n; i++) {
+        derivative.update(v0 + 2*i, t0 + 1000*(uint32_t)i);
+        if (both) {
+            fresh.update(v0 + 2*i, t0 + 1000*(uint32_t)i);
+        }
+    }
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    Serial.println("DerivativeFilter reset test");
+
+    check("empty filter", derivative.slope(), 0);
+
+    ramp(1000, 0, 7, false);
+    check("full buffer", derivative.slope() * 1000, 2);
+
+    // after a reset the old samples and their timestamps must not
+    // take part, so the filter gives the same slopes as a new one
+    derivative.reset();
+    check("right after reset", derivative.slope(), 0);
+
+    ramp(500000, 5000, 1, true);
+    check("one sample after reset", derivative.slope(), fresh.slope());
+
+    ramp(501000, 5002, 5, true);
+    check("six samples after reset", derivative.slope(), fresh.slope());
+
+    ramp(506000, 5012, 1, true);
+    check("full again after reset", derivative.slope() * 1000, 2);
+
+    Serial.printf("%u failures\n", (unsigned)failures);
+}
+
+void loop()
+{
+}
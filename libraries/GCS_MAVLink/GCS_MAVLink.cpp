@@ -34,6 +34,57 @@ uint8_t mavlink_check_target(uint8_t sysid, uint8_t compid)
     return 0; // no error
 }
 
+/*
+  parse a block of received bytes. Bytes between frames are skipped
+  with a search for the next start byte, and the payload of a frame
+  is copied and checksummed as one span. The header and checksum
+  bytes still go through mavlink_parse_char() so the parse state,
+  length check and CRC_EXTRA handling stay in one place.
+
+  Parsing stops after the first complete message, with
+  status->msg_received set, so the caller can handle it before
+  continuing with the rest of the buffer.
+ */
+uint16_t mavlink_parse_buffer(mavlink_channel_t chan, const uint8_t *buf, uint16_t len,
+                              mavlink_message_t *msg, mavlink_status_t *status)
+{
+    mavlink_message_t *rxmsg = mavlink_get_channel_buffer(chan);
+    mavlink_status_t *rxstatus = mavlink_get_channel_status(chan);
+    uint16_t i = 0;
+
+    status->msg_received = 0;
+    while (i < len) {
+        if (rxstatus->parse_state == MAVLINK_PARSE_STATE_UNINIT ||
+            rxstatus->parse_state == MAVLINK_PARSE_STATE_IDLE) {
+            // skip to the next start of frame
+            const uint8_t *stx = (const uint8_t *)memchr(&buf[i], MAVLINK_STX, len - i);
+            if (stx == NULL) {
+                return len;
+            }
+            i = stx - buf;
+        } else if (rxstatus->parse_state == MAVLINK_PARSE_STATE_GOT_MSGID) {
+            // take as much of the payload as we have in one go
+            uint16_t n = rxmsg->len - rxstatus->packet_idx;
+            if (n > len - i) {
+                n = len - i;
+            }
+            memcpy(&_MAV_PAYLOAD_NON_CONST(rxmsg)[rxstatus->packet_idx], &buf[i], n);
+            crc_accumulate_buffer(&rxmsg->checksum, (const char *)&buf[i], n);
+            rxstatus->packet_idx += n;
+            if (rxstatus->packet_idx == rxmsg->len) {
+                rxstatus->parse_state = MAVLINK_PARSE_STATE_GOT_PAYLOAD;
+            }
+            i += n;
+            continue;
+        }
+        if (mavlink_parse_char(chan, buf[i++], msg, status)) {
+            status->msg_received = 1;
+            break;
+        }
+    }
+    return i;
+}
+
 // return a MAVLink variable type given a AP_Param type
 uint8_t mav_var_type(enum ap_var_type t)
 {
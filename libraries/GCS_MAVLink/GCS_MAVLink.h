@@ -72,6 +72,30 @@ static inline uint8_t comm_receive_ch(mavlink_channel_t chan)
     return data;
 }
 
+/// Read a block of bytes from the nominated MAVLink channel
+///
+/// @param chan		Channel to receive on
+/// @param buf		Buffer to receive into
+/// @param len		Size of the buffer
+/// @returns		Number of bytes read
+///
+static inline uint16_t comm_receive_buffer(mavlink_channel_t chan, uint8_t *buf, uint16_t len)
+{
+    uint16_t bytes = 0;
+
+    switch(chan) {
+	case MAVLINK_COMM_0:
+		bytes = mavlink_comm_0_port->read_bytes(buf, len);
+		break;
+	case MAVLINK_COMM_1:
+		bytes = mavlink_comm_1_port->read_bytes(buf, len);
+		break;
+	default:
+		break;
+	}
+    return bytes;
+}
+
 /// Check for available data on the nominated MAVLink channel
 ///
 /// @param chan		Channel to check
@@ -121,6 +145,11 @@ static inline uint16_t comm_get_txspace(mavlink_channel_t chan)
 
 uint8_t mavlink_check_target(uint8_t sysid, uint8_t compid);
 
+// parse a block of received bytes, stopping after the first complete
+// message. Returns the number of bytes consumed
+uint16_t mavlink_parse_buffer(mavlink_channel_t chan, const uint8_t *buf, uint16_t len,
+                              mavlink_message_t *msg, mavlink_status_t *status);
+
 // return a MAVLink variable type given a AP_Param type
 uint8_t mav_var_type(enum ap_var_type t);
 
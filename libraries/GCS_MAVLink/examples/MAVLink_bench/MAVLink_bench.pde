@@ -0,0 +1,145 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Checks the table driven X.25 CRC against the bitwise update, and
+// measures MAVLink encode and parse throughput in messages/second
+//
+
+#include <FastSerial.h>
+#include <AP_Common.h>
+#include <GCS_MAVLink.h>
+#include <include/mavlink/v1.0/checksum.h>
+
+FastSerialPort0(Serial);
+
+// number of messages in the test stream
+#define NUM_MESSAGES    16
+
+// number of times each test is repeated
+#define NUM_PASSES      50
+
+// bytes handed to mavlink_parse_buffer() at a time, as in the
+// ArduPlane GCS receive path
+#define BLOCK_SIZE      32
+
+static uint8_t stream[NUM_MESSAGES * (MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_ATTITUDE_LEN)];
+static uint16_t stream_len;
+
+// the original bitwise X.25 update
+static uint16_t crc_reference(const uint8_t *buf, uint16_t len)
+{
+    uint16_t crc = X25_INIT_CRC;
+    while (len--) {
+        uint8_t tmp = *buf++ ^ (uint8_t)(crc & 0xff);
+        tmp ^= (tmp<<4);
+        crc = (crc>>8) ^ (tmp<<8) ^ (tmp<<3) ^ (tmp>>4);
+    }
+    return crc;
+}
+
+static void report(const char *name, uint16_t messages, uint32_t usec)
+{
+    Serial.printf_P(PSTR("%-16s %6lu msgs/s  (%u usec/msg)\n"),
+                    name,
+                    (unsigned long)(messages * 1.0e6 / usec),
+                    (unsigned)(usec / messages));
+}
+
+static void test_crc(void)
+{
+    uint8_t buf[64];
+    bool passed = true;
+
+    for (uint16_t n=0; n<200; n++) {
+        for (uint8_t i=0; i<sizeof(buf); i++) {
+            buf[i] = (uint8_t)(n*31 + i*7 + (i>>2));
+        }
+        uint16_t len = 1 + (n % sizeof(buf));
+        if (crc_calculate(buf, len) != crc_reference(buf, len)) {
+            passed = false;
+        }
+    }
+    Serial.printf_P(PSTR("CRC check: %s\n"), passed ? "PASS" : "FAIL");
+}
+
+static void test_encode(void)
+{
+    mavlink_message_t msg;
+    uint32_t start_time;
+
+    start_time = micros();
+    for (uint16_t n=0; n<NUM_PASSES; n++) {
+        stream_len = 0;
+        for (uint8_t i=0; i<NUM_MESSAGES; i++) {
+            mavlink_msg_attitude_pack(1, 1, &msg,
+                                      n*NUM_MESSAGES+i, 0.1*i, -0.2*i, 3.0,
+                                      0.01, 0.02, 0.03);
+            stream_len += mavlink_msg_to_send_buffer(&stream[stream_len], &msg);
+        }
+    }
+    report("encode", NUM_PASSES*NUM_MESSAGES, micros() - start_time);
+}
+
+static void test_parse_char(void)
+{
+    mavlink_message_t msg;
+    mavlink_status_t status;
+    uint16_t count = 0;
+    uint32_t start_time;
+
+    start_time = micros();
+    for (uint16_t n=0; n<NUM_PASSES; n++) {
+        for (uint16_t i=0; i<stream_len; i++) {
+            if (mavlink_parse_char(MAVLINK_COMM_0, stream[i], &msg, &status)) {
+                count++;
+            }
+        }
+    }
+    report("parse_char", count, micros() - start_time);
+    if (count != NUM_PASSES*NUM_MESSAGES) {
+        Serial.printf_P(PSTR("parse_char: received %u of %u\n"),
+                        count, NUM_PASSES*NUM_MESSAGES);
+    }
+}
+
+static void test_parse_buffer(void)
+{
+    mavlink_message_t msg;
+    mavlink_status_t status;
+    uint16_t count = 0;
+    uint32_t start_time;
+
+    start_time = micros();
+    for (uint16_t n=0; n<NUM_PASSES; n++) {
+        for (uint16_t i=0; i<stream_len; i+=BLOCK_SIZE) {
+            uint16_t len = min(BLOCK_SIZE, stream_len - i);
+            uint16_t ofs = 0;
+            while (ofs < len) {
+                ofs += mavlink_parse_buffer(MAVLINK_COMM_1, &stream[i+ofs], len-ofs, &msg, &status);
+                if (status.msg_received) {
+                    count++;
+                }
+            }
+        }
+    }
+    report("parse_buffer", count, micros() - start_time);
+    if (count != NUM_PASSES*NUM_MESSAGES) {
+        Serial.printf_P(PSTR("parse_buffer: received %u of %u\n"),
+                        count, NUM_PASSES*NUM_MESSAGES);
+    }
+}
+
+void setup(void)
+{
+    Serial.begin(115200);
+    Serial.printf_P(PSTR("MAVLink benchmark, %s CRC\n"),
+                    MAVLINK_CRC_TABLE ? "table" : "bitwise");
+
+    test_crc();
+    test_encode();
+    test_parse_char();
+    test_parse_buffer();
+}
+
+void loop(void)
+{
+}
@@ -0,0 +1,251 @@
+// MESSAGE FORMATION PACKING
+
+#define MAVLINK_MSG_ID_FORMATION 170
+
+typedef struct __mavlink_formation_t
+{
+ float x[5]; ///< Forward offset of each slot from the leader in the formation frame, meters (negative is behind)
+ float y[5]; ///< Right offset of each slot from the leader in the formation frame, meters
+ float z[5]; ///< Down offset of each slot from the leader in the formation frame, meters
+ uint8_t target_system; ///< System ID, 0 for all aircraft
+ uint8_t target_component; ///< Component ID
+ uint8_t sysid[5]; ///< System ID of the aircraft flying each slot, 0 for an empty slot
+} mavlink_formation_t;
+
+#define MAVLINK_MSG_ID_FORMATION_LEN 67
+#define MAVLINK_MSG_ID_170_LEN 67
+
+#define MAVLINK_MSG_FORMATION_FIELD_X_LEN 5
+#define MAVLINK_MSG_FORMATION_FIELD_Y_LEN 5
+#define MAVLINK_MSG_FORMATION_FIELD_Z_LEN 5
+#define MAVLINK_MSG_FORMATION_FIELD_SYSID_LEN 5
+
+#define MAVLINK_MESSAGE_INFO_FORMATION { \
+	"FORMATION", \
+	6, \
+	{  { "x", NULL, MAVLINK_TYPE_FLOAT, 5, 0, offsetof(mavlink_formation_t, x) }, \
+         { "y", NULL, MAVLINK_TYPE_FLOAT, 5, 20, offsetof(mavlink_formation_t, y) }, \
+         { "z", NULL, MAVLINK_TYPE_FLOAT, 5, 40, offsetof(mavlink_formation_t, z) }, \
+         { "target_system", NULL, MAVLINK_TYPE_UINT8_T, 0, 60, offsetof(mavlink_formation_t, target_system) }, \
+         { "target_component", NULL, MAVLINK_TYPE_UINT8_T, 0, 61, offsetof(mavlink_formation_t, target_component) }, \
+         { "sysid", NULL, MAVLINK_TYPE_UINT8_T, 5, 62, offsetof(mavlink_formation_t, sysid) }, \
+         } \
+}
+
+
+/**
+ * @brief Pack a formation message
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param msg The MAVLink message to compress the data into
+ *
+ * @param target_system System ID, 0 for all aircraft
+ * @param target_component Component ID
+ * @param sysid System ID of the aircraft flying each slot, 0 for an empty slot
+ * @param x Forward offset of each slot from the leader in the formation frame, meters (negative is behind)
+ * @param y Right offset of each slot from the leader in the formation frame, meters
+ * @param z Down offset of each slot from the leader in the formation frame, meters
+ * @return length of the message in bytes (excluding serial stream start sign)
+ */
+static inline uint16_t mavlink_msg_formation_pack(uint8_t system_id, uint8_t component_id, mavlink_message_t* msg,
+						       uint8_t target_system, uint8_t target_component, const uint8_t *sysid, const float *x, const float *y, const float *z)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[67];
+	_mav_put_uint8_t(buf, 60, target_system);
+	_mav_put_uint8_t(buf, 61, target_component);
+	_mav_put_float_array(buf, 0, x, 5);
+	_mav_put_float_array(buf, 20, y, 5);
+	_mav_put_float_array(buf, 40, z, 5);
+	_mav_put_uint8_t_array(buf, 62, sysid, 5);
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), buf, 67);
+#else
+	mavlink_formation_t packet;
+	packet.target_system = target_system;
+	packet.target_component = target_component;
+	mav_array_memcpy(packet.x, x, sizeof(float)*5);
+	mav_array_memcpy(packet.y, y, sizeof(float)*5);
+	mav_array_memcpy(packet.z, z, sizeof(float)*5);
+	mav_array_memcpy(packet.sysid, sysid, sizeof(uint8_t)*5);
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), &packet, 67);
+#endif
+
+	msg->msgid = MAVLINK_MSG_ID_FORMATION;
+	return mavlink_finalize_message(msg, system_id, component_id, 67, 107);
+}
+
+/**
+ * @brief Pack a formation message on a channel
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param chan The MAVLink channel this message was sent over
+ * @param msg The MAVLink message to compress the data into
+ * @param target_system System ID, 0 for all aircraft
+ * @param target_component Component ID
+ * @param sysid System ID of the aircraft flying each slot, 0 for an empty slot
+ * @param x Forward offset of each slot from the leader in the formation frame, meters (negative is behind)
+ * @param y Right offset of each slot from the leader in the formation frame, meters
+ * @param z Down offset of each slot from the leader in the formation frame, meters
+ * @return length of the message in bytes (excluding serial stream start sign)
+ */
+static inline uint16_t mavlink_msg_formation_pack_chan(uint8_t system_id, uint8_t component_id, uint8_t chan,
+							   mavlink_message_t* msg,
+						           uint8_t target_system,uint8_t target_component,const uint8_t *sysid,const float *x,const float *y,const float *z)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[67];
+	_mav_put_uint8_t(buf, 60, target_system);
+	_mav_put_uint8_t(buf, 61, target_component);
+	_mav_put_float_array(buf, 0, x, 5);
+	_mav_put_float_array(buf, 20, y, 5);
+	_mav_put_float_array(buf, 40, z, 5);
+	_mav_put_uint8_t_array(buf, 62, sysid, 5);
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), buf, 67);
+#else
+	mavlink_formation_t packet;
+	packet.target_system = target_system;
+	packet.target_component = target_component;
+	mav_array_memcpy(packet.x, x, sizeof(float)*5);
+	mav_array_memcpy(packet.y, y, sizeof(float)*5);
+	mav_array_memcpy(packet.z, z, sizeof(float)*5);
+	mav_array_memcpy(packet.sysid, sysid, sizeof(uint8_t)*5);
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), &packet, 67);
+#endif
+
+	msg->msgid = MAVLINK_MSG_ID_FORMATION;
+	return mavlink_finalize_message_chan(msg, system_id, component_id, chan, 67, 107);
+}
+
+/**
+ * @brief Encode a formation struct into a message
+ *
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param msg The MAVLink message to compress the data into
+ * @param formation C-struct to read the message contents from
+ */
+static inline uint16_t mavlink_msg_formation_encode(uint8_t system_id, uint8_t component_id, mavlink_message_t* msg, const mavlink_formation_t* formation)
+{
+	return mavlink_msg_formation_pack(system_id, component_id, msg, formation->target_system, formation->target_component, formation->sysid, formation->x, formation->y, formation->z);
+}
+
+/**
+ * @brief Send a formation message
+ * @param chan MAVLink channel to send the message
+ *
+ * @param target_system System ID, 0 for all aircraft
+ * @param target_component Component ID
+ * @param sysid System ID of the aircraft flying each slot, 0 for an empty slot
+ * @param x Forward offset of each slot from the leader in the formation frame, meters (negative is behind)
+ * @param y Right offset of each slot from the leader in the formation frame, meters
+ * @param z Down offset of each slot from the leader in the formation frame, meters
+ */
+#ifdef MAVLINK_USE_CONVENIENCE_FUNCTIONS
+
+static inline void mavlink_msg_formation_send(mavlink_channel_t chan, uint8_t target_system, uint8_t target_component, const uint8_t *sysid, const float *x, const float *y, const float *z)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[67];
+	_mav_put_uint8_t(buf, 60, target_system);
+	_mav_put_uint8_t(buf, 61, target_component);
+	_mav_put_float_array(buf, 0, x, 5);
+	_mav_put_float_array(buf, 20, y, 5);
+	_mav_put_float_array(buf, 40, z, 5);
+	_mav_put_uint8_t_array(buf, 62, sysid, 5);
+	_mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_FORMATION, buf, 67, 107);
+#else
+	mavlink_formation_t packet;
+	packet.target_system = target_system;
+	packet.target_component = target_component;
+	mav_array_memcpy(packet.x, x, sizeof(float)*5);
+	mav_array_memcpy(packet.y, y, sizeof(float)*5);
+	mav_array_memcpy(packet.z, z, sizeof(float)*5);
+	mav_array_memcpy(packet.sysid, sysid, sizeof(uint8_t)*5);
+	_mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_FORMATION, (const char *)&packet, 67, 107);
+#endif
+}
+
+#endif
+
+// MESSAGE FORMATION UNPACKING
+
+
+/**
+ * @brief Get field target_system from formation message
+ *
+ * @return System ID, 0 for all aircraft
+ */
+static inline uint8_t mavlink_msg_formation_get_target_system(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint8_t(msg,  60);
+}
+
+/**
+ * @brief Get field target_component from formation message
+ *
+ * @return Component ID
+ */
+static inline uint8_t mavlink_msg_formation_get_target_component(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint8_t(msg,  61);
+}
+
+/**
+ * @brief Get field sysid from formation message
+ *
+ * @return System ID of the aircraft flying each slot, 0 for an empty slot
+ */
+static inline uint16_t mavlink_msg_formation_get_sysid(const mavlink_message_t* msg, uint8_t *sysid)
+{
+	return _MAV_RETURN_uint8_t_array(msg, sysid, 5,  62);
+}
+
+/**
+ * @brief Get field x from formation message
+ *
+ * @return Forward offset of each slot from the leader in the formation frame, meters (negative is behind)
+ */
+static inline uint16_t mavlink_msg_formation_get_x(const mavlink_message_t* msg, float *x)
+{
+	return _MAV_RETURN_float_array(msg, x, 5,  0);
+}
+
+/**
+ * @brief Get field y from formation message
+ *
+ * @return Right offset of each slot from the leader in the formation frame, meters
+ */
+static inline uint16_t mavlink_msg_formation_get_y(const mavlink_message_t* msg, float *y)
+{
+	return _MAV_RETURN_float_array(msg, y, 5,  20);
+}
+
+/**
+ * @brief Get field z from formation message
+ *
+ * @return Down offset of each slot from the leader in the formation frame, meters
+ */
+static inline uint16_t mavlink_msg_formation_get_z(const mavlink_message_t* msg, float *z)
+{
+	return _MAV_RETURN_float_array(msg, z, 5,  40);
+}
+
+/**
+ * @brief Decode a formation message into a struct
+ *
+ * @param msg The message to decode
+ * @param formation C-struct to decode the message contents into
+ */
+static inline void mavlink_msg_formation_decode(const mavlink_message_t* msg, mavlink_formation_t* formation)
+{
+#if MAVLINK_NEED_BYTE_SWAP
+	mavlink_msg_formation_get_x(msg, formation->x);
+	mavlink_msg_formation_get_y(msg, formation->y);
+	mavlink_msg_formation_get_z(msg, formation->z);
+	formation->target_system = mavlink_msg_formation_get_target_system(msg);
+	formation->target_component = mavlink_msg_formation_get_target_component(msg);
+	mavlink_msg_formation_get_sysid(msg, formation->sysid);
+#else
+	memcpy(formation, _MAV_PAYLOAD(msg), 67);
+#endif
+}
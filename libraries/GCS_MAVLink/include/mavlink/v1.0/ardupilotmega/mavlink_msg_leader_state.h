@@ -0,0 +1,342 @@
+// MESSAGE LEADER_STATE PACKING
+
+#define MAVLINK_MSG_ID_LEADER_STATE 169
+
+typedef struct __mavlink_leader_state_t
+{
+ uint32_t time_boot_ms; ///< Leader time of the GPS fix (milliseconds since boot)
+ int32_t lat; ///< Latitude, expressed as * 1E7
+ int32_t lon; ///< Longitude, expressed as * 1E7
+ int32_t alt; ///< Altitude in meters, expressed as * 1000 (millimeters), above MSL
+ int16_t vx; ///< Ground X Speed (Latitude), expressed as m/s * 100
+ int16_t vy; ///< Ground Y Speed (Longitude), expressed as m/s * 100
+ int16_t vz; ///< Ground Z Speed (Altitude), expressed as m/s * 100
+ int16_t roll; ///< Roll angle (degrees * 100)
+ int16_t pitch; ///< Pitch angle (degrees * 100)
+ uint16_t yaw; ///< Yaw angle (degrees * 100, 0..35999)
+} mavlink_leader_state_t;
+
+#define MAVLINK_MSG_ID_LEADER_STATE_LEN 28
+#define MAVLINK_MSG_ID_169_LEN 28
+
+
+
+#define MAVLINK_MESSAGE_INFO_LEADER_STATE { \
+	"LEADER_STATE", \
+	10, \
+	{  { "time_boot_ms", NULL, MAVLINK_TYPE_UINT32_T, 0, 0, offsetof(mavlink_leader_state_t, time_boot_ms) }, \
+         { "lat", NULL, MAVLINK_TYPE_INT32_T, 0, 4, offsetof(mavlink_leader_state_t, lat) }, \
+         { "lon", NULL, MAVLINK_TYPE_INT32_T, 0, 8, offsetof(mavlink_leader_state_t, lon) }, \
+         { "alt", NULL, MAVLINK_TYPE_INT32_T, 0, 12, offsetof(mavlink_leader_state_t, alt) }, \
+         { "vx", NULL, MAVLINK_TYPE_INT16_T, 0, 16, offsetof(mavlink_leader_state_t, vx) }, \
+         { "vy", NULL, MAVLINK_TYPE_INT16_T, 0, 18, offsetof(mavlink_leader_state_t, vy) }, \
+         { "vz", NULL, MAVLINK_TYPE_INT16_T, 0, 20, offsetof(mavlink_leader_state_t, vz) }, \
+         { "roll", NULL, MAVLINK_TYPE_INT16_T, 0, 22, offsetof(mavlink_leader_state_t, roll) }, \
+         { "pitch", NULL, MAVLINK_TYPE_INT16_T, 0, 24, offsetof(mavlink_leader_state_t, pitch) }, \
+         { "yaw", NULL, MAVLINK_TYPE_UINT16_T, 0, 26, offsetof(mavlink_leader_state_t, yaw) }, \
+         } \
+}
+
+
+/**
+ * @brief Pack a leader_state message
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param msg The MAVLink message to compress the data into
+ *
+ * @param time_boot_ms Leader time of the GPS fix (milliseconds since boot)
+ * @param lat Latitude, expressed as * 1E7
+ * @param lon Longitude, expressed as * 1E7
+ * @param alt Altitude in meters, expressed as * 1000 (millimeters), above MSL
+ * @param vx Ground X Speed (Latitude), expressed as m/s * 100
+ * @param vy Ground Y Speed (Longitude), expressed as m/s * 100
+ * @param vz Ground Z Speed (Altitude), expressed as m/s * 100
+ * @param roll Roll angle (degrees * 100)
+ * @param pitch Pitch angle (degrees * 100)
+ * @param yaw Yaw angle (degrees * 100, 0..35999)
+ * @return length of the message in bytes (excluding serial stream start sign)
+ */
+static inline uint16_t mavlink_msg_leader_state_pack(uint8_t system_id, uint8_t component_id, mavlink_message_t* msg,
+						       uint32_t time_boot_ms, int32_t lat, int32_t lon, int32_t alt, int16_t vx, int16_t vy, int16_t vz, int16_t roll, int16_t pitch, uint16_t yaw)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[28];
+	_mav_put_uint32_t(buf, 0, time_boot_ms);
+	_mav_put_int32_t(buf, 4, lat);
+	_mav_put_int32_t(buf, 8, lon);
+	_mav_put_int32_t(buf, 12, alt);
+	_mav_put_int16_t(buf, 16, vx);
+	_mav_put_int16_t(buf, 18, vy);
+	_mav_put_int16_t(buf, 20, vz);
+	_mav_put_int16_t(buf, 22, roll);
+	_mav_put_int16_t(buf, 24, pitch);
+	_mav_put_uint16_t(buf, 26, yaw);
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), buf, 28);
+#else
+	mavlink_leader_state_t packet;
+	packet.time_boot_ms = time_boot_ms;
+	packet.lat = lat;
+	packet.lon = lon;
+	packet.alt = alt;
+	packet.vx = vx;
+	packet.vy = vy;
+	packet.vz = vz;
+	packet.roll = roll;
+	packet.pitch = pitch;
+	packet.yaw = yaw;
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), &packet, 28);
+#endif
+
+	msg->msgid = MAVLINK_MSG_ID_LEADER_STATE;
+	return mavlink_finalize_message(msg, system_id, component_id, 28, 150);
+}
+
+/**
+ * @brief Pack a leader_state message on a channel
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param chan The MAVLink channel this message was sent over
+ * @param msg The MAVLink message to compress the data into
+ * @param time_boot_ms Leader time of the GPS fix (milliseconds since boot)
+ * @param lat Latitude, expressed as * 1E7
+ * @param lon Longitude, expressed as * 1E7
+ * @param alt Altitude in meters, expressed as * 1000 (millimeters), above MSL
+ * @param vx Ground X Speed (Latitude), expressed as m/s * 100
+ * @param vy Ground Y Speed (Longitude), expressed as m/s * 100
+ * @param vz Ground Z Speed (Altitude), expressed as m/s * 100
+ * @param roll Roll angle (degrees * 100)
+ * @param pitch Pitch angle (degrees * 100)
+ * @param yaw Yaw angle (degrees * 100, 0..35999)
+ * @return length of the message in bytes (excluding serial stream start sign)
+ */
+static inline uint16_t mavlink_msg_leader_state_pack_chan(uint8_t system_id, uint8_t component_id, uint8_t chan,
+							   mavlink_message_t* msg,
+						           uint32_t time_boot_ms,int32_t lat,int32_t lon,int32_t alt,int16_t vx,int16_t vy,int16_t vz,int16_t roll,int16_t pitch,uint16_t yaw)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[28];
+	_mav_put_uint32_t(buf, 0, time_boot_ms);
+	_mav_put_int32_t(buf, 4, lat);
+	_mav_put_int32_t(buf, 8, lon);
+	_mav_put_int32_t(buf, 12, alt);
+	_mav_put_int16_t(buf, 16, vx);
+	_mav_put_int16_t(buf, 18, vy);
+	_mav_put_int16_t(buf, 20, vz);
+	_mav_put_int16_t(buf, 22, roll);
+	_mav_put_int16_t(buf, 24, pitch);
+	_mav_put_uint16_t(buf, 26, yaw);
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), buf, 28);
+#else
+	mavlink_leader_state_t packet;
+	packet.time_boot_ms = time_boot_ms;
+	packet.lat = lat;
+	packet.lon = lon;
+	packet.alt = alt;
+	packet.vx = vx;
+	packet.vy = vy;
+	packet.vz = vz;
+	packet.roll = roll;
+	packet.pitch = pitch;
+	packet.yaw = yaw;
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), &packet, 28);
+#endif
+
+	msg->msgid = MAVLINK_MSG_ID_LEADER_STATE;
+	return mavlink_finalize_message_chan(msg, system_id, component_id, chan, 28, 150);
+}
+
+/**
+ * @brief Encode a leader_state struct into a message
+ *
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param msg The MAVLink message to compress the data into
+ * @param leader_state C-struct to read the message contents from
+ */
+static inline uint16_t mavlink_msg_leader_state_encode(uint8_t system_id, uint8_t component_id, mavlink_message_t* msg, const mavlink_leader_state_t* leader_state)
+{
+	return mavlink_msg_leader_state_pack(system_id, component_id, msg, leader_state->time_boot_ms, leader_state->lat, leader_state->lon, leader_state->alt, leader_state->vx, leader_state->vy, leader_state->vz, leader_state->roll, leader_state->pitch, leader_state->yaw);
+}
+
+/**
+ * @brief Send a leader_state message
+ * @param chan MAVLink channel to send the message
+ *
+ * @param time_boot_ms Leader time of the GPS fix (milliseconds since boot)
+ * @param lat Latitude, expressed as * 1E7
+ * @param lon Longitude, expressed as * 1E7
+ * @param alt Altitude in meters, expressed as * 1000 (millimeters), above MSL
+ * @param vx Ground X Speed (Latitude), expressed as m/s * 100
+ * @param vy Ground Y Speed (Longitude), expressed as m/s * 100
+ * @param vz Ground Z Speed (Altitude), expressed as m/s * 100
+ * @param roll Roll angle (degrees * 100)
+ * @param pitch Pitch angle (degrees * 100)
+ * @param yaw Yaw angle (degrees * 100, 0..35999)
+ */
+#ifdef MAVLINK_USE_CONVENIENCE_FUNCTIONS
+
+static inline void mavlink_msg_leader_state_send(mavlink_channel_t chan, uint32_t time_boot_ms, int32_t lat, int32_t lon, int32_t alt, int16_t vx, int16_t vy, int16_t vz, int16_t roll, int16_t pitch, uint16_t yaw)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[28];
+	_mav_put_uint32_t(buf, 0, time_boot_ms);
+	_mav_put_int32_t(buf, 4, lat);
+	_mav_put_int32_t(buf, 8, lon);
+	_mav_put_int32_t(buf, 12, alt);
+	_mav_put_int16_t(buf, 16, vx);
+	_mav_put_int16_t(buf, 18, vy);
+	_mav_put_int16_t(buf, 20, vz);
+	_mav_put_int16_t(buf, 22, roll);
+	_mav_put_int16_t(buf, 24, pitch);
+	_mav_put_uint16_t(buf, 26, yaw);
+
+	_mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_LEADER_STATE, buf, 28, 150);
+#else
+	mavlink_leader_state_t packet;
+	packet.time_boot_ms = time_boot_ms;
+	packet.lat = lat;
+	packet.lon = lon;
+	packet.alt = alt;
+	packet.vx = vx;
+	packet.vy = vy;
+	packet.vz = vz;
+	packet.roll = roll;
+	packet.pitch = pitch;
+	packet.yaw = yaw;
+
+	_mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_LEADER_STATE, (const char *)&packet, 28, 150);
+#endif
+}
+
+#endif
+
+// MESSAGE LEADER_STATE UNPACKING
+
+
+/**
+ * @brief Get field time_boot_ms from leader_state message
+ *
+ * @return Leader time of the GPS fix (milliseconds since boot)
+ */
+static inline uint32_t mavlink_msg_leader_state_get_time_boot_ms(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  0);
+}
+
+/**
+ * @brief Get field lat from leader_state message
+ *
+ * @return Latitude, expressed as * 1E7
+ */
+static inline int32_t mavlink_msg_leader_state_get_lat(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_int32_t(msg,  4);
+}
+
+/**
+ * @brief Get field lon from leader_state message
+ *
+ * @return Longitude, expressed as * 1E7
+ */
+static inline int32_t mavlink_msg_leader_state_get_lon(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_int32_t(msg,  8);
+}
+
+/**
+ * @brief Get field alt from leader_state message
+ *
+ * @return Altitude in meters, expressed as * 1000 (millimeters), above MSL
+ */
+static inline int32_t mavlink_msg_leader_state_get_alt(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_int32_t(msg,  12);
+}
+
+/**
+ * @brief Get field vx from leader_state message
+ *
+ * @return Ground X Speed (Latitude), expressed as m/s * 100
+ */
+static inline int16_t mavlink_msg_leader_state_get_vx(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_int16_t(msg,  16);
+}
+
+/**
+ * @brief Get field vy from leader_state message
+ *
+ * @return Ground Y Speed (Longitude), expressed as m/s * 100
+ */
+static inline int16_t mavlink_msg_leader_state_get_vy(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_int16_t(msg,  18);
+}
+
+/**
+ * @brief Get field vz from leader_state message
+ *
+ * @return Ground Z Speed (Altitude), expressed as m/s * 100
+ */
+static inline int16_t mavlink_msg_leader_state_get_vz(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_int16_t(msg,  20);
+}
+
+/**
+ * @brief Get field roll from leader_state message
+ *
+ * @return Roll angle (degrees * 100)
+ */
+static inline int16_t mavlink_msg_leader_state_get_roll(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_int16_t(msg,  22);
+}
+
+/**
+ * @brief Get field pitch from leader_state message
+ *
+ * @return Pitch angle (degrees * 100)
+ */
+static inline int16_t mavlink_msg_leader_state_get_pitch(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_int16_t(msg,  24);
+}
+
+/**
+ * @brief Get field yaw from leader_state message
+ *
+ * @return Yaw angle (degrees * 100, 0..35999)
+ */
+static inline uint16_t mavlink_msg_leader_state_get_yaw(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint16_t(msg,  26);
+}
+
+/**
+ * @brief Decode a leader_state message into a struct
+ *
+ * @param msg The message to decode
+ * @param leader_state C-struct to decode the message contents into
+ */
+static inline void mavlink_msg_leader_state_decode(const mavlink_message_t* msg, mavlink_leader_state_t* leader_state)
+{
+#if MAVLINK_NEED_BYTE_SWAP
+	leader_state->time_boot_ms = mavlink_msg_leader_state_get_time_boot_ms(msg);
+	leader_state->lat = mavlink_msg_leader_state_get_lat(msg);
+	leader_state->lon = mavlink_msg_leader_state_get_lon(msg);
+	leader_state->alt = mavlink_msg_leader_state_get_alt(msg);
+	leader_state->vx = mavlink_msg_leader_state_get_vx(msg);
+	leader_state->vy = mavlink_msg_leader_state_get_vy(msg);
+	leader_state->vz = mavlink_msg_leader_state_get_vz(msg);
+	leader_state->roll = mavlink_msg_leader_state_get_roll(msg);
+	leader_state->pitch = mavlink_msg_leader_state_get_pitch(msg);
+	leader_state->yaw = mavlink_msg_leader_state_get_yaw(msg);
+#else
+	memcpy(leader_state, _MAV_PAYLOAD(msg), 28);
+#endif
+}
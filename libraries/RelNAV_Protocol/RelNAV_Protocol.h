@@ -0,0 +1,172 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: t -*-
+
+/// @file	RelNAV_Protocol.h
+/// @brief	Frames exchanged between the autopilot and the vision
+///			computer on the Rel NAV serial port (Serial2).
+///
+/// This header has no dependencies beyond <stdint.h> so the vision
+/// process can compile against it as C or C++. All values are
+/// little-endian and every frame ends with an XOR checksum of all
+/// preceding bytes, header included.
+///
+/// On a shared host the poses can also be passed through shared
+/// memory, see relnav_shm below.
+///
+/// Vision computer to autopilot:
+///   DATA	relative pose of the leader, sent once per "H" request in
+///			poll mode, or streamed against credit in push mode
+///   LEDS	raw LED centroids, sent in place of DATA when the pose is
+///			solved on the autopilot (RNAV_LEDS enabled)
+///
+/// Autopilot to vision computer:
+///   "H"	poll request, a text line (poll mode only)
+///   ACK	flow control credit and link statistics (push mode only)
+///   PRED	predicted pose at the next frame, for the region of
+///			interest of the LED search (RNAV_ROI enabled)
+
+#ifndef RELNAV_PROTOCOL_H
+#define RELNAV_PROTOCOL_H
+
+#include <stdint.h>
+
+#define RELNAV_DATA_HEADER		"DATA"
+#define RELNAV_LEDS_HEADER		"LEDS"
+#define RELNAV_ACK_HEADER		"ACK"
+#define RELNAV_PRED_HEADER		"PRED"
+
+// LEDs in the field of view
+#define RELNAV_LED_1			(1<<0)
+#define RELNAV_LED_2			(1<<1)
+#define RELNAV_LED_3			(1<<2)
+#define RELNAV_LED_4			(1<<3)
+#define RELNAV_LED_5			(1<<4)
+#define RELNAV_LED_ALL			0x1F
+
+#pragma pack(push, 1)
+
+/// Relative pose of the leader in the follower's body frame. A NaN
+/// x signals a failed pose estimate.
+struct relnav_data {
+	char	header[4];			///< "DATA"
+	float	x, y, z;			///< relative position, inches
+	float	bank, pitch, hdg;	///< relative Euler angles, degrees
+	uint8_t	led_mask;			///< RELNAV_LED_* bits in view
+	uint8_t	chk;
+};
+
+/// Undistorted image centroids of the leader's LEDs, pixels, in the
+/// order of the RELNAV_LED_* bits. Entries for LEDs not in led_mask
+/// are ignored.
+struct relnav_leds {
+	char	header[4];			///< "LEDS"
+	float	centroid[5][2];		///< column, row
+	uint8_t	led_mask;			///< RELNAV_LED_* bits in view
+	uint8_t	chk;
+};
+
+/// Push mode flow control, sent on every autopilot update (10 Hz).
+/// The vision computer may send up to 'credit' frames before
+/// the next ACK.
+struct relnav_ack {
+	char	header[3];			///< "ACK"
+	uint8_t	seq;				///< incremented for each ACK
+	uint8_t	credit;				///< DATA or LEDS frames that fit in the receive buffer
+	uint8_t	rate;				///< good DATA frames over the last second
+	uint8_t	drops;				///< bad frames and resyncs since the last ACK
+	uint8_t	chk;
+};
+
+/// Leader pose predicted for the next camera frame, in the same frame
+/// and units as relnav_data. The last pose is rotated by the
+/// follower's attitude change since it arrived, then extrapolated
+/// over one frame period with the body rates, which are included so
+/// the vision side can extrapolate further itself.
+struct relnav_pred {
+	char	header[4];			///< "PRED"
+	uint16_t horizon_ms;		///< time from the last pose to the predicted frame
+	float	x, y, z;			///< predicted relative position, inches
+	float	bank, pitch, hdg;	///< predicted relative Euler angles, degrees
+	float	p, q, r;			///< follower body rates, rad/s
+	uint8_t	led_mask;			///< LEDs seen in the last pose
+	uint8_t	chk;
+};
+
+#pragma pack(pop)
+
+/// XOR checksum of a frame. len is the size of the whole frame, whose
+/// last byte is the checksum, so that byte is left out
+static inline uint8_t relnav_checksum(const void *frame, uint8_t len)
+{
+	const uint8_t *p = (const uint8_t *)frame;
+	uint8_t chk = 0;
+	if (len == 0) {
+		return 0;
+	}
+	for (uint8_t i=0; i<len-1; i++) {
+		chk ^= p[i];
+	}
+	return chk;
+}
+
+#ifndef __AVR__
+
+/// Shared memory pose slot, for a solver on the same host as the
+/// autopilot (desktop build, -L). It replaces the serial DATA frames:
+/// the solver overwrites the slot with each new pose under a sequence
+/// lock, and the autopilot takes the latest one without framing,
+/// checksums or waiting. The autopilot creates the POSIX shared memory
+/// object RELNAV_SHM_NAME, with its instance number, and sets the
+/// magic last.
+#define RELNAV_SHM_NAME			"/relnav_pose%u"
+#define RELNAV_SHM_MAGIC		0x504e5352
+#define RELNAV_SHM_VERSION		1
+
+/// A pose as in relnav_data. A NaN x signals a failed pose estimate.
+struct relnav_pose {
+	uint64_t capture_us;		///< camera capture time, CLOCK_MONOTONIC microseconds
+	float	x, y, z;			///< relative position, inches
+	float	bank, pitch, hdg;	///< relative Euler angles, degrees
+	uint8_t	led_mask;			///< RELNAV_LED_* bits in view
+};
+
+struct relnav_shm {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seq;				///< odd while the solver is writing
+	uint32_t reserved;
+	struct relnav_pose pose;
+};
+
+/// Publish a pose. There must be only one writer.
+static inline void relnav_shm_write(struct relnav_shm *shm, const struct relnav_pose *pose)
+{
+	uint32_t seq = shm->seq;
+	__atomic_store_n(&shm->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	shm->pose = *pose;
+	__atomic_store_n(&shm->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/// Copy out the latest pose. Returns its sequence number, which is
+/// even and changes with every pose, or 0 if there is no pose yet or
+/// the writer kept it busy. Never blocks.
+static inline uint32_t relnav_shm_read(const struct relnav_shm *shm, struct relnav_pose *pose)
+{
+	uint8_t tries;
+	for (tries = 0; tries < 4; tries++) {
+		uint32_t seq = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1) {
+			continue;
+		}
+		*pose = shm->pose;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&shm->seq, __ATOMIC_RELAXED) == seq) {
+			return seq;
+		}
+	}
+	return 0;
+}
+
+#endif // __AVR__
+
+#endif // RELNAV_PROTOCOL_H
@@ -0,0 +1,91 @@
+/*
+ * Example solver side of the Rel NAV shared memory pose slot. It
+ * publishes a leader holding station 50 feet ahead at the camera rate,
+ * stamped with the capture time:
+ *
+ *   gcc -O2 -I.. -o relnav_shm_demo relnav_shm_demo.c -lrt -lm
+ *   /tmp/ArduPlane.build/ArduPlane.elf -L &
+ *   ./relnav_shm_demo [SECONDS] [RATE] [INSTANCE]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "RelNAV_Protocol.h"
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 30;
+    double rate = argc > 2 ? atof(argv[2]) : 30;
+    unsigned instance = argc > 3 ? atoi(argv[3]) : 0;
+    struct relnav_shm *shm = NULL;
+    struct relnav_pose pose;
+    char name[32];
+    unsigned count = 0;
+
+    snprintf(name, sizeof(name), RELNAV_SHM_NAME, instance);
+    while (shm == NULL) {
+        int fd = shm_open(name, O_RDWR, 0);
+        if (fd != -1) {
+            void *p = mmap(NULL, sizeof(*shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED) {
+                perror("mmap");
+                return 1;
+            }
+            shm = (struct relnav_shm *)p;
+            if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != RELNAV_SHM_MAGIC) {
+                munmap(p, sizeof(*shm));
+                shm = NULL;
+            }
+        } else if (errno != ENOENT) {
+            perror(name);
+            return 1;
+        }
+        if (shm == NULL) {
+            usleep(100000);
+        }
+    }
+    if (shm->version != RELNAV_SHM_VERSION) {
+        fprintf(stderr, "%s: version %u, expected %u\n", name,
+                (unsigned)shm->version, RELNAV_SHM_VERSION);
+        return 1;
+    }
+
+    uint64_t start = now_us();
+    uint64_t period = 1.0e6 / rate;
+    uint64_t next = start;
+    while (now_us() - start < seconds * 1.0e6) {
+        double t = (now_us() - start) * 1.0e-6;
+        pose.capture_us = now_us();
+        pose.x = 600;
+        pose.y = 20 * sin(0.5 * t);
+        pose.z = 10;
+        pose.bank = 0;
+        pose.pitch = 0;
+        pose.hdg = 2 * sin(0.5 * t);
+        pose.led_mask = RELNAV_LED_ALL;
+        relnav_shm_write(shm, &pose);
+        count++;
+
+        next += period;
+        uint64_t now = now_us();
+        if (next > now) {
+            usleep(next - now);
+        }
+    }
+    printf("published %u poses\n", count);
+    return 0;
+}
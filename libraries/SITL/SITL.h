@@ -3,25 +3,87 @@
 #ifndef __SITL_H__
 #define __SITL_H__
 
+#include <stdio.h>
 #include <AP_Param.h>
 #include <AP_Common.h>
 #include <AP_Math.h>
 #include <GCS_MAVLink.h>
+#include "SITL_FDM.h"
 
-struct sitl_fdm {
-	// this is the packet sent by the simulator
-	// to the APM executable to update the simulator state
-	// All values are little-endian
+/*
+  capture file for the desktop replay harness. The file is a sequence
+  of records, each a sitl_replay_header followed by 'length' bytes of
+  payload. The payloads are the sensor values as given to the emulated
+  sensor drivers, so a replay sees exactly what the sketch saw.
+  All values are little-endian
+
+  An FDM capture has the same layout, but holds the packets received
+  from the flight simulator (SITL_REPLAY_FDM and SITL_REPLAY_RC)
+  instead. Replaying it runs the sensor emulation as if the simulator
+  were connected. The magic in the first record tells the two apart
+ */
+#define SITL_REPLAY_MAGIC     0x4c505252 // first record payload
+#define SITL_REPLAY_FDM_MAGIC 0x4d444652 // first record of an FDM capture
+
+enum sitl_replay_type {
+	SITL_REPLAY_START   = 0, // payload is the magic number
+	SITL_REPLAY_IMU     = 1,
+	SITL_REPLAY_GPS     = 2,
+	SITL_REPLAY_BARO    = 3,
+	SITL_REPLAY_COMPASS = 4,
+	SITL_REPLAY_RC      = 5,
+	SITL_REPLAY_SERIAL  = 6, // port number, then the bytes received on it
+	SITL_REPLAY_FDM     = 7  // struct sitl_fdm, SITL_FDM_PACKET_SIZE bytes
+};
+
+#pragma pack(push, 1)
+struct sitl_replay_header {
+	uint32_t time_us; // micros() when the value was given to the sketch
+	uint8_t type;
+	uint8_t length;
+};
+
+struct sitl_replay_imu {
+	float gyro[3];  // rad/s in body frame
+	float accel[3]; // m/s/s in body frame
+	float airspeed; // m/s
+};
+
+struct sitl_replay_gps {
 	double latitude, longitude; // degrees
-	double altitude;  // MSL
-	double heading;   // degrees
-	double speedN, speedE; // m/s
-	double xAccel, yAccel, zAccel;       // m/s/s in body frame
-	double rollRate, pitchRate, yawRate; // degrees/s/s in earth frame
-	double rollDeg, pitchDeg, yawDeg;    // euler angles, degrees
-	double airspeed; // m/s
-	uint32_t magic; // 0x4c56414e
+	float altitude; // MSL, meters
+	float speedN, speedE; // m/s
+	uint8_t have_lock;
+};
+
+struct sitl_replay_baro {
+	float temperature; // as given to AP_Baro_BMP085_HIL::setHIL()
+	float pressure;    // Pascals
+};
+
+struct sitl_replay_compass {
+	float field[3]; // body frame, including offsets
+};
+
+struct sitl_replay_rc {
+	uint16_t pwm[8];
 };
+#pragma pack(pop)
+
+// the file the replay harness writes estimated states to, or NULL
+// when not replaying
+FILE *sitl_replay_output(void);
+
+// the file the raw Rel NAV stream is captured to (-V), or NULL
+FILE *sitl_stream_capture(void);
+
+// the Rel NAV stream capture being replayed (-S), or NULL. speed is
+// the multiple of the recorded rate to replay it at
+FILE *sitl_stream_replay(float *speed);
+
+// the shared memory pose slot for a solver on this host (-L), or NULL
+struct relnav_shm;
+const struct relnav_shm *sitl_relnav_shm(void);
 
 
 class SITL
@@ -0,0 +1,153 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/*
+  interface between the desktop build and an external flight dynamics
+  model. This header is plain C so simulator bridges can use it, see
+  libraries/SITL/tools/sitl_fdm_client.c
+ */
+#ifndef __SITL_FDM_H__
+#define __SITL_FDM_H__
+
+#include <stdint.h>
+#include <string.h>
+
+struct sitl_fdm {
+	// this is the packet sent by the simulator
+	// to the APM executable to update the simulator state
+	// All values are little-endian
+	double latitude, longitude; // degrees
+	double altitude;  // MSL
+	double heading;   // degrees
+	double speedN, speedE; // m/s
+	double xAccel, yAccel, zAccel;       // m/s/s in body frame
+	double rollRate, pitchRate, yawRate; // degrees/s/s in earth frame
+	double rollDeg, pitchDeg, yawDeg;    // euler angles, degrees
+	double airspeed; // m/s
+	uint32_t magic; // 0x4c56414e
+};
+
+// the length of a sitl_fdm on the wire, without the padding at the end
+#define SITL_FDM_PACKET_SIZE 132
+
+// receiver PWM inputs, zero for no change
+struct sitl_rc_input {
+	uint16_t pwm[8];
+};
+
+// the servo outputs and wind sent back to the simulator
+struct sitl_servos {
+	uint16_t pwm[11];
+	uint16_t speed, direction, turbulance; // wind, cm/s, cdeg and %
+};
+
+/*
+  optional shared memory transport, started with -M. The desktop
+  build creates the POSIX shared memory object SITL_SHM_NAME, with the
+  instance number in it, holding two single producer, single consumer
+  rings: one from the simulator and one back to it.
+
+  Each message has a type and a length, and the reader accepts any
+  message at least as long as the structure it expects, so the
+  structures can grow. Messages are numbered per ring from 1, and a
+  message that does not fit is dropped but still uses up a number, so
+  gaps show losses. Each message also carries the number of the last
+  message the writer read from the other ring, so a simulator can
+  step in lock-step with the outputs it gets back.
+
+  A reader with nothing to read may sleep on the ring's head with a
+  futex, after setting 'waiting'. The writer wakes it after adding a
+  message
+ */
+#define SITL_SHM_NAME    "/apm_sitl_fdm%u"
+#define SITL_SHM_MAGIC   0x4d485346
+#define SITL_SHM_VERSION 1
+#define SITL_SHM_SLOTS   64 // must be a power of 2
+#define SITL_SHM_MAX_MSG 240
+
+enum sitl_shm_type {
+	SITL_SHM_FDM    = 1, // struct sitl_fdm, the magic is not checked
+	SITL_SHM_RC     = 2, // struct sitl_rc_input
+	SITL_SHM_SERVOS = 3  // struct sitl_servos
+};
+
+struct sitl_shm_slot {
+	uint32_t seq;
+	uint32_t ack;    // last seq read from the other ring
+	uint16_t type;
+	uint16_t length;
+	uint32_t reserved;
+	uint8_t data[SITL_SHM_MAX_MSG];
+};
+
+struct sitl_shm_ring {
+	// written by the producer. head is also the futex word
+	uint32_t head;
+	uint32_t seq;
+	uint32_t dropped;
+	uint32_t pad0[13];
+	// written by the consumer
+	uint32_t tail;
+	uint32_t waiting;
+	uint32_t pad1[14];
+	struct sitl_shm_slot slot[SITL_SHM_SLOTS];
+};
+
+struct sitl_shm {
+	uint32_t magic;   // set last, once the rings are ready
+	uint32_t version;
+	uint32_t size;    // sizeof(struct sitl_shm)
+	uint32_t pad[13];
+	struct sitl_shm_ring to_sitl, from_sitl;
+};
+
+/*
+  add a message to a ring. Returns its number, or 0 if it was dropped
+  because the ring is full
+ */
+static inline uint32_t sitl_shm_put(struct sitl_shm_ring *r, uint16_t type,
+									const void *data, uint16_t length, uint32_t ack)
+{
+	uint32_t seq = ++r->seq;
+	uint32_t head = r->head;
+	if (length > SITL_SHM_MAX_MSG ||
+		head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= SITL_SHM_SLOTS) {
+		r->dropped++;
+		return 0;
+	}
+	struct sitl_shm_slot *slot = &r->slot[head & (SITL_SHM_SLOTS-1)];
+	slot->seq = seq;
+	slot->ack = ack;
+	slot->type = type;
+	slot->length = length;
+	memcpy(slot->data, data, length);
+	__atomic_store_n(&r->head, head+1, __ATOMIC_SEQ_CST);
+	return seq;
+}
+
+/*
+  the oldest message in a ring, or NULL if it is empty. It stays valid
+  until sitl_shm_next() is called
+ */
+static inline const struct sitl_shm_slot *sitl_shm_peek(struct sitl_shm_ring *r)
+{
+	uint32_t tail = r->tail;
+	if (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == tail) {
+		return NULL;
+	}
+	return &r->slot[tail & (SITL_SHM_SLOTS-1)];
+}
+
+static inline void sitl_shm_next(struct sitl_shm_ring *r)
+{
+	__atomic_store_n(&r->tail, r->tail+1, __ATOMIC_RELEASE);
+}
+
+/*
+  true if the reader of a ring is asleep and needs a futex wake
+ */
+static inline int sitl_shm_reader_waiting(struct sitl_shm_ring *r)
+{
+	return __atomic_load_n(&r->waiting, __ATOMIC_SEQ_CST) != 0;
+}
+
+#endif // __SITL_FDM_H__
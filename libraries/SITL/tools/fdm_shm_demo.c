@@ -0,0 +1,80 @@
+/*
+ * Example bridge for the SITL shared memory FDM transport. It holds
+ * the aircraft level and still, sending a new state each time SITL
+ * sends servo outputs, and reports the rates once a second:
+ *
+ *   gcc -O2 -o fdm_shm_demo fdm_shm_demo.c sitl_fdm_client.c -lrt
+ *   /tmp/ArduPlane.build/ArduPlane.elf -M -r 1000 &
+ *   ./fdm_shm_demo [SECONDS] [INSTANCE]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sitl_fdm_client.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+int main(int argc, char **argv)
+{
+    struct sitl_fdm_client c;
+    struct sitl_fdm fdm;
+    struct sitl_servos servos;
+    double seconds = argc > 1 ? atof(argv[1]) : 30;
+    unsigned instance = argc > 2 ? atoi(argv[2]) : 0;
+    unsigned sent = 0, received = 0, full = 0;
+    uint32_t seq = 0, ack = 0;
+
+    while (sitl_fdm_client_open(&c, instance) != 0) {
+        if (errno != ENOENT && errno != EAGAIN) {
+            perror("sitl_fdm_client_open");
+            return 1;
+        }
+        usleep(100000);
+    }
+
+    memset(&fdm, 0, sizeof(fdm));
+    fdm.latitude = -35.362938;
+    fdm.longitude = 149.165085;
+    fdm.altitude = 584;
+    fdm.zAccel = -9.81;
+    fdm.magic = 0x4c56414e;
+
+    double start = now(), last_report = start;
+    while (now() - start < seconds) {
+        uint32_t s = sitl_fdm_client_send(&c, &fdm);
+        if (s != 0) {
+            seq = s;
+            sent++;
+        } else {
+            full++;
+        }
+
+        // step again as soon as SITL has answered
+        int ret = sitl_fdm_client_recv(&c, &servos, &ack, 100);
+        if (ret < 0) {
+            printf("SITL went away\n");
+            break;
+        }
+        received += ret;
+
+        if (now() - last_report >= 1) {
+            printf("sent %u/s  servos %u/s  ring full %u  dropped %u  lag %u  throttle %u\n",
+                   sent, received, full, (unsigned)sitl_fdm_client_dropped(&c),
+                   (unsigned)(seq - ack), (unsigned)servos.pwm[2]);
+            fflush(stdout);
+            sent = received = full = 0;
+            last_report = now();
+        }
+    }
+    sitl_fdm_client_close(&c);
+    return 0;
+}
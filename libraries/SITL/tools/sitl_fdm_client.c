@@ -0,0 +1,147 @@
+/*
+ * Reference client for the SITL shared memory FDM transport:
+ *
+ *   gcc -O2 -c sitl_fdm_client.c
+ *
+ * and link with -lrt on older glibc. Waiting for servo outputs uses a
+ * futex on Linux and polls elsewhere.
+ */
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#include "sitl_fdm_client.h"
+
+int sitl_fdm_client_open(struct sitl_fdm_client *c, unsigned instance)
+{
+    char name[32];
+    int fd;
+    void *p;
+
+    c->shm = NULL;
+    c->ack = 0;
+    snprintf(name, sizeof(name), SITL_SHM_NAME, instance);
+    fd = shm_open(name, O_RDWR, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    p = mmap(NULL, sizeof(struct sitl_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        return -1;
+    }
+    c->shm = (struct sitl_shm *)p;
+    if (__atomic_load_n(&c->shm->magic, __ATOMIC_ACQUIRE) != SITL_SHM_MAGIC) {
+        sitl_fdm_client_close(c);
+        errno = EAGAIN;
+        return -1;
+    }
+    if (c->shm->version != SITL_SHM_VERSION || c->shm->size != sizeof(struct sitl_shm)) {
+        sitl_fdm_client_close(c);
+        errno = EPROTO;
+        return -1;
+    }
+    // skip the servo outputs queued before we attached
+    struct sitl_shm_ring *r = &c->shm->from_sitl;
+    __atomic_store_n(&r->tail, __atomic_load_n(&r->head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    return 0;
+}
+
+void sitl_fdm_client_close(struct sitl_fdm_client *c)
+{
+    if (c->shm != NULL) {
+        munmap(c->shm, sizeof(struct sitl_shm));
+        c->shm = NULL;
+    }
+}
+
+uint32_t sitl_fdm_client_send(struct sitl_fdm_client *c, const struct sitl_fdm *fdm)
+{
+    return sitl_shm_put(&c->shm->to_sitl, SITL_SHM_FDM, fdm, sizeof(*fdm), c->ack);
+}
+
+uint32_t sitl_fdm_client_send_rc(struct sitl_fdm_client *c, const struct sitl_rc_input *rc)
+{
+    return sitl_shm_put(&c->shm->to_sitl, SITL_SHM_RC, rc, sizeof(*rc), c->ack);
+}
+
+/*
+ * sleep until the head of the ring moves from head, or timeout_ms
+ */
+static void wait_head(struct sitl_shm_ring *r, uint32_t head, int timeout_ms)
+{
+#ifdef __linux__
+    struct timespec ts, *tp = NULL;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        tp = &ts;
+    }
+    __atomic_store_n(&r->waiting, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->head, __ATOMIC_SEQ_CST) == head) {
+        syscall(SYS_futex, &r->head, FUTEX_WAIT, head, tp, NULL, 0);
+    }
+    __atomic_store_n(&r->waiting, 0, __ATOMIC_SEQ_CST);
+#else
+    (void)r;
+    (void)head;
+    (void)timeout_ms;
+    usleep(1000);
+#endif
+}
+
+static int64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+int sitl_fdm_client_recv(struct sitl_fdm_client *c, struct sitl_servos *servos,
+                         uint32_t *ack, int timeout_ms)
+{
+    struct sitl_shm_ring *r = &c->shm->from_sitl;
+    int64_t start = now_ms();
+
+    while (1) {
+        const struct sitl_shm_slot *m;
+        while ((m = sitl_shm_peek(r)) != NULL) {
+            int ok = (m->type == SITL_SHM_SERVOS && m->length >= sizeof(*servos));
+            if (ok) {
+                memcpy(servos, m->data, sizeof(*servos));
+                if (ack != NULL) {
+                    *ack = m->ack;
+                }
+            }
+            c->ack = m->seq;
+            sitl_shm_next(r);
+            if (ok) {
+                return 1;
+            }
+        }
+        if (__atomic_load_n(&c->shm->magic, __ATOMIC_ACQUIRE) != SITL_SHM_MAGIC) {
+            return -1;
+        }
+        int left = -1;
+        if (timeout_ms >= 0) {
+            left = timeout_ms - (int)(now_ms() - start);
+            if (left <= 0) {
+                return 0;
+            }
+        }
+        // the ring was empty, so its head was at our tail
+        wait_head(r, r->tail, left);
+    }
+}
+
+uint32_t sitl_fdm_client_dropped(const struct sitl_fdm_client *c)
+{
+    return __atomic_load_n(&c->shm->from_sitl.dropped, __ATOMIC_RELAXED);
+}
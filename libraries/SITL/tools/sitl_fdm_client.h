@@ -0,0 +1,51 @@
+/*
+ * Reference client for the SITL shared memory FDM transport, for
+ * simulator bridges to build in or link against. See SITL_FDM.h for
+ * the layout.
+ */
+#ifndef __SITL_FDM_CLIENT_H__
+#define __SITL_FDM_CLIENT_H__
+
+#include "../SITL_FDM.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct sitl_fdm_client {
+    struct sitl_shm *shm;
+    uint32_t ack;       // last message read from SITL
+};
+
+/*
+ * attach to the SITL instance started with -M (and -I instance).
+ * Returns 0, or -1 with errno set. EAGAIN means SITL has not set up
+ * the rings yet.
+ */
+int sitl_fdm_client_open(struct sitl_fdm_client *c, unsigned instance);
+void sitl_fdm_client_close(struct sitl_fdm_client *c);
+
+/*
+ * queue a new state or RC input for SITL. Returns the message number,
+ * or 0 if the ring was full (SITL reads it once a millisecond).
+ */
+uint32_t sitl_fdm_client_send(struct sitl_fdm_client *c, const struct sitl_fdm *fdm);
+uint32_t sitl_fdm_client_send_rc(struct sitl_fdm_client *c, const struct sitl_rc_input *rc);
+
+/*
+ * take the oldest servo output from SITL, waiting up to timeout_ms (0
+ * to poll, -1 forever). *ack is set to the number of the last state
+ * SITL had read when it made them. Returns 1 if servos were read, 0
+ * on timeout, -1 if SITL went away.
+ */
+int sitl_fdm_client_recv(struct sitl_fdm_client *c, struct sitl_servos *servos,
+                         uint32_t *ack, int timeout_ms);
+
+// messages SITL could not queue for us, because we did not read them
+uint32_t sitl_fdm_client_dropped(const struct sitl_fdm_client *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SITL_FDM_CLIENT_H__